@@ -0,0 +1,273 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    This example code is distributed freely.
+    This is an exception from the rest of the library that is released
+    under GNU Lesser General Public License.
+
+    The purpose of this example code is to demonstrate parts of the 
+    library's functionality and capabilities. It is free to use, copy
+    and edit without restrictions.
+
+*/
+
+/*
+ * Measures how fast touch notifications are read, parsed and delivered, and
+ * prints the results over Serial as CSV, one line per run:
+ *
+ *   version,transport,source,mode,touches,frames,frames_per_second,us_per_frame,p50_us,p99_us,max_us
+ *
+ * source is "generated" for notifications from TouchGenerator, which measures the
+ * parser alone, and "sensor" for notifications read from a connected sensor with
+ * a finger held on it, which includes the i2c transfer. mode is "message" for
+ * GetMessage()/ParseMessage(), "frame" for GetTouchFrame()/ParseTouchFrame() and
+ * "view" for GetTouchFrameView()/ParseTouchFrameView() with every touch iterated.
+ * Save the output to compare library versions and platforms.
+ */
+
+#include <Zforce.h>
+#include <TouchGenerator.h>
+
+// IMPORTANT: change "1" to assigned GPIO digital pin for dataReady signal in your setup:
+#define DATA_READY 1
+// Set to 0 to only benchmark the parser, without a sensor.
+#define USE_SENSOR 1
+
+#define FRAMES_PER_RUN 1000
+#define SENSOR_TIMEOUT_MS 5000
+// Latency histogram, the percentiles are rounded up to a whole bucket.
+#define BUCKET_US 8
+#define BUCKETS 64
+
+enum ReadMode : uint8_t
+{
+  MESSAGE,
+  FRAME,
+  VIEW
+};
+const char* const modeNames[] = {"message", "frame", "view"};
+
+uint16_t histogram[BUCKETS];
+uint32_t maxLatency;
+uint8_t generated[BUFFER_SIZE];
+// Global rather than on the stack, where its 363 bytes on AVR would not show up
+// in the RAM use reported when building.
+TouchGenerator generator;
+TouchFrame frame;
+TouchFrameView view;
+// Touches are summed here so that iterating a view cannot be optimized away.
+volatile uint32_t touchSink;
+
+void AddSample(uint32_t latency)
+{
+  uint32_t bucket = latency / BUCKET_US;
+  histogram[(bucket < BUCKETS) ? bucket : (BUCKETS - 1)]++;
+  if (latency > maxLatency)
+  {
+    maxLatency = latency;
+  }
+}
+
+uint32_t Percentile(uint32_t frames, uint8_t percent)
+{
+  uint32_t target = (frames * percent + 99) / 100;
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < BUCKETS; i++)
+  {
+    count += histogram[i];
+    if (count >= target)
+    {
+      return (uint32_t)(i + 1) * BUCKET_US;
+    }
+  }
+  return maxLatency;
+}
+
+void PrintResult(const char* source, const char* mode, uint8_t touches, uint32_t frames, uint32_t elapsed)
+{
+#if defined(__AVR__)
+  const char* transport = "twi";
+#else
+  const char* transport = "wire";
+#endif
+
+  Serial.print(ZFORCE_LIBRARY_VERSION);
+  Serial.print(',');
+  Serial.print(transport);
+  Serial.print(',');
+  Serial.print(source);
+  Serial.print(',');
+  Serial.print(mode);
+  Serial.print(',');
+  Serial.print(touches);
+  Serial.print(',');
+  Serial.print(frames);
+  Serial.print(',');
+  Serial.print((elapsed > 0) ? (frames * 1000000.0 / elapsed) : 0.0);
+  Serial.print(',');
+  Serial.print((frames > 0) ? ((float)elapsed / frames) : 0.0);
+  Serial.print(',');
+  Serial.print(Percentile(frames, 50));
+  Serial.print(',');
+  Serial.print(Percentile(frames, 99));
+  Serial.print(',');
+  Serial.println(maxLatency);
+}
+
+void ResetSamples()
+{
+  memset(histogram, 0, sizeof(histogram));
+  maxLatency = 0;
+}
+
+// Parses generated notifications with touchCount fingers moving on the sensor.
+// Iterates the touches of view, which decodes them.
+uint8_t ConsumeView()
+{
+  uint8_t count = 0;
+  for (const TouchData& touch : view)
+  {
+    touchSink += touch.x;
+    count++;
+  }
+  return count;
+}
+
+void RunGenerated(uint8_t touchCount, ReadMode mode)
+{
+  generator.ClearFingers();
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    FingerPath path = {PathShape::ELLIPSE, (uint16_t)(500 + i * 300), 1500, 200, 400, 40, 200000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+
+  // Set up the parser for the descriptor of the generator.
+  generator.TouchFormatResponse(generated);
+  zforce.DestroyMessage(zforce.ParseMessage(generated));
+
+  ResetSamples();
+  uint32_t frames = 0;
+  uint32_t elapsed = 0;
+  for (uint32_t n = 0; n < FRAMES_PER_RUN; n++)
+  {
+    // Frames without any finger give no message, and are not measured.
+    if (generator.NextMessage(generated) == 0)
+    {
+      continue;
+    }
+    frames++;
+
+    uint32_t start = micros();
+    if (mode == FRAME)
+    {
+      Message* msg;
+      zforce.ParseTouchFrame(generated, &frame, &msg);
+      zforce.DestroyMessage(msg);
+    }
+    else if (mode == VIEW)
+    {
+      Message* msg;
+      if (zforce.ParseTouchFrameView(generated, &view, &msg))
+      {
+        ConsumeView();
+      }
+      zforce.DestroyMessage(msg);
+    }
+    else
+    {
+      zforce.DestroyMessage(zforce.ParseMessage(generated));
+    }
+    uint32_t latency = micros() - start;
+
+    elapsed += latency;
+    AddSample(latency);
+  }
+
+  PrintResult("generated", modeNames[mode], touchCount, frames, elapsed);
+}
+
+#if USE_SENSOR
+// Reads notifications from the sensor. Latency is measured from data ready going
+// high until the touches have been delivered, the frame rate over the whole run.
+void RunSensor(ReadMode mode)
+{
+  uint32_t frames = 0;
+  uint8_t touches = 0;
+  unsigned long lastFrame = millis();
+
+  ResetSamples();
+  uint32_t runStart = micros();
+  while ((frames < FRAMES_PER_RUN) && ((millis() - lastFrame) < SENSOR_TIMEOUT_MS))
+  {
+    while ((zforce.GetDataReady() == LOW) && ((millis() - lastFrame) < SENSOR_TIMEOUT_MS));
+    uint32_t start = micros();
+
+    bool isTouch = false;
+    if (mode == FRAME)
+    {
+      Message* msg;
+      isTouch = zforce.GetTouchFrame(&frame, &msg);
+      zforce.DestroyMessage(msg);
+      touches = isTouch ? frame.touchCount : touches;
+    }
+    else if (mode == VIEW)
+    {
+      Message* msg;
+      isTouch = zforce.GetTouchFrameView(&view, &msg);
+      zforce.DestroyMessage(msg);
+      touches = isTouch ? ConsumeView() : touches;
+    }
+    else
+    {
+      Message* msg = zforce.GetMessage();
+      if ((msg != nullptr) && (msg->type == MessageType::TOUCHTYPE))
+      {
+        isTouch = true;
+        touches = ((TouchMessage*)msg)->touchCount;
+      }
+      zforce.DestroyMessage(msg);
+    }
+
+    if (isTouch)
+    {
+      AddSample(micros() - start);
+      frames++;
+      lastFrame = millis();
+    }
+  }
+
+  PrintResult("sensor", modeNames[mode], touches, frames, micros() - runStart);
+}
+#endif
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial);
+
+#if USE_SENSOR
+  zforce.Start(DATA_READY);
+  zforce.Enable(true);
+#endif
+
+  Serial.println("version,transport,source,mode,touches,frames,frames_per_second,us_per_frame,p50_us,p99_us,max_us");
+
+#if USE_SENSOR
+  RunSensor(MESSAGE);
+  RunSensor(FRAME);
+  RunSensor(VIEW);
+#endif
+
+  // Generated notifications replace the touch descriptor of the sensor, so these run last.
+  const uint8_t touchCounts[] = {1, 5, 10};
+  for (uint8_t i = 0; i < sizeof(touchCounts); i++)
+  {
+    RunGenerated(touchCounts[i], MESSAGE);
+    RunGenerated(touchCounts[i], FRAME);
+    RunGenerated(touchCounts[i], VIEW);
+  }
+}
+
+void loop()
+{
+}
@@ -0,0 +1,435 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    This example code is distributed freely.
+    This is an exception from the rest of the library that is released
+    under GNU Lesser General Public License.
+
+    The purpose of this example code is to demonstrate parts of the 
+    library's functionality and capabilities. It is free to use, copy
+    and edit without restrictions.
+
+*/
+
+/*
+ * Measures the cost of library calls in CPU cycles and bytes of stack on the board
+ * itself, where timings from a PC say little, and prints the results over Serial
+ * as CSV, one line per call:
+ *
+ *   version,board,call,touches,runs,min_cycles,avg_cycles,max_cycles,stack_bytes
+ *
+ * Cycles are counted with Timer1 on AVR (which this sketch takes over) and with
+ * the DWT cycle counter on Cortex-M3 and above. Other boards convert micros() to
+ * cycles, which is only accurate to a few microseconds. The measurement overhead
+ * is subtracted. min_cycles is the cost of the call itself, while avg_cycles and
+ * max_cycles also include interrupts such as the millis() timer. Stack use is
+ * only measured on AVR, by filling the free RAM with a pattern before each call
+ * and finding how much of it was overwritten. It includes the calls made by the
+ * measured call, e.g. into the I2C library.
+ *
+ * ParseMessage and ParseTouchFrame decode touch notifications with 1, 5 and 10
+ * touches from TouchGenerator, the part of GetMessage() that does not depend on
+ * the I2C bus. With USE_SENSOR set, Start(), GetMessage() with fingers held on
+ * the sensor and the configuration commands are measured as well, including the
+ * I2C transfers. GetMessage() gives a line for each number of touches read.
+ *
+ * extras/simavr/run.sh builds this sketch for ATmega328P and ATmega32U4 and runs
+ * it in simavr, with a modelled sensor on the I2C bus.
+ */
+
+#include <Zforce.h>
+#include <TouchGenerator.h>
+
+// IMPORTANT: change "1" to assigned GPIO digital pin for dataReady signal in your setup:
+#ifndef DATA_READY
+#define DATA_READY 1
+#endif
+// Set to 0 to only measure the parser, without a sensor.
+#ifndef USE_SENSOR
+#define USE_SENSOR 1
+#endif
+// Port the results are printed on, e.g. Serial1 on boards whose Serial is USB.
+#ifndef RESULT_SERIAL
+#define RESULT_SERIAL Serial
+#endif
+
+#define PARSE_RUNS 100
+#define COMMAND_RUNS 16
+#define SENSOR_TIMEOUT_MS 5000
+// Free RAM above the heap that is not painted, as the measured calls allocate messages.
+#define HEAP_MARGIN 128
+#define STACK_PATTERN 0xC5
+
+#if defined(__AVR__)
+volatile uint16_t cycleOverflows;
+
+ISR(TIMER1_OVF_vect)
+{
+  cycleOverflows++;
+}
+
+void StartCycleCounter()
+{
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1C = 0;
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+  TCCR1B = _BV(CS10);  // F_CPU, no prescaler
+  interrupts();
+}
+
+// Same technique as micros(): an overflow that has not been handled yet is
+// counted if the counter has just wrapped.
+uint32_t ReadCycles()
+{
+  uint8_t oldSreg = SREG;
+  noInterrupts();
+  uint16_t low = TCNT1;
+  uint16_t high = cycleOverflows;
+  if ((TIFR1 & _BV(TOV1)) && (low < 0x8000))
+  {
+    high++;
+  }
+  SREG = oldSreg;
+  return ((uint32_t)high << 16) | low;
+}
+
+extern char __heap_start;
+extern char* __brkval;
+uint8_t* stackBottom;
+uint8_t* stackTop;
+
+// Fills the free RAM between the heap and the stack pointer with the pattern, up
+// to and including the byte that the next push goes to. Always inlined, so that
+// the stack pointer is that of the caller, Measure(), and the stack used by the
+// measured call is counted from its first byte.
+static inline __attribute__((always_inline)) void PaintStack()
+{
+  stackBottom = (uint8_t*)((__brkval != nullptr) ? __brkval : &__heap_start) + HEAP_MARGIN;
+  stackTop = (uint8_t*)SP + 1;
+  for (uint8_t* p = stackBottom; p < stackTop; p++)
+  {
+    *p = STACK_PATTERN;
+  }
+}
+
+uint16_t StackUsed()
+{
+  uint8_t* p = stackBottom;
+  while ((p < stackTop) && (*p == STACK_PATTERN))
+  {
+    p++;
+  }
+  return stackTop - p;
+}
+#define HAS_STACK_MEASUREMENT 1
+#elif defined(DWT_CTRL_CYCCNTENA_Msk)
+void StartCycleCounter()
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t ReadCycles()
+{
+  return DWT->CYCCNT;
+}
+#define HAS_STACK_MEASUREMENT 0
+#else
+void StartCycleCounter()
+{
+}
+
+uint32_t ReadCycles()
+{
+  return micros() * (F_CPU / 1000000UL);
+}
+#define HAS_STACK_MEASUREMENT 0
+#endif
+
+#if !HAS_STACK_MEASUREMENT
+static inline void PaintStack()
+{
+}
+
+uint16_t StackUsed()
+{
+  return 0;
+}
+#endif
+
+#if defined(__AVR_ATmega328P__)
+const char* const board = "atmega328p";
+#elif defined(__AVR_ATmega32U4__)
+const char* const board = "atmega32u4";
+#elif defined(__AVR_ATmega2560__)
+const char* const board = "atmega2560";
+#elif defined(__AVR__)
+const char* const board = "avr";
+#else
+const char* const board = "other";
+#endif
+
+uint32_t overhead;
+uint8_t generated[BUFFER_SIZE];
+// Global rather than on the stack, where its 363 bytes on AVR would be left out
+// of the RAM use reported when building.
+TouchGenerator generator;
+TouchFrame frame;
+Message* lastMessage;
+
+typedef struct Result
+{
+  uint16_t runs;
+  uint32_t minCycles;
+  uint32_t totalCycles;
+  uint32_t maxCycles;
+  uint16_t stack;
+} Result;
+
+void AddSample(Result* result, uint32_t cycles, uint16_t stack)
+{
+  if ((result->runs == 0) || (cycles < result->minCycles))
+  {
+    result->minCycles = cycles;
+  }
+  if (cycles > result->maxCycles)
+  {
+    result->maxCycles = cycles;
+  }
+  if (stack > result->stack)
+  {
+    result->stack = stack;
+  }
+  result->totalCycles += cycles;
+  result->runs++;
+}
+
+// Runs function once and adds its cost to result.
+void Measure(void (*function)(), Result* result)
+{
+  PaintStack();
+  uint32_t start = ReadCycles();
+  function();
+  uint32_t cycles = ReadCycles() - start;
+  uint16_t stack = StackUsed();
+
+  AddSample(result, (cycles > overhead) ? (cycles - overhead) : 0, stack);
+}
+
+void PrintResult(const char* call, uint8_t touches, Result* result)
+{
+  RESULT_SERIAL.print(ZFORCE_LIBRARY_VERSION);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(board);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(call);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(touches);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(result->runs);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(result->minCycles);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(result->runs ? (result->totalCycles / result->runs) : 0);
+  RESULT_SERIAL.print(',');
+  RESULT_SERIAL.print(result->maxCycles);
+  RESULT_SERIAL.print(',');
+  if (HAS_STACK_MEASUREMENT)
+  {
+    RESULT_SERIAL.print(result->stack);
+  }
+  RESULT_SERIAL.println();
+}
+
+void Empty()
+{
+}
+
+// The measured calls. Messages are destroyed outside of the measurement.
+void CallParseMessage()
+{
+  lastMessage = zforce.ParseMessage(generated);
+}
+
+void CallParseTouchFrame()
+{
+  zforce.ParseTouchFrame(generated, &frame, &lastMessage);
+}
+
+void MeasureParser(uint8_t touchCount)
+{
+  generator.ClearFingers();
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    FingerPath path = {PathShape::ELLIPSE, (uint16_t)(500 + i * 300), 1500, 200, 400, 40, 200000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  generator.TouchFormatResponse(generated);
+  zforce.DestroyMessage(zforce.ParseMessage(generated));
+
+  Result message = {0};
+  Result touchFrame = {0};
+  for (uint16_t n = 0; n < PARSE_RUNS; n++)
+  {
+    // Frames without any finger give no message to parse.
+    if (generator.NextMessage(generated) == 0)
+    {
+      continue;
+    }
+    Measure(CallParseMessage, &message);
+    zforce.DestroyMessage(lastMessage);
+    Measure(CallParseTouchFrame, &touchFrame);
+    zforce.DestroyMessage(lastMessage);
+  }
+  PrintResult("ParseMessage", touchCount, &message);
+  PrintResult("ParseTouchFrame", touchCount, &touchFrame);
+}
+
+#if USE_SENSOR
+void CallStart()
+{
+  zforce.Start(DATA_READY);
+}
+
+void CallGetMessage()
+{
+  lastMessage = zforce.GetMessage();
+}
+
+void CallEnable()
+{
+  zforce.Enable(true);
+}
+
+void CallTouchActiveArea()
+{
+  zforce.TouchActiveArea(0, 0, 4000, 4000);
+}
+
+void CallFrequency()
+{
+  zforce.Frequency(10, 100);
+}
+
+void CallReportedTouches()
+{
+  zforce.ReportedTouches(ZFORCE_MAX_TOUCHES);
+}
+
+void CallDetectionMode()
+{
+  zforce.DetectionMode(false, false);
+}
+
+void CallTouchFormat()
+{
+  zforce.TouchFormat();
+}
+
+bool WaitForDataReady()
+{
+  unsigned long start = millis();
+  while (zforce.GetDataReady() == LOW)
+  {
+    if ((millis() - start) > SENSOR_TIMEOUT_MS)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads and drops the response of a command, so that it does not wait in the sensor.
+void DropResponse()
+{
+  if (WaitForDataReady())
+  {
+    zforce.DestroyMessage(zforce.GetMessage());
+  }
+}
+
+void MeasureCommand(const char* call, void (*function)())
+{
+  Result result = {0};
+  for (uint16_t n = 0; n < COMMAND_RUNS; n++)
+  {
+    Measure(function, &result);
+    DropResponse();
+  }
+  PrintResult(call, 0, &result);
+}
+
+// Results of GetMessage() by the number of touches read. Global, for the same
+// reason as generator.
+Result getMessageResults[ZFORCE_MAX_TOUCHES + 1];
+
+// Reads touch notifications from fingers held on the sensor.
+void MeasureGetMessage()
+{
+  uint16_t runs = 0;
+  while ((runs < PARSE_RUNS) && WaitForDataReady())
+  {
+    // Only touch notifications are counted.
+    Result run = {0};
+    Measure(CallGetMessage, &run);
+    if ((lastMessage != nullptr) && (lastMessage->type == MessageType::TOUCHTYPE))
+    {
+      uint8_t touches = ((TouchMessage*)lastMessage)->touchCount;
+      AddSample(&getMessageResults[(touches <= ZFORCE_MAX_TOUCHES) ? touches : ZFORCE_MAX_TOUCHES], run.minCycles, run.stack);
+      runs++;
+    }
+    zforce.DestroyMessage(lastMessage);
+  }
+  for (uint8_t touches = 0; touches <= ZFORCE_MAX_TOUCHES; touches++)
+  {
+    if (getMessageResults[touches].runs > 0)
+    {
+      PrintResult("GetMessage", touches, &getMessageResults[touches]);
+    }
+  }
+}
+#endif
+
+void setup()
+{
+  RESULT_SERIAL.begin(115200);
+  while (!RESULT_SERIAL);
+
+  StartCycleCounter();
+  Result calibration = {0};
+  for (uint8_t n = 0; n < 16; n++)
+  {
+    Measure(Empty, &calibration);
+  }
+  overhead = calibration.minCycles;
+
+  RESULT_SERIAL.println("version,board,call,touches,runs,min_cycles,avg_cycles,max_cycles,stack_bytes");
+
+#if USE_SENSOR
+  Result start = {0};
+  Measure(CallStart, &start);
+  PrintResult("Start", 0, &start);
+
+  MeasureCommand("Enable", CallEnable);
+  MeasureCommand("TouchActiveArea", CallTouchActiveArea);
+  MeasureCommand("Frequency", CallFrequency);
+  MeasureCommand("ReportedTouches", CallReportedTouches);
+  MeasureCommand("DetectionMode", CallDetectionMode);
+  MeasureCommand("TouchFormat", CallTouchFormat);
+  MeasureGetMessage();
+#endif
+
+  // Generated notifications replace the touch descriptor of the sensor, so these run last.
+  const uint8_t touchCounts[] = {1, 5, 10};
+  for (uint8_t i = 0; i < sizeof(touchCounts); i++)
+  {
+    MeasureParser(touchCounts[i]);
+  }
+}
+
+void loop()
+{
+}
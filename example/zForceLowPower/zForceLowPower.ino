@@ -0,0 +1,84 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    This example code is distributed freely.
+    This is an exception from the rest of the library that is released
+    under GNU Lesser General Public License.
+
+    The purpose of this example code is to demonstrate parts of the 
+    library's functionality and capabilities. It is free to use, copy
+    and edit without restrictions.
+
+*/
+
+#include <Zforce.h>
+
+#if !ZFORCE_FEATURE_LOW_POWER
+#error "This example needs ZFORCE_FEATURE_LOW_POWER defined as 1, which is off by default on AVR."
+#endif
+
+// IMPORTANT: change "2" to assigned GPIO digital pin for dataReady signal in your setup.
+// The pin must support external interrupts for the MCU to sleep, e.g. pin 2 or 3 on Arduino Uno.
+#define DATA_READY 2
+
+// Statistics are printed this often, in milliseconds.
+#define REPORT_INTERVAL 10000
+
+uint32_t lastReport = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial) {};
+
+  zforce.Start(DATA_READY);
+  zforce.Enable(true);
+}
+
+void loop()
+{
+  // Sleeps until the sensor signals data ready, but wakes up in time for the next report.
+  Message* msg = zforce.SleepUntilMessage(REPORT_INTERVAL);
+
+  if (msg != nullptr)
+  {
+    if (msg->type == MessageType::TOUCHTYPE)
+    {
+      TouchMessage* touch = (TouchMessage*)msg;
+      for (uint8_t i = 0; i < touch->touchCount; i++)
+      {
+        // Handle the touch here. Avoid printing every touch, as waiting for
+        // Serial keeps the MCU awake.
+      }
+    }
+    zforce.DestroyMessage(msg);
+  }
+
+  uint32_t now = millis();
+  if ((uint32_t)(now - lastReport) >= REPORT_INTERVAL)
+  {
+    LowPowerStatistics statistics = zforce.GetLowPowerStatistics();
+    uint32_t elapsed = (now - lastReport) * 1000;
+
+    // The share of time spent waiting for data ready is an upper bound of the time
+    // asleep, as the MCU also wakes up for other interrupts, such as the millis()
+    // timer, and only calls yield() where it cannot sleep. The latency is what
+    // sleeping costs in response time.
+    Serial.print("waiting: ");
+    Serial.print((uint32_t)(((uint64_t)statistics.waitTime * 100) / elapsed));
+    Serial.print(" %, sleeps: ");
+    Serial.print(statistics.sleeps);
+    Serial.print(", wakeups: ");
+    Serial.print(statistics.wakeups);
+    Serial.print(", messages: ");
+    Serial.print(statistics.messages);
+    Serial.print(", latency avg: ");
+    Serial.print(statistics.messages ? (statistics.latencyTotal / statistics.messages) : 0);
+    Serial.print(" us, max: ");
+    Serial.print(statistics.latencyMax);
+    Serial.println(" us");
+    Serial.flush();
+
+    zforce.ResetLowPowerStatistics();
+    lastReport = now;
+  }
+}
@@ -0,0 +1,52 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    This example code is distributed freely.
+    This is an exception from the rest of the library that is released
+    under GNU Lesser General Public License.
+
+    The purpose of this example code is to demonstrate parts of the 
+    library's functionality and capabilities. It is free to use, copy
+    and edit without restrictions.
+
+*/
+
+#include <Zforce.h>
+#include <TouchStream.h>
+
+// IMPORTANT: change "1" to assigned GPIO digital pin for dataReady signal in your setup:
+#define DATA_READY 1
+
+TouchStreamEncoder encoder;
+TouchFrame frame;
+uint8_t streamBuffer[ZFORCE_STREAM_MAX_FRAME];
+
+void setup()
+{
+  Serial.begin(115200);
+  zforce.Start(DATA_READY);
+
+  zforce.Enable(true);
+
+  // Wait for the enable response before streaming.
+  bool enabled = false;
+  while (!enabled)
+  {
+    Message* msg = zforce.GetMessage();
+    if (msg != nullptr)
+    {
+      enabled = (msg->type == MessageType::ENABLETYPE);
+      zforce.DestroyMessage(msg);
+    }
+  }
+}
+
+void loop()
+{
+  // Touches are forwarded in the binary format described in TouchStream.h, so
+  // nothing else may be printed to Serial. Use TouchStreamDecoder on the PC side.
+  if (zforce.GetTouchFrame(&frame, nullptr))
+  {
+    uint8_t length = encoder.Encode(&frame, streamBuffer);
+    Serial.write(streamBuffer, length);
+  }
+}
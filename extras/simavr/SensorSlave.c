@@ -0,0 +1,331 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+ * Runs a firmware in simavr with a zForce sensor on the TWI bus, and copies what
+ * the firmware prints on a UART to stdout.
+ *
+ * The sensor replays the messages written by SensorStream.cpp, like FakeSensor of
+ * the host tests: messages are sent one after the other, a read continues where
+ * the previous one ended, and the data ready pin is high while anything is left
+ * to send. The boot message is sent after reset. Each request is answered, the
+ * touch format request with the touch format response and any other with the
+ * generic response. After the enable request, touch notifications arrive at
+ * NOTIFICATION_RATE while fewer than MAX_QUEUED messages wait.
+ *
+ * The simulation ends when the firmware has printed nothing for IDLE_SECONDS of
+ * simulated time, or after MAX_SECONDS.
+ *
+ * Usage: SensorSlave firmware.elf mcu stream.txt data-ready-port data-ready-pin uart
+ * e.g.   SensorSlave zForceCycleBenchmark.elf atmega328p stream.txt D 7 0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/avr_twi.h>
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+
+#define SENSOR_ADDRESS 0x50
+#define F_CPU 16000000
+#define NOTIFICATION_RATE 100
+#define MAX_QUEUED 4
+#define MAX_MESSAGES 1024
+#define MAX_MESSAGE_LENGTH 258
+#define IDLE_SECONDS 3
+#define MAX_SECONDS 300
+
+typedef struct Message
+{
+  char kind[32];
+  uint16_t length;
+  uint8_t bytes[MAX_MESSAGE_LENGTH];
+} Message;
+
+typedef struct Sensor
+{
+  avr_t* avr;
+  avr_irq_t* irq;
+  avr_irq_t* dataReady;
+  Message* messages;
+  int messageCount;
+  const Message* boot;
+  const Message* touchFormatRequest;
+  const Message* touchFormatResponse;
+  const Message* enableRequest;
+  const Message* response;
+  int nextNotification;
+  const Message* queue[MAX_QUEUED + 2];
+  int queued;
+  uint16_t position;
+  uint8_t selected;
+  uint8_t written[MAX_MESSAGE_LENGTH];
+  uint16_t writtenLength;
+  int streaming;
+  avr_cycle_count_t lastOutput;
+  int printed;
+} Sensor;
+
+static const char* irqNames[2] = {
+  [TWI_IRQ_INPUT] = "8>zforce.out",
+  [TWI_IRQ_OUTPUT] = "32<zforce.in",
+};
+
+static int ReadStream(Sensor* sensor, const char* path)
+{
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+  {
+    fprintf(stderr, "cannot open %s\n", path);
+    return -1;
+  }
+
+  sensor->messages = calloc(MAX_MESSAGES, sizeof(Message));
+  char line[4096];
+  while ((sensor->messageCount < MAX_MESSAGES) && fgets(line, sizeof(line), file))
+  {
+    Message* message = &sensor->messages[sensor->messageCount];
+    char* token = strtok(line, " \n");
+    if (token == NULL)
+    {
+      continue;
+    }
+    snprintf(message->kind, sizeof(message->kind), "%s", token);
+    while (((token = strtok(NULL, " \n")) != NULL) && (message->length < MAX_MESSAGE_LENGTH))
+    {
+      message->bytes[message->length++] = (uint8_t)strtoul(token, NULL, 16);
+    }
+    sensor->messageCount++;
+  }
+  fclose(file);
+
+  for (int i = 0; i < sensor->messageCount; i++)
+  {
+    const Message* message = &sensor->messages[i];
+    if (!strcmp(message->kind, "boot")) sensor->boot = message;
+    if (!strcmp(message->kind, "touchformat-request")) sensor->touchFormatRequest = message;
+    if (!strcmp(message->kind, "touchformat-response")) sensor->touchFormatResponse = message;
+    if (!strcmp(message->kind, "enable-request")) sensor->enableRequest = message;
+    if (!strcmp(message->kind, "response")) sensor->response = message;
+  }
+  if (!sensor->boot || !sensor->touchFormatRequest || !sensor->touchFormatResponse || !sensor->enableRequest || !sensor->response)
+  {
+    fprintf(stderr, "%s lacks messages\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+static void UpdateDataReady(Sensor* sensor)
+{
+  avr_raise_irq(sensor->dataReady, sensor->queued > 0);
+}
+
+static void Queue(Sensor* sensor, const Message* message)
+{
+  if (sensor->queued < (int)(sizeof(sensor->queue) / sizeof(sensor->queue[0])))
+  {
+    sensor->queue[sensor->queued++] = message;
+  }
+  UpdateDataReady(sensor);
+}
+
+static int Matches(const Sensor* sensor, const Message* request)
+{
+  return (sensor->writtenLength == request->length) && !memcmp(sensor->written, request->bytes, request->length);
+}
+
+static void Answer(Sensor* sensor)
+{
+  if (Matches(sensor, sensor->touchFormatRequest))
+  {
+    Queue(sensor, sensor->touchFormatResponse);
+    return;
+  }
+  if (Matches(sensor, sensor->enableRequest))
+  {
+    sensor->streaming = 1;
+  }
+  Queue(sensor, sensor->response);
+}
+
+static uint8_t Send(Sensor* sensor)
+{
+  if (sensor->queued == 0)
+  {
+    return 0xFF;
+  }
+
+  const Message* message = sensor->queue[0];
+  uint8_t value = message->bytes[sensor->position++];
+  if (sensor->position >= message->length)
+  {
+    sensor->position = 0;
+    sensor->queued--;
+    memmove(&sensor->queue[0], &sensor->queue[1], sensor->queued * sizeof(sensor->queue[0]));
+    UpdateDataReady(sensor);
+  }
+  return value;
+}
+
+static void TwiHook(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+  Sensor* sensor = (Sensor*)param;
+  avr_twi_msg_irq_t v;
+  v.u.v = value;
+
+  if (v.u.twi.msg & TWI_COND_STOP)
+  {
+    if (sensor->selected && !(sensor->selected & 1) && (sensor->writtenLength > 0))
+    {
+      Answer(sensor);
+    }
+    sensor->selected = 0;
+  }
+  if (v.u.twi.msg & TWI_COND_START)
+  {
+    sensor->selected = 0;
+    if ((v.u.twi.addr >> 1) == SENSOR_ADDRESS)
+    {
+      sensor->selected = v.u.twi.addr;
+      sensor->writtenLength = 0;
+      avr_raise_irq(sensor->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, sensor->selected, 1));
+    }
+  }
+  if (sensor->selected)
+  {
+    if (v.u.twi.msg & TWI_COND_WRITE)
+    {
+      avr_raise_irq(sensor->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, sensor->selected, 1));
+      if (sensor->writtenLength < MAX_MESSAGE_LENGTH)
+      {
+        sensor->written[sensor->writtenLength++] = v.u.twi.data;
+      }
+    }
+    if (v.u.twi.msg & TWI_COND_READ)
+    {
+      avr_raise_irq(sensor->irq + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_READ, sensor->selected, Send(sensor)));
+    }
+  }
+}
+
+// Sends the next touch notification at the rate of a sensor.
+static avr_cycle_count_t NotificationTimer(avr_t* avr, avr_cycle_count_t when, void* param)
+{
+  Sensor* sensor = (Sensor*)param;
+  if (sensor->streaming && (sensor->queued < MAX_QUEUED))
+  {
+    for (int i = 0; i < sensor->messageCount; i++)
+    {
+      int index = (sensor->nextNotification + i) % sensor->messageCount;
+      if (!strcmp(sensor->messages[index].kind, "notification"))
+      {
+        Queue(sensor, &sensor->messages[index]);
+        sensor->nextNotification = index + 1;
+        break;
+      }
+    }
+  }
+  return when + avr_usec_to_cycles(avr, 1000000 / NOTIFICATION_RATE);
+}
+
+static void UartHook(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+  Sensor* sensor = (Sensor*)param;
+  putchar((int)value);
+  fflush(stdout);
+  sensor->lastOutput = sensor->avr->cycle;
+  sensor->printed = 1;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 7)
+  {
+    fprintf(stderr, "usage: %s firmware.elf mcu stream.txt data-ready-port data-ready-pin uart\n", argv[0]);
+    return 2;
+  }
+
+  Sensor sensor;
+  memset(&sensor, 0, sizeof(sensor));
+  if (ReadStream(&sensor, argv[3]) != 0)
+  {
+    return 1;
+  }
+
+  elf_firmware_t firmware;
+  memset(&firmware, 0, sizeof(firmware));
+  if (elf_read_firmware(argv[1], &firmware) != 0)
+  {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 1;
+  }
+  avr_t* avr = avr_make_mcu_by_name(argv[2]);
+  if (avr == NULL)
+  {
+    fprintf(stderr, "simavr does not know %s\n", argv[2]);
+    return 1;
+  }
+  avr_init(avr);
+  avr_load_firmware(avr, &firmware);
+  avr->frequency = F_CPU;
+  sensor.avr = avr;
+
+  sensor.irq = avr_alloc_irq(&avr->irq_pool, 0, 2, irqNames);
+  avr_irq_register_notify(sensor.irq + TWI_IRQ_OUTPUT, TwiHook, &sensor);
+  avr_connect_irq(sensor.irq + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+  avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), sensor.irq + TWI_IRQ_OUTPUT);
+  sensor.dataReady = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(argv[4][0]), atoi(argv[5]));
+
+  // The results go to stdout as they are, without the line prefix of simavr.
+  uint32_t flags = 0;
+  avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS(argv[6][0]), &flags);
+  flags &= ~AVR_UART_FLAG_STDIO;
+  avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS(argv[6][0]), &flags);
+  avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ(argv[6][0]), UART_IRQ_OUTPUT), UartHook, &sensor);
+
+  Queue(&sensor, sensor.boot);
+  avr_cycle_timer_register_usec(avr, 1000000 / NOTIFICATION_RATE, NotificationTimer, &sensor);
+
+  int state = cpu_Running;
+  while ((state != cpu_Done) && (state != cpu_Crashed))
+  {
+    state = avr_run(avr);
+    if (sensor.printed && ((avr->cycle - sensor.lastOutput) > (avr_cycle_count_t)IDLE_SECONDS * F_CPU))
+    {
+      break;
+    }
+    if (avr->cycle > (avr_cycle_count_t)MAX_SECONDS * F_CPU)
+    {
+      fprintf(stderr, "%s: no end after %d simulated seconds\n", argv[2], MAX_SECONDS);
+      return 1;
+    }
+  }
+  if (state == cpu_Crashed)
+  {
+    fprintf(stderr, "%s: firmware crashed\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
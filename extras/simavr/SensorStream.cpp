@@ -0,0 +1,83 @@
+/*
+ * Writes the bytes the modelled sensor of SensorSlave.c replays, taken from the
+ * fake sensor of the host tests: the messages the sensor sends, and the requests
+ * the library writes that the sensor answers in particular. One message per line,
+ * its kind followed by its bytes in hex:
+ *
+ *   boot                  sent after reset
+ *   touchformat-request   answered with touchformat-response
+ *   enable-request        answered with response, then notifications follow
+ *   response              the answer to any other request
+ *   notification          touch notifications, with 1, 5 and 10 touches in turn
+ */
+
+#include "Test.h"
+
+#define STREAM_NOTIFICATIONS 600
+
+static Zforce sensor;
+static TouchGenerator generators[3];
+
+static void Write(FILE* file, const char* kind, const uint8_t* bytes, size_t length)
+{
+  fprintf(file, "%s", kind);
+  for (size_t i = 0; i < length; i++)
+  {
+    fprintf(file, " %02X", bytes[i]);
+  }
+  fprintf(file, "\n");
+}
+
+// Writes the last request the library wrote.
+static void WriteRequest(FILE* file, const char* kind)
+{
+  CHECK(!fakeSensor.written.empty());
+  Write(file, kind, fakeSensor.written.back().data(), fakeSensor.written.back().size());
+  fakeSensor.written.clear();
+}
+
+int main(int argc, char** argv)
+{
+  FILE* file = (argc > 1) ? fopen(argv[1], "w") : stdout;
+  if (file == nullptr)
+  {
+    printf("cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  uint8_t buffer[BUFFER_SIZE];
+  Write(file, "boot", buffer, generators[0].BootComplete(buffer));
+  Write(file, "touchformat-response", buffer, generators[0].TouchFormatResponse(buffer));
+  std::vector<uint8_t> response = SensorMessage(0xEF, {0x65, 0x03, 0x81, 0x01, 0x00});
+  Write(file, "response", response.data(), response.size());
+
+  StartSensor(&sensor, &generators[0]);
+  sensor.TouchFormat();
+  WriteRequest(file, "touchformat-request");
+  // Enable(true) first sets the operation mode and waits for the response.
+  fakeSensor.Queue(response);
+  CHECK(sensor.Enable(true));
+  WriteRequest(file, "enable-request");
+
+  const uint8_t touchCounts[] = {1, 5, 10};
+  for (uint8_t g = 0; g < 3; g++)
+  {
+    for (uint8_t i = 0; i < touchCounts[g]; i++)
+    {
+      FingerPath path = {PathShape::ELLIPSE, (uint16_t)(500 + i * 300), 1500, 200, 400, 40, 200000, 0, 0, 0};
+      generators[g].SetFinger(i, &path);
+    }
+  }
+  for (uint16_t n = 0; n < STREAM_NOTIFICATIONS; n++)
+  {
+    uint8_t length = generators[n % 3].NextMessage(buffer);
+    CHECK(length > 0);
+    Write(file, "notification", buffer, length);
+  }
+
+  if (file != stdout)
+  {
+    fclose(file);
+  }
+  return testFailures ? 1 : 0;
+}
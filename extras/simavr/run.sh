@@ -0,0 +1,110 @@
+#!/bin/sh
+# Builds the zForceCycleBenchmark example with avr-g++ for ATmega328P and ATmega32U4
+# and runs it in simavr. SensorSlave.c puts a sensor on the I2C bus, replaying the
+# messages that SensorStream.cpp takes from the fake sensor of the host tests. The
+# results are appended to a CSV file, by default simavr-<library version>.csv in
+# the current folder. Without simavr, only the firmware is built and its size printed.
+#
+# The Arduino AVR core is taken from ARDUINO_AVR_CORE, by default the newest one
+# installed by the Arduino IDE or arduino-cli in ~/.arduino15. AVR_PREFIX is put
+# before avr-g++, avr-gcc and avr-size. simavr is found with pkg-config, or with
+# SIMAVR_CFLAGS and SIMAVR_LIBS.
+# Usage: extras/simavr/run.sh [results.csv], with CXX set to use another host compiler than g++.
+version=$(sed -n 's/^#define ZFORCE_LIBRARY_VERSION "\(.*\)"/\1/p' "$(dirname "$0")/../../src/Zforce.h")
+results=${1:-simavr-$version.csv}
+case $results in
+  /*) ;;
+  *) results="$(pwd)/$results" ;;
+esac
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+AVR_GXX=${AVR_PREFIX}avr-g++
+AVR_GCC=${AVR_PREFIX}avr-gcc
+AVR_SIZE=${AVR_PREFIX}avr-size
+
+if ! command -v "$AVR_GXX" > /dev/null; then
+  echo "avr-g++ not found"
+  exit 1
+fi
+core=${ARDUINO_AVR_CORE:-$(ls -d "$HOME"/.arduino15/packages/arduino/hardware/avr/* 2> /dev/null | sort -V | tail -n 1)}
+if [ ! -d "$core/cores/arduino" ]; then
+  echo "Arduino AVR core not found, set ARDUINO_AVR_CORE"
+  exit 1
+fi
+
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+# Builds the sketch for an MCU, with the flags of the Arduino IDE: mcu variant flags...
+build() {
+  mcu=$1
+  variant=$2
+  shift 2
+  objects=$out/$mcu
+  mkdir -p "$objects"
+  sed '1i #include <Arduino.h>' ../../example/zForceCycleBenchmark/zForceCycleBenchmark.ino > "$objects/zForceCycleBenchmark.cpp"
+  common="-mmcu=$mcu -DF_CPU=16000000L -DARDUINO=10819 -DARDUINO_ARCH_AVR -Os -g -ffunction-sections -fdata-sections \
+    -I$core/cores/arduino -I$core/variants/$variant -I../../src"
+  for source in "$core"/cores/arduino/*.c "$core"/cores/arduino/*.cpp "$core"/cores/arduino/*.S \
+      ../../src/*.cpp ../../src/I2C/*.cpp "$objects/zForceCycleBenchmark.cpp"; do
+    [ -f "$source" ] || continue
+    object=$objects/$(basename "$source").o
+    case $source in
+      *.c) $AVR_GCC $common "$@" -std=gnu11 -c -o "$object" "$source" ;;
+      *.S) $AVR_GCC $common "$@" -x assembler-with-cpp -c -o "$object" "$source" ;;
+      *) $AVR_GXX $common "$@" -std=gnu++11 -fpermissive -fno-exceptions -fno-threadsafe-statics \
+           -Wno-error=narrowing -c -o "$object" "$source" ;;
+    esac || return 1
+  done
+  $AVR_GCC -mmcu="$mcu" -Os -Wl,--gc-sections -o "$out/$mcu.elf" "$objects"/*.o -lm || return 1
+  $AVR_SIZE "$out/$mcu.elf"
+}
+
+# The sensor's data ready goes to digital pin 7, PD7 on the Uno and PE6 on the
+# Leonardo. The Leonardo prints on Serial1, as its Serial is USB.
+failed=0
+build atmega328p standard -DARDUINO_AVR_UNO -DDATA_READY=7 || { echo "atmega328p: build FAILED"; failed=1; }
+build atmega32u4 leonardo -DARDUINO_AVR_LEONARDO -DUSB_VID=0x2341 -DUSB_PID=0x8036 \
+  '-DUSB_MANUFACTURER="Unknown"' '-DUSB_PRODUCT="Leonardo"' -DDATA_READY=7 -DRESULT_SERIAL=Serial1 \
+  || { echo "atmega32u4: build FAILED"; failed=1; }
+[ $failed -eq 0 ] || exit 1
+
+if pkg-config --exists simavr 2> /dev/null; then
+  SIMAVR_CFLAGS=${SIMAVR_CFLAGS:-$(pkg-config --cflags simavr)}
+  SIMAVR_LIBS=${SIMAVR_LIBS:-$(pkg-config --libs simavr)}
+elif [ -z "$SIMAVR_LIBS" ]; then
+  for prefix in /usr /usr/local; do
+    if [ -f "$prefix/include/simavr/sim_avr.h" ]; then
+      SIMAVR_CFLAGS="-I$prefix/include"
+      SIMAVR_LIBS="-L$prefix/lib -lsimavr -lelf"
+    fi
+  done
+fi
+if [ -z "$SIMAVR_LIBS" ]; then
+  echo "simavr not found"
+  exit 0
+fi
+
+$CXX -std=gnu++11 -DARDUINO=10819 -I../test/fake -I../test -I../../src -include Arduino.h \
+  -o "$out/SensorStream" SensorStream.cpp ../test/fake/*.cpp ../../src/*.cpp -lpthread || exit 1
+"$out/SensorStream" "$out/stream.txt" || exit 1
+${CC:-gcc} -std=gnu99 -O2 $SIMAVR_CFLAGS -o "$out/SensorSlave" SensorSlave.c $SIMAVR_LIBS || exit 1
+
+run() {
+  mcu=$1
+  if ! "$out/SensorSlave" "$out/$mcu.elf" "$mcu" "$out/stream.txt" "$2" "$3" "$4" > "$out/$mcu.out"; then
+    echo "$mcu: simulation FAILED"
+    failed=1
+  fi
+  tr -d '\r' < "$out/$mcu.out" > "$out/$mcu.csv"
+  cat "$out/$mcu.csv"
+  if [ -s "$results" ]; then
+    grep -v '^version,' "$out/$mcu.csv" >> "$results"
+  else
+    cat "$out/$mcu.csv" > "$results"
+  fi
+}
+run atmega328p D 7 0
+run atmega32u4 E 6 1
+echo "Results appended to $results"
+exit $failed
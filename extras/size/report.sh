@@ -0,0 +1,73 @@
+#!/bin/sh
+# Builds Zforce.o once per combination of ZFORCE_FEATURE_* flags and prints the flash
+# (text) and RAM (data + bss) it takes, and the difference to the default build.
+# With avr-g++ the library is built for an ATmega328P against the Arduino AVR core,
+# taken from ARDUINO_AVR_CORE or else the newest one in ~/.arduino15, and measured
+# with avr-size. AVR_PREFIX is put before avr-g++ and avr-size. Otherwise it is
+# built for the host against the fake Arduino core of the host tests, and measured
+# with size, which only compares the configurations with each other.
+# Usage: extras/size/report.sh, with CXX set to use another host compiler than g++.
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+AVR_GXX=${AVR_PREFIX}avr-g++
+AVR_SIZE=${AVR_PREFIX}avr-size
+
+core=${ARDUINO_AVR_CORE:-$(ls -d "$HOME"/.arduino15/packages/arduino/hardware/avr/* 2> /dev/null | sort -V | tail -n 1)}
+if command -v "$AVR_GXX" > /dev/null && [ -d "$core/cores/arduino" ]; then
+  platform="atmega328p"
+  SIZE=$AVR_SIZE
+  compile() {
+    $AVR_GXX -mmcu=atmega328p -DF_CPU=16000000L -DARDUINO=10819 -DARDUINO_ARCH_AVR -DARDUINO_AVR_UNO \
+      -Os -std=gnu++11 -fpermissive -fno-exceptions -fno-threadsafe-statics -ffunction-sections -fdata-sections \
+      -I"$core/cores/arduino" -I"$core/variants/standard" -I"$core/libraries/Wire/src" -I../../src "$@"
+  }
+else
+  platform="host (avr-g++ or the Arduino AVR core not found)"
+  SIZE=size
+  compile() {
+    $CXX -std=gnu++11 -Os -DARDUINO=10819 -I../test/fake -I../../src -include Arduino.h "$@"
+  }
+fi
+
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+features="AREA_CONFIGURATION DETECTION_CONFIGURATION PLATFORM_INFORMATION TOUCH_FILTER LOW_POWER RAW_MESSAGES"
+
+# Prints the text and data + bss of Zforce.o built with the given flags.
+measure() {
+  compile "$@" -c -o "$out/Zforce.o" ../../src/Zforce.cpp || return 1
+  $SIZE "$out/Zforce.o" | awk 'NR == 2 { print $1, $2 + $3 }'
+}
+
+# One line per configuration: the default, each feature left out and added on its
+# own, as TOUCH_FILTER and LOW_POWER default to 0 on AVR, and all features out or in.
+report() {
+  name=$1
+  shift
+  if ! sizes=$(measure "$@"); then
+    echo "$name: build FAILED"
+    failed=1
+    return
+  fi
+  set -- $sizes
+  [ -n "$baseText" ] || { baseText=$1; baseRam=$2; }
+  printf '%-40s %8s %8s %+8d %+8d\n' "$name" "$1" "$2" $(($1 - baseText)) $(($2 - baseRam))
+}
+
+echo "Zforce.o on $platform"
+printf '%-40s %8s %8s %8s %8s\n' configuration flash ram "+flash" "+ram"
+failed=0
+baseText=
+report default
+none=
+all=
+for feature in $features; do
+  report "ZFORCE_FEATURE_$feature=0" -DZFORCE_FEATURE_$feature=0
+  report "ZFORCE_FEATURE_$feature=1" -DZFORCE_FEATURE_$feature=1
+  none="$none -DZFORCE_FEATURE_$feature=0"
+  all="$all -DZFORCE_FEATURE_$feature=1"
+done
+report "all features 0" $none
+report "all features 1" $all
+exit $failed
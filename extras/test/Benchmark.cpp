@@ -0,0 +1,214 @@
+/*
+ * Measures the whole path of a touch notification, from the i2c transfer through
+ * parsing to the touches delivered, with GetMessage(), GetTouchFrame() and
+ * GetTouchFrameView() reading from the fake sensor. benchmark.sh builds it once
+ * per transport and touch decoder, and it appends its results to the CSV file
+ * given as argument, one line per run:
+ *
+ *   version,transport,decoder,mode,touches,frames,frames_per_second,cpu_ns_per_frame,
+ *   p50_ns,p99_ns,max_ns,transactions_per_frame,bytes_per_frame,bus_us_per_frame
+ *
+ * cpu_ns_per_frame is the CPU time of the call, and the percentiles are of its
+ * wall time. The fake bus moves bytes instantly, so bus_us_per_frame is the time
+ * the transactions and bytes would take at the bus frequency the library set,
+ * with 9 clocks per byte and one more for the start and stop of a transaction.
+ * frames_per_second is what the CPU and the bus together can sustain.
+ */
+
+#include "Test.h"
+#include <algorithm>
+#include <chrono>
+#include <time.h>
+
+#ifndef BENCHMARK_TRANSPORT
+#define BENCHMARK_TRANSPORT "wire"
+#endif
+#define BENCHMARK_FRAMES 20000
+
+enum ReadMode : uint8_t
+{
+  MESSAGE,
+  FRAME,
+  VIEW
+};
+static const char* const modeNames[] = {"message", "frame", "view"};
+
+static Zforce sensor;
+static TouchGenerator generator;
+static TouchFrame frame;
+static TouchFrameView view;
+static std::vector<std::vector<uint8_t>> notifications;
+static std::vector<uint32_t> latencies;
+// Touches are summed here so that delivering them cannot be optimized away.
+static volatile uint32_t touchSink;
+
+static uint64_t CpuNanoseconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static uint64_t WallNanoseconds()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t Percentile(uint8_t percent)
+{
+  size_t index = (latencies.size() * percent + 99) / 100;
+  index = (index > 0) ? (index - 1) : 0;
+  std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+  return latencies[index];
+}
+
+// Reads one notification and delivers its touches. Returns whether it was one.
+static bool ReadTouches(ReadMode mode)
+{
+  if (mode == FRAME)
+  {
+    Message* msg;
+    bool isTouch = sensor.GetTouchFrame(&frame, &msg);
+    for (uint8_t i = 0; isTouch && (i < frame.touchCount); i++)
+    {
+      touchSink = touchSink + frame.x[i];
+    }
+    sensor.DestroyMessage(msg);
+    return isTouch;
+  }
+  if (mode == VIEW)
+  {
+    Message* msg;
+    bool isTouch = sensor.GetTouchFrameView(&view, &msg);
+    if (isTouch)
+    {
+      for (const TouchData& touch : view)
+      {
+        touchSink = touchSink + touch.x;
+      }
+    }
+    sensor.DestroyMessage(msg);
+    return isTouch;
+  }
+
+  Message* msg = sensor.GetMessage();
+  bool isTouch = (msg != nullptr) && (msg->type == MessageType::TOUCHTYPE);
+  for (uint8_t i = 0; isTouch && (i < ((TouchMessage*)msg)->touchCount); i++)
+  {
+    touchSink = touchSink + ((TouchMessage*)msg)->touchData[i].x;
+  }
+  sensor.DestroyMessage(msg);
+  return isTouch;
+}
+
+static void Generate(uint8_t touchCount)
+{
+  generator.ClearFingers();
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    FingerPath path = {PathShape::ELLIPSE, (uint16_t)(500 + i * 300), 1500, 200, 400, 40, 200000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+
+  uint8_t payload[BUFFER_SIZE];
+  notifications.clear();
+  while (notifications.size() < BENCHMARK_FRAMES)
+  {
+    uint8_t length = generator.NextMessage(payload);
+    if (length > 0)
+    {
+      notifications.push_back(std::vector<uint8_t>(payload, payload + length));
+    }
+  }
+}
+
+static void Run(FILE* results, ReadMode mode, uint8_t touchCount, uint64_t overhead)
+{
+  fakeSensor.readTransactions = 0;
+  fakeSensor.writeTransactions = 0;
+  fakeSensor.bytesRead = 0;
+  fakeSensor.bytesWritten = 0;
+  latencies.clear();
+  uint64_t cpu = 0;
+  uint32_t frames = 0;
+
+  for (size_t n = 0; n < notifications.size(); n++)
+  {
+    // Queueing copies the message, which is left out of the measurement.
+    fakeSensor.Queue(notifications[n]);
+    uint64_t wallStart = WallNanoseconds();
+    uint64_t cpuStart = CpuNanoseconds();
+    bool isTouch = ReadTouches(mode);
+    uint64_t cpuEnd = CpuNanoseconds();
+    uint64_t wallEnd = WallNanoseconds();
+    CHECK(isTouch);
+
+    uint64_t latency = wallEnd - wallStart;
+    latencies.push_back((uint32_t)((latency > overhead) ? (latency - overhead) : 0));
+    cpu += cpuEnd - cpuStart;
+    frames++;
+  }
+  cpu = (cpu > overhead * frames) ? (cpu - overhead * frames) : 0;
+
+  double transactions = (double)(fakeSensor.readTransactions + fakeSensor.writeTransactions) / frames;
+  double bytes = (double)(fakeSensor.bytesRead + fakeSensor.bytesWritten) / frames;
+  double busMicroseconds = (transactions * 10 + bytes * 9) * 1000000.0 / fakeSensor.frequency;
+  double cpuNanoseconds = (double)cpu / frames;
+  uint32_t maxLatency = *std::max_element(latencies.begin(), latencies.end());
+  uint32_t p50 = Percentile(50);
+  uint32_t p99 = Percentile(99);
+
+  fprintf(results, "%s,%s,%s,%s,%u,%u,%.0f,%.1f,%u,%u,%u,%.2f,%.1f,%.1f\n",
+          ZFORCE_LIBRARY_VERSION, BENCHMARK_TRANSPORT, ZFORCE_FAST_TOUCH_DECODERS ? "fast" : "generic",
+          modeNames[mode], touchCount, frames, 1000000000.0 / (cpuNanoseconds + busMicroseconds * 1000.0),
+          cpuNanoseconds, p50, p99, maxLatency, transactions, bytes, busMicroseconds);
+  printf("%s %s %-7s %2u touches: %7.1f ns CPU, p99 %u ns, %.1f us on the bus\n", BENCHMARK_TRANSPORT,
+         ZFORCE_FAST_TOUCH_DECODERS ? "fast" : "generic", modeNames[mode], touchCount, cpuNanoseconds, p99, busMicroseconds);
+}
+
+// Cost of reading both clocks around an empty call, subtracted from the measurements.
+static uint64_t MeasureOverhead()
+{
+  uint64_t overhead = UINT64_MAX;
+  for (uint16_t n = 0; n < 1000; n++)
+  {
+    uint64_t wallStart = WallNanoseconds();
+    uint64_t cpuStart = CpuNanoseconds();
+    uint64_t cpuEnd = CpuNanoseconds();
+    uint64_t wallEnd = WallNanoseconds();
+    uint64_t cost = ((wallEnd - wallStart) < (cpuEnd - cpuStart)) ? (wallEnd - wallStart) : (cpuEnd - cpuStart);
+    overhead = (cost < overhead) ? cost : overhead;
+  }
+  return overhead;
+}
+
+int main(int argc, char** argv)
+{
+  const char* path = (argc > 1) ? argv[1] : "benchmark.csv";
+  FILE* results = fopen(path, "a");
+  if (results == nullptr)
+  {
+    printf("cannot open %s\n", path);
+    return 1;
+  }
+  if (ftell(results) == 0)
+  {
+    fprintf(results, "version,transport,decoder,mode,touches,frames,frames_per_second,cpu_ns_per_frame,"
+                     "p50_ns,p99_ns,max_ns,transactions_per_frame,bytes_per_frame,bus_us_per_frame\n");
+  }
+
+  StartSensor(&sensor, &generator);
+  uint64_t overhead = MeasureOverhead();
+  const uint8_t touchCounts[] = {1, 5, 10};
+  for (uint8_t t = 0; t < sizeof(touchCounts); t++)
+  {
+    Generate(touchCounts[t]);
+    for (uint8_t mode = MESSAGE; mode <= VIEW; mode++)
+    {
+      Run(results, (ReadMode)mode, touchCounts[t], overhead);
+    }
+  }
+
+  fclose(results);
+  return TEST_RESULT();
+}
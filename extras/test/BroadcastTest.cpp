@@ -0,0 +1,211 @@
+// FLAGS: -O2 -fsanitize=thread -Wno-tsan
+/*
+ * Tests of TouchFrameBroadcast. A producer thread publishes frames as fast as it
+ * can to subscribers on threads of their own, two that skip and one that is dropped
+ * when falling behind. Every frame accepted by Release() must be intact and the one
+ * expected next, and the received, skipped and overrun frames of a subscriber must
+ * add up to the frames published. Built with ThreadSanitizer, which reports any data
+ * race besides the reads of a frame that may be overwritten, see CopyFrame().
+ */
+
+#include "Test.h"
+#include "TouchFrameBroadcast.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define FRAMES 100000UL
+#define SKIPPING 2
+
+static void Fill(TouchFrame* frame, uint32_t sequence)
+{
+  memset(frame, 0, sizeof(TouchFrame));
+  frame->timestamp = sequence;
+  frame->touchCount = (uint8_t)(sequence % ZFORCE_MAX_TOUCHES) + 1;
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    frame->x[i] = (TouchCoordinate)(sequence + i);
+    frame->y[i] = (TouchCoordinate)(sequence ^ i);
+    frame->id[i] = i;
+  }
+}
+
+static bool Intact(const TouchFrame* frame, uint32_t sequence)
+{
+  TouchFrame expected;
+  Fill(&expected, sequence);
+  return memcmp(frame, &expected, sizeof(TouchFrame)) == 0;
+}
+
+/*
+ * A frame may be overwritten while it is copied, which is only known when it is
+ * released. This is the data race of a seqlock, so the copy is left out of the
+ * checks of ThreadSanitizer, and made byte by byte so it is not turned into memcpy.
+ */
+__attribute__((no_sanitize("thread")))
+static void CopyFrame(TouchFrame* to, const TouchFrame* from)
+{
+  const volatile uint8_t* source = (const volatile uint8_t*)from;
+  uint8_t* destination = (uint8_t*)to;
+  for (size_t i = 0; i < sizeof(TouchFrame); i++)
+  {
+    destination[i] = source[i];
+  }
+}
+
+static void TestFallingBehind()
+{
+  TouchFrameBroadcast broadcast;
+  int8_t skipping = broadcast.Subscribe(BroadcastPolicy::SKIP);
+  int8_t dropping = broadcast.Subscribe(BroadcastPolicy::DROP);
+  TouchFrame frame;
+  for (uint32_t sequence = 0; sequence < 20; sequence++)
+  {
+    Fill(&frame, sequence);
+    broadcast.Publish(&frame);
+  }
+
+  // The oldest frame left is the next one to be overwritten, so reading starts after it.
+  const TouchFrame* next = broadcast.Peek(skipping);
+  CHECK((next != nullptr) && Intact(next, 20 - ZFORCE_BROADCAST_SIZE + 1));
+  CHECK(broadcast.Release(skipping));
+  SubscriberStatistics statistics = broadcast.GetStatistics(skipping);
+  CHECK(statistics.skipped == 20 - ZFORCE_BROADCAST_SIZE + 1);
+  CHECK(statistics.received == 1);
+
+  CHECK(broadcast.Peek(dropping) == nullptr);
+  CHECK(broadcast.GetStatistics(dropping).dropped);
+  Fill(&frame, 20);
+  broadcast.Publish(&frame);
+  CHECK(broadcast.Peek(dropping) == nullptr);
+}
+
+static TouchFrameBroadcast broadcast;
+static std::atomic<bool> published(false);
+
+// Every other frame is copied in with Publish, the others are written in place.
+static void Produce()
+{
+  TouchFrame frame;
+  for (uint32_t sequence = 0; sequence < FRAMES; sequence++)
+  {
+    if (sequence & 1)
+    {
+      Fill(broadcast.BeginPublish(), sequence);
+      broadcast.CommitPublish();
+    }
+    else
+    {
+      Fill(&frame, sequence);
+      broadcast.Publish(&frame);
+    }
+    // Lets the subscribers keep up now and then, so they also read frames.
+    if ((sequence % 4) == 3)
+    {
+      std::this_thread::yield();
+    }
+  }
+  published = true;
+}
+
+typedef struct Result
+{
+  uint32_t accepted;
+  uint32_t rejected;
+  uint32_t corrupted;  // accepted frames that were not intact or not the next one
+} Result;
+
+static Result results[ZFORCE_BROADCAST_MAX_SUBSCRIBERS];
+
+// Reads until all frames are published and read, or the subscriber is dropped. The
+// frames read and skipped so far give the number of the frame expected next.
+static void Subscribe(int8_t subscriber)
+{
+  Result* result = &results[subscriber];
+  TouchFrame frame;
+  for (uint32_t n = 0; ; n++)
+  {
+    bool finished = published;
+    const TouchFrame* slot = broadcast.Peek(subscriber);
+    if (slot == nullptr)
+    {
+      if (finished || broadcast.GetStatistics(subscriber).dropped)
+      {
+        break;
+      }
+      std::this_thread::yield();
+      continue;
+    }
+
+    SubscriberStatistics statistics = broadcast.GetStatistics(subscriber);
+    uint32_t expected = statistics.received + statistics.skipped + statistics.overruns;
+    CopyFrame(&frame, slot);
+    // Now and then stall while reading, so that the producer overwrites the frame
+    // and laps the subscriber.
+    if ((n % 256) == (uint32_t)subscriber)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (broadcast.Release(subscriber))
+    {
+      result->accepted++;
+      result->corrupted += !Intact(&frame, expected);
+    }
+    else
+    {
+      result->rejected++;
+    }
+  }
+}
+
+static void TestStress()
+{
+  int8_t ids[SKIPPING + 1];
+  for (uint8_t i = 0; i < SKIPPING; i++)
+  {
+    ids[i] = broadcast.Subscribe(BroadcastPolicy::SKIP);
+  }
+  ids[SKIPPING] = broadcast.Subscribe(BroadcastPolicy::DROP);
+
+  std::thread subscribers[SKIPPING + 1];
+  for (uint8_t i = 0; i <= SKIPPING; i++)
+  {
+    subscribers[i] = std::thread(Subscribe, ids[i]);
+  }
+  std::thread producer(Produce);
+  producer.join();
+  for (uint8_t i = 0; i <= SKIPPING; i++)
+  {
+    subscribers[i].join();
+  }
+
+  CHECK(broadcast.GetPublished() == FRAMES);
+  for (uint8_t i = 0; i <= SKIPPING; i++)
+  {
+    SubscriberStatistics statistics = broadcast.GetStatistics(ids[i]);
+    Result* result = &results[ids[i]];
+    uint32_t total = statistics.received + statistics.skipped + statistics.overruns;
+    CHECK(result->corrupted == 0);
+    CHECK(statistics.received == result->accepted);
+    CHECK(statistics.overruns == result->rejected);
+    if (statistics.dropped)
+    {
+      CHECK(i == SKIPPING);
+      CHECK(total < FRAMES);
+    }
+    else
+    {
+      CHECK(total == FRAMES);
+    }
+    printf("%s subscriber: received %lu, skipped %lu, overruns %lu%s\n", (i < SKIPPING) ? "skipping" : "dropping",
+           (unsigned long)statistics.received, (unsigned long)statistics.skipped, (unsigned long)statistics.overruns,
+           statistics.dropped ? ", dropped" : "");
+  }
+}
+
+int main()
+{
+  TestFallingBehind();
+  TestStress();
+  return TEST_RESULT();
+}
@@ -0,0 +1,196 @@
+/*
+ * Retries and bus recovery of Read() and Write(), with faults injected by the
+ * fake sensor.
+ */
+
+#include "Test.h"
+#include <Wire.h>
+
+static Zforce sensor;
+static TouchGenerator generator;
+static uint8_t payload[BUFFER_SIZE];
+
+static void Setup()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  sensor.ResetBusStatistics();
+}
+
+// A response long enough to be read in two chunks of the Wire buffer.
+static std::vector<uint8_t> LongMessage()
+{
+  std::vector<uint8_t> body = {0x6C, 0x24, 0xA0, 0x22, 0x8A, 0x20};
+  for (uint8_t i = 0; i < 0x20; i++)
+  {
+    body.push_back(i);
+  }
+  return SensorMessage(0xEF, body);
+}
+
+static bool ReadMatches(const std::vector<uint8_t>& message)
+{
+  return memcmp(payload, message.data(), message.size()) == 0;
+}
+
+static void TestCleanRead()
+{
+  Setup();
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+  CHECK(fakeSensor.readTransactions == 3);  // header and two chunks
+  CHECK(!fakeSensor.DataReady());
+}
+
+// A touch notification with 10 touches spans several Wire buffers, and each
+// chunk continues where the previous transaction ended.
+static void TestTouchNotificationAcrossChunks()
+{
+  Setup();
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    FingerPath path = {PathShape::STILL, (uint16_t)(100 * i + 10), (uint16_t)(50 * i + 20), 0, 0, 40, 1000000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  uint8_t message[BUFFER_SIZE];
+  uint8_t length = generator.NextMessage(message);
+  CHECK(length > 3 * BUFFER_LENGTH);
+  fakeSensor.Queue(std::vector<uint8_t>(message, message + length));
+
+  TouchFrame frame;
+  CHECK(sensor.GetTouchFrame(&frame, nullptr));
+  CHECK(fakeSensor.readTransactions == (uint32_t)(1 + (length - 2 + BUFFER_LENGTH - 1) / BUFFER_LENGTH));
+  CHECK(frame.touchCount == 10);
+  for (uint8_t i = 0; i < frame.touchCount; i++)
+  {
+    CHECK(frame.x[i] == (TouchCoordinate)(100 * frame.id[i] + 10));
+    CHECK(frame.y[i] == (TouchCoordinate)(50 * frame.id[i] + 20));
+  }
+  generator.ClearFingers();
+}
+
+// A NACK only means that the sensor is busy, so the bus is not recovered.
+static void TestNackRetry()
+{
+  Setup();
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::NACK_ADDRESS, 2);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+
+  BusStatistics statistics = sensor.GetBusStatistics();
+  CHECK(statistics.nacks == 2);
+  CHECK(statistics.retries == 2);
+  CHECK(statistics.recoveries == 0);
+  CHECK(statistics.failedTransactions == 0);
+  CHECK(fakeSensor.clockPulses == 0);
+}
+
+static void TestWriteGivesUp()
+{
+  Setup();
+  fakeSensor.InjectFault(FakeFault::NACK_DATA, ZFORCE_I2C_RETRIES + 1);
+  CHECK(!sensor.GetEnable());
+  CHECK(fakeSensor.writeTransactions == ZFORCE_I2C_RETRIES + 1);
+
+  BusStatistics statistics = sensor.GetBusStatistics();
+  CHECK(statistics.nacks == ZFORCE_I2C_RETRIES + 1);
+  CHECK(statistics.retries == ZFORCE_I2C_RETRIES);
+  CHECK(statistics.failedTransactions == 1);
+  CHECK(statistics.lastError == 3);
+
+  // The next write goes through.
+  CHECK(sensor.GetEnable());
+  CHECK(fakeSensor.written.size() == 1);
+}
+
+// A timeout in the middle of a message recovers the bus, and the message is read
+// again from its header, which the sensor starts over with.
+static void TestTimeoutRestartsFromHeader()
+{
+  Setup();
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::TIMEOUT, 1, 0, 2);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+  CHECK(fakeSensor.readTransactions == 6);
+
+  BusStatistics statistics = sensor.GetBusStatistics();
+  CHECK(statistics.timeouts == 1);
+  CHECK(statistics.recoveries == 1);
+  CHECK(statistics.failedTransactions == 0);
+  CHECK(fakeSensor.clockPulses == 0);  // SDA was not held
+  CHECK(fakeSensor.stopConditions == 1);
+}
+
+// SCL is clocked until the sensor releases SDA, then a STOP is sent.
+static void TestStuckSda()
+{
+  Setup();
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::STUCK_SDA, 1, 5, 1);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+  CHECK(fakeSensor.clockPulses == 5);
+  CHECK(fakeSensor.stopConditions == 1);
+  CHECK(sensor.GetBusStatistics().recoveries == 1);
+}
+
+// At most 9 pulses are given per recovery, the next attempt recovers again.
+static void TestStuckSdaLongerThanOneByte()
+{
+  Setup();
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::STUCK_SDA, 1, 12);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+  CHECK(fakeSensor.clockPulses == 12);
+  CHECK(sensor.GetBusStatistics().recoveries == 2);
+}
+
+static void TestStuckSdaGivesUp()
+{
+  Setup();
+  fakeSensor.Queue(LongMessage());
+  fakeSensor.InjectFault(FakeFault::STUCK_SDA, 1, 100);
+  CHECK(sensor.Read(payload) == 5);
+  CHECK(fakeSensor.clockPulses == 9 * ZFORCE_I2C_RETRIES);
+
+  BusStatistics statistics = sensor.GetBusStatistics();
+  CHECK(statistics.recoveries == ZFORCE_I2C_RETRIES);
+  CHECK(statistics.retries == ZFORCE_I2C_RETRIES);
+  CHECK(statistics.timeouts == ZFORCE_I2C_RETRIES + 1);
+  CHECK(statistics.failedTransactions == 1);
+}
+
+// A short read of the payload is retried from the header.
+static void TestShortRead()
+{
+  Setup();
+  std::vector<uint8_t> message = SensorMessage(0xEF, {0x65, 0x03, 0x81, 0x01, 0x00});
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::SHORT_READ, 1, 0, 1);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(ReadMatches(message));
+  CHECK(sensor.GetBusStatistics().otherErrors == 1);
+}
+
+int main()
+{
+  TestCleanRead();
+  TestTouchNotificationAcrossChunks();
+  TestNackRetry();
+  TestWriteGivesUp();
+  TestTimeoutRestartsFromHeader();
+  TestStuckSda();
+  TestStuckSdaLongerThanOneByte();
+  TestStuckSdaGivesUp();
+  TestShortRead();
+  return TEST_RESULT();
+}
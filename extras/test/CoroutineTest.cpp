@@ -0,0 +1,95 @@
+// FLAGS: -std=c++20 -fcoroutines
+/*
+ * Requests through ZforceDevice and ZforceEventLoop against the fake sensor.
+ */
+
+#include "Test.h"
+#include "ZforceCoroutine.h"
+
+static int completed = 0;
+static int destroyed = 0;
+
+struct DestroyCounter
+{
+  ~DestroyCounter() { destroyed++; }
+};
+
+ZforceTask EnableTask(ZforceDevice* device)
+{
+  auto enable = co_await device->Enable(true);
+  CHECK(enable && enable->enabled);
+  completed++;
+}
+
+ZforceTask FrequencyTask(ZforceDevice* device)
+{
+  DestroyCounter counter;
+  auto frequency = co_await device->GetFrequency();
+  completed++;
+}
+
+// Enable() is sent as two requests, without blocking the event loop in between.
+static void TestEnable()
+{
+  fakeSensor.Reset();
+  Zforce sensor;
+  TouchGenerator generator;
+  StartSensor(&sensor, &generator);
+  ZforceDevice device(&sensor);
+  ZforceEventLoop loop;
+  loop.Add(&device);
+
+  completed = 0;
+  EnableTask(&device);
+  loop.RunOnce();
+  CHECK(fakeSensor.written.size() == 1);
+  CHECK(fakeSensor.written.back()[8] == 0x67);  // operation mode
+
+  loop.RunOnce();
+  loop.RunOnce();
+  CHECK(fakeSensor.written.size() == 1);
+  CHECK(completed == 0);
+
+  fakeSensor.Queue(SensorMessage(0xEF, {0x67, 0x03, 0x80, 0x01, 0x00}));
+  loop.RunOnce();
+  loop.RunOnce();
+  CHECK(fakeSensor.written.size() == 2);
+  CHECK(fakeSensor.written.back()[8] == 0x65);  // enable
+  CHECK(completed == 0);
+
+  fakeSensor.Queue(SensorMessage(0xEF, {0x65, 0x03, 0x81, 0x01, 0x00}));
+  loop.Run();
+  CHECK(completed == 1);
+}
+
+// Coroutines waiting for a device are destroyed with it, whether their requests were sent or not.
+static void TestDestroyDevice()
+{
+  fakeSensor.Reset();
+  Zforce sensor;
+  TouchGenerator generator;
+  StartSensor(&sensor, &generator);
+
+  completed = 0;
+  destroyed = 0;
+  {
+    ZforceDevice device(&sensor);
+    ZforceEventLoop loop;
+    loop.Add(&device);
+    for (uint8_t i = 0; i < ZFORCE_MAX_PENDING_REQUESTS + 1; i++)
+    {
+      FrequencyTask(&device);
+    }
+    loop.RunOnce();
+    CHECK(fakeSensor.written.size() == ZFORCE_MAX_PENDING_REQUESTS);
+  }
+  CHECK(completed == 0);
+  CHECK(destroyed == ZFORCE_MAX_PENDING_REQUESTS + 1);
+}
+
+int main()
+{
+  TestEnable();
+  TestDestroyDevice();
+  return TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+// FLAGS: -O2
+/*
+ * Touch decoding for a descriptor without SizeX. Fields missing from the
+ * descriptor are 0, with the specialized decoders as well as the generic one
+ * (GenericDecoderTest.cpp). The time of ParseTouchFrame() for 1, 5 and 10 touches
+ * is printed, for comparing the decoders; the cost of each touch should be the
+ * same however many there are.
+ */
+
+#include "Test.h"
+#include <chrono>
+
+#define TIMED_MESSAGES 64
+#define TIMED_ROUNDS 20000
+
+static Zforce sensor;
+static TouchGenerator generator;
+
+static void TestDescriptorWithoutSize()
+{
+  static const TouchDescriptor descriptor[] = {TouchDescriptor::Id, TouchDescriptor::Event,
+                                               TouchDescriptor::LocXByte1, TouchDescriptor::LocXByte2,
+                                               TouchDescriptor::LocYByte1, TouchDescriptor::LocYByte2};
+  CHECK(generator.SetTouchFormat(descriptor, sizeof(descriptor)));
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    FingerPath path = {PathShape::STILL, (uint16_t)(1000 + i), (uint16_t)(2000 + i), 0, 0, 40, 1000000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  uint8_t payload[BUFFER_SIZE];
+  CHECK(generator.NextMessage(payload) > 0);
+
+  TouchFrame frame;
+  memset(&frame, 0xAA, sizeof(frame));
+  Message* other = nullptr;
+  CHECK(sensor.ParseTouchFrame(payload, &frame, &other));
+  CHECK(other == nullptr);
+  CHECK(frame.touchCount == 3);
+  for (uint8_t i = 0; i < frame.touchCount; i++)
+  {
+    CHECK(frame.x[i] == (TouchCoordinate)(1000 + frame.id[i]));
+    CHECK(frame.y[i] == (TouchCoordinate)(2000 + frame.id[i]));
+    CHECK(frame.sizeX[i] == 0);
+    CHECK(frame.event[i] == TouchEvent::DOWN);
+  }
+
+  Message* msg = sensor.ParseMessage(payload);
+  CHECK((msg != nullptr) && (msg->type == MessageType::TOUCHTYPE));
+  TouchMessage* touches = (TouchMessage*)msg;
+  CHECK(touches->touchCount == 3);
+  for (uint8_t i = 0; i < touches->touchCount; i++)
+  {
+    CHECK(touches->touchData[i].sizeX == 0);
+  }
+  sensor.DestroyMessage(msg);
+}
+
+// Returns the time per ParseTouchFrame() call, for notifications with touchCount fingers.
+static double NanosecondsPerFrame(uint8_t touchCount)
+{
+  generator.ClearFingers();
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    FingerPath path = {PathShape::LISSAJOUS, (uint16_t)(400 + i * 320), 2000, 300, 900, 40, 700000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  static uint8_t payloads[TIMED_MESSAGES][BUFFER_SIZE];
+  for (uint8_t n = 0; n < TIMED_MESSAGES; n++)
+  {
+    CHECK(generator.NextMessage(payloads[n]) > 0);
+  }
+
+  TouchFrame frame;
+  Message* other;
+  uint32_t touches = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < TIMED_ROUNDS; round++)
+  {
+    for (uint8_t n = 0; n < TIMED_MESSAGES; n++)
+    {
+      sensor.ParseTouchFrame(payloads[n], &frame, &other);
+      touches += frame.touchCount;
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  CHECK(touches == (uint32_t)TIMED_ROUNDS * TIMED_MESSAGES * touchCount);
+  return elapsed.count() / ((double)TIMED_ROUNDS * TIMED_MESSAGES);
+}
+
+static void TestParseTime()
+{
+  static const uint8_t touchCounts[] = {1, 5, 10};
+  double perFrame[sizeof(touchCounts)];
+  for (uint8_t i = 0; i < sizeof(touchCounts); i++)
+  {
+    perFrame[i] = NanosecondsPerFrame(touchCounts[i]);
+  }
+  printf("ParseTouchFrame, %s decoder:", ZFORCE_FAST_TOUCH_DECODERS ? "fast" : "generic");
+  for (uint8_t i = 0; i < sizeof(touchCounts); i++)
+  {
+    printf(" %u touches %.1f ns (%.1f ns per touch)%s", touchCounts[i], perFrame[i], perFrame[i] / touchCounts[i],
+           ((size_t)(i + 1) < sizeof(touchCounts)) ? "," : "");
+  }
+  // The added cost of each touch from 1 to 5 and from 5 to 10 touches.
+  printf("; %.1f and %.1f ns per added touch\n", (perFrame[1] - perFrame[0]) / 4, (perFrame[2] - perFrame[1]) / 5);
+}
+
+int main()
+{
+  TestDescriptorWithoutSize();
+  TestParseTime();
+  return TEST_RESULT();
+}
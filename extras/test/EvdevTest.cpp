@@ -0,0 +1,198 @@
+/*
+ * Event sequences of TouchEvdevEncoder for contacts starting, moving and ending,
+ * after a failed write to the sink, and with all slots in use.
+ */
+
+#include "Test.h"
+#include "TouchEvdev.h"
+
+// Fails the next writes, and keeps the events of the others.
+class FailingSink : public EvdevMemorySink
+{
+	public:
+		FailingSink() : failures(0) {}
+		bool Write(const EvdevEvent* events, uint8_t count)
+		{
+			if (failures > 0)
+			{
+				failures--;
+				return false;
+			}
+			return EvdevMemorySink::Write(events, count);
+		}
+		uint8_t failures;
+};
+
+static FailingSink sink;
+static TouchEvdevEncoder encoder;
+static TouchFrame frame;
+
+static void Start()
+{
+  encoder = TouchEvdevEncoder();
+  encoder.SetSink(&sink);
+  sink.Clear();
+  sink.failures = 0;
+  memset(&frame, 0, sizeof(frame));
+}
+
+static void SetTouch(uint8_t index, uint8_t id, TouchEvent event, TouchCoordinate x, TouchCoordinate y, TouchCoordinate size)
+{
+  frame.id[index] = id;
+  frame.event[index] = event;
+  frame.x[index] = x;
+  frame.y[index] = y;
+  frame.sizeX[index] = size;
+  frame.touchCount = (index >= frame.touchCount) ? (index + 1) : frame.touchCount;
+}
+
+static bool SentExactly(const std::vector<EvdevEvent>& expected)
+{
+  bool same = (sink.count == expected.size());
+  for (uint16_t i = 0; same && (i < sink.count); i++)
+  {
+    same = (sink.events[i].type == expected[i].type) && (sink.events[i].code == expected[i].code) &&
+           (sink.events[i].value == expected[i].value);
+  }
+  if (!same)
+  {
+    for (uint16_t i = 0; i < sink.count; i++)
+    {
+      printf("  sent %u %#x %d\n", sink.events[i].type, sink.events[i].code, (int)sink.events[i].value);
+    }
+  }
+  sink.Clear();
+  return same;
+}
+
+static bool Sent(uint16_t type, uint16_t code, int32_t value)
+{
+  for (uint16_t i = 0; i < sink.count; i++)
+  {
+    if ((sink.events[i].type == type) && (sink.events[i].code == code) && (sink.events[i].value == value))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void TestContacts()
+{
+  Start();
+  SetTouch(0, 4, TouchEvent::DOWN, 100, 200, 30);
+  SetTouch(1, 7, TouchEvent::DOWN, 300, 400, 40);
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, 0},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, 0},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_X, 100},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_Y, 200},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TOUCH_MAJOR, 30},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, 1},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, 1},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_X, 300},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_Y, 400},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TOUCH_MAJOR, 40},
+    {ZFORCE_EV_KEY, ZFORCE_BTN_TOUCH, 1},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_X, 100},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_Y, 200},
+    {ZFORCE_EV_SYN, ZFORCE_SYN_REPORT, 0}}));
+
+  // Only the axis that changed is sent, in the slot of the touch.
+  SetTouch(0, 4, TouchEvent::MOVE, 110, 200, 30);
+  SetTouch(1, 7, TouchEvent::MOVE, 300, 400, 40);
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, 0},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_X, 110},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_X, 110},
+    {ZFORCE_EV_SYN, ZFORCE_SYN_REPORT, 0}}));
+
+  // A frame without changes sends nothing.
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({}));
+
+  SetTouch(0, 4, TouchEvent::UP, 110, 200, 30);
+  SetTouch(1, 7, TouchEvent::UP, 300, 400, 40);
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, -1},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, 1},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, -1},
+    {ZFORCE_EV_KEY, ZFORCE_BTN_TOUCH, 0},
+    {ZFORCE_EV_SYN, ZFORCE_SYN_REPORT, 0}}));
+
+  TouchEvdevStatistics statistics = encoder.GetStatistics();
+  CHECK(statistics.reports == 3);
+  CHECK(statistics.contacts == 2);
+  CHECK(statistics.events == 23);
+  CHECK(statistics.sinkErrors == 0);
+}
+
+// After a failed write, the next frame sends the tracking id of every slot and all
+// axes again, as the kernel may have missed any of them.
+static void TestFailedWriteResyncs()
+{
+  Start();
+  sink.failures = 1;
+  SetTouch(0, 2, TouchEvent::DOWN, 100, 200, 30);
+  CHECK(!encoder.Update(&frame));
+  CHECK(sink.count == 0);
+  CHECK(encoder.GetStatistics().sinkErrors == 1);
+
+  SetTouch(0, 2, TouchEvent::MOVE, 100, 200, 30);
+  CHECK(encoder.Update(&frame));
+  CHECK((sink.count > 0) && (sink.events[0].code == ZFORCE_ABS_MT_SLOT) && (sink.events[0].value == 0));
+  CHECK((sink.count > 1) && (sink.events[1].code == ZFORCE_ABS_MT_TRACKING_ID) && (sink.events[1].value == 0));
+  for (uint8_t slot = 1; slot < ZFORCE_EVDEV_SLOTS; slot++)
+  {
+    CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, slot));
+  }
+  CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, -1));
+  CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_X, 100));
+  CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_Y, 200));
+  CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TOUCH_MAJOR, 30));
+  CHECK(Sent(ZFORCE_EV_KEY, ZFORCE_BTN_TOUCH, 1));
+  CHECK(Sent(ZFORCE_EV_ABS, ZFORCE_ABS_X, 100));
+  CHECK((sink.count > 0) && (sink.events[sink.count - 1].type == ZFORCE_EV_SYN));
+  sink.Clear();
+
+  // Once resynced, only changes are sent again.
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({}));
+}
+
+static void TestAllSlotsInUse()
+{
+  Start();
+  for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+  {
+    SetTouch(i, i, TouchEvent::DOWN, 100 + i, 200, 30);
+  }
+  CHECK(encoder.Update(&frame));
+  CHECK(encoder.GetStatistics().contacts == ZFORCE_EVDEV_SLOTS);
+  sink.Clear();
+
+  // A new touch while every slot holds a contact is dropped, the others go on.
+  memset(&frame, 0, sizeof(frame));
+  SetTouch(0, ZFORCE_EVDEV_SLOTS, TouchEvent::DOWN, 500, 500, 30);
+  SetTouch(1, 0, TouchEvent::MOVE, 150, 200, 30);
+  CHECK(encoder.Update(&frame));
+  CHECK(SentExactly({
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, 0},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_MT_POSITION_X, 150},
+    {ZFORCE_EV_ABS, ZFORCE_ABS_X, 150},
+    {ZFORCE_EV_SYN, ZFORCE_SYN_REPORT, 0}}));
+  TouchEvdevStatistics statistics = encoder.GetStatistics();
+  CHECK(statistics.droppedTouches == 1);
+  CHECK(statistics.contacts == ZFORCE_EVDEV_SLOTS);
+}
+
+int main()
+{
+  TestContacts();
+  TestFailedWriteResyncs();
+  TestAllSlotsInUse();
+  return TEST_RESULT();
+}
@@ -0,0 +1,102 @@
+/*
+ * The touch filter checks the fields it needs whatever the touch field mask,
+ * and skips conditions on fields that the sensor does not report.
+ */
+
+#include "Test.h"
+
+static Zforce sensor;
+static TouchGenerator generator;
+static uint8_t payload[BUFFER_SIZE];
+
+// Sets up fingers with id i at x 1000 + 1000 * i, and writes their notification to payload.
+static void Fingers(uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    FingerPath path = {PathShape::STILL, (uint16_t)(1000 + 1000 * i), 500, 0, 0, 40, 1000000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  CHECK(generator.NextMessage(payload) > 0);
+}
+
+static uint8_t ParseCount(TouchFrame* frame)
+{
+  Message* other = nullptr;
+  CHECK(sensor.ParseTouchFrame(payload, frame, &other));
+  return frame->touchCount;
+}
+
+static void TestInitTouchFilter()
+{
+  generator = TouchGenerator();
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  Fingers(3);
+
+  TouchFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  sensor.SetTouchFilter(&filter);
+  TouchFrame frame;
+  CHECK(ParseCount(&frame) == 0);
+
+  InitTouchFilter(&filter);
+  sensor.SetTouchFilter(&filter);
+  CHECK(ParseCount(&frame) == 3);
+  sensor.SetTouchFilter(nullptr);
+}
+
+// The area is checked even when X and Y are not delivered.
+static void TestFilterWithFieldMask()
+{
+  generator = TouchGenerator();
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  Fingers(3);
+  sensor.SetTouchFieldMask(TOUCHFIELD_ID | TOUCHFIELD_EVENT);
+
+  TouchFilter filter;
+  InitTouchFilter(&filter);
+  filter.minX = 1500;
+  sensor.SetTouchFilter(&filter);
+  TouchFrame frame;
+  CHECK(ParseCount(&frame) == 2);
+  CHECK((frame.id[0] == 1) && (frame.id[1] == 2));
+
+  sensor.SetTouchFilter(nullptr);
+  sensor.SetTouchFieldMask(TOUCHFIELD_ALL);
+}
+
+// Without SizeX in the descriptor, the size condition is not checked.
+static void TestFilterWithoutSize()
+{
+  static const TouchDescriptor descriptor[] = {TouchDescriptor::Id, TouchDescriptor::Event,
+                                               TouchDescriptor::LocXByte1, TouchDescriptor::LocXByte2,
+                                               TouchDescriptor::LocYByte1, TouchDescriptor::LocYByte2};
+  generator = TouchGenerator();
+  CHECK(generator.SetTouchFormat(descriptor, sizeof(descriptor)));
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  Fingers(3);
+
+  TouchFilter filter;
+  InitTouchFilter(&filter);
+  filter.minSizeX = 10;
+  filter.maxX = 2500;
+  sensor.SetTouchFilter(&filter);
+  sensor.ResetTouchFilterStatistics();
+  TouchFrame frame;
+  CHECK(ParseCount(&frame) == 2);
+  TouchFilterStatistics statistics = sensor.GetTouchFilterStatistics();
+  CHECK(statistics.rejectedSize == 0);
+  CHECK(statistics.rejectedArea == 1);
+  sensor.SetTouchFilter(nullptr);
+}
+
+int main()
+{
+  TestInitTouchFilter();
+  TestFilterWithFieldMask();
+  TestFilterWithoutSize();
+  return TEST_RESULT();
+}
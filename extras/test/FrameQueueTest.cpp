@@ -0,0 +1,210 @@
+// FLAGS: -O2 -fsanitize=thread -Wno-tsan
+/*
+ * Stress tests of TouchFrameQueue with a producer and a consumer thread. Every
+ * frame must arrive once, in order and intact, with both the copying and the
+ * zero-copy calls, and when a reader thread decodes frames from the simulated
+ * sensor into the queue at 5 kHz. Built with ThreadSanitizer, which reports any
+ * data race on the slots or indexes.
+ */
+
+#include "Test.h"
+#include "TouchFrameQueue.h"
+#include <chrono>
+#include <thread>
+
+#define FRAMES 200000UL
+#define SENSOR_FRAMES 5000UL
+#define SENSOR_RATE 5000UL
+
+static TouchFrameQueue queue;
+
+static void Fill(TouchFrame* frame, uint32_t sequence)
+{
+  frame->timestamp = sequence;
+  frame->touchCount = (uint8_t)(sequence % ZFORCE_MAX_TOUCHES) + 1;
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    frame->x[i] = (TouchCoordinate)(sequence + i);
+    frame->y[i] = (TouchCoordinate)(sequence ^ i);
+    frame->id[i] = i;
+  }
+}
+
+static bool Intact(const TouchFrame* frame, uint32_t sequence)
+{
+  if ((frame->timestamp != sequence) || (frame->touchCount != (uint8_t)(sequence % ZFORCE_MAX_TOUCHES) + 1))
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    if ((frame->x[i] != (TouchCoordinate)(sequence + i)) || (frame->y[i] != (TouchCoordinate)(sequence ^ i)) ||
+        (frame->id[i] != i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Even frames are copied in with Push, odd ones decoded in place.
+static void Produce()
+{
+  TouchFrame frame;
+  for (uint32_t sequence = 0; sequence < FRAMES; )
+  {
+    if (sequence & 1)
+    {
+      TouchFrame* slot = queue.BeginPush();
+      if (slot == nullptr)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      Fill(slot, sequence);
+      queue.CommitPush();
+    }
+    else
+    {
+      Fill(&frame, sequence);
+      if (!queue.Push(&frame))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+    }
+    sequence++;
+  }
+}
+
+static uint32_t corrupted = 0;
+
+// Alternates between Pop and Peek/Release, independently of the producer.
+static void Consume()
+{
+  TouchFrame frame;
+  for (uint32_t sequence = 0; sequence < FRAMES; )
+  {
+    if (sequence % 3 == 0)
+    {
+      const TouchFrame* slot = queue.Peek();
+      if (slot == nullptr)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      corrupted += !Intact(slot, sequence);
+      queue.Release();
+    }
+    else
+    {
+      if (!queue.Pop(&frame))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      corrupted += !Intact(&frame, sequence);
+    }
+    sequence++;
+  }
+}
+
+static void TestStress()
+{
+  std::thread consumer(Consume);
+  std::thread producer(Produce);
+  producer.join();
+  consumer.join();
+
+  CHECK(corrupted == 0);
+  CHECK(queue.Count() == 0);
+  FrameQueueStatistics statistics = queue.GetStatistics();
+  CHECK(statistics.pushed == FRAMES);
+  CHECK(statistics.popped == FRAMES);
+  CHECK(statistics.highWater <= ZFORCE_FRAME_QUEUE_SIZE);
+  printf("%lu frames, full %lu, empty %lu, high water %u\n", FRAMES, (unsigned long)statistics.full,
+         (unsigned long)statistics.empty, statistics.highWater);
+}
+
+static Zforce sensor;
+static TouchGenerator generator;
+static TouchFrameQueue sensorQueue;
+
+// The reader thread owns the bus, and decodes each notification straight into a slot.
+static void ReadSensor()
+{
+  uint8_t message[BUFFER_SIZE];
+  auto next = std::chrono::steady_clock::now();
+  for (uint32_t n = 0; n < SENSOR_FRAMES; n++)
+  {
+    next += std::chrono::microseconds(1000000UL / SENSOR_RATE);
+    std::this_thread::sleep_until(next);
+
+    uint8_t length = generator.NextMessage(message);
+    fakeSensor.Queue(std::vector<uint8_t>(message, message + length));
+    TouchFrame* slot;
+    while ((slot = sensorQueue.BeginPush()) == nullptr)
+    {
+      std::this_thread::yield();
+    }
+    if (sensor.GetTouchFrame(slot, nullptr))
+    {
+      sensorQueue.CommitPush();
+    }
+  }
+}
+
+static uint32_t sensorFrames = 0;
+static uint32_t sensorErrors = 0;
+
+static void ConsumeSensor()
+{
+  uint32_t period = 1000000UL / SENSOR_RATE;
+  uint32_t expected = period;
+  while (sensorFrames < SENSOR_FRAMES)
+  {
+    const TouchFrame* frame = sensorQueue.Peek();
+    if (frame == nullptr)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+    sensorErrors += (frame->timestamp != expected) || (frame->touchCount != 3);
+    expected += period;
+    sensorFrames++;
+    sensorQueue.Release();
+  }
+}
+
+static void TestSimulatedSensor()
+{
+  generator.SetTimestampLength(4);
+  generator.SetFrameRate(SENSOR_RATE);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    FingerPath path = {PathShape::ELLIPSE, (uint16_t)(1000 + 500 * i), 1500, 200, 300, 40, 100000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+
+  std::thread consumer(ConsumeSensor);
+  std::thread reader(ReadSensor);
+  reader.join();
+  consumer.join();
+
+  CHECK(sensorFrames == SENSOR_FRAMES);
+  CHECK(sensorErrors == 0);
+  FrameQueueStatistics statistics = sensorQueue.GetStatistics();
+  CHECK(statistics.pushed == SENSOR_FRAMES);
+  CHECK(statistics.popped == SENSOR_FRAMES);
+  printf("%lu sensor frames at %lu Hz, full %lu, high water %u\n", SENSOR_FRAMES, SENSOR_RATE,
+         (unsigned long)statistics.full, statistics.highWater);
+}
+
+int main()
+{
+  TestStress();
+  TestSimulatedSensor();
+  return TEST_RESULT();
+}
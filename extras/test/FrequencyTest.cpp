@@ -0,0 +1,52 @@
+// FLAGS: -DZFORCE_I2C_FALLBACK_WINDOW=2 -DZFORCE_I2C_FALLBACK_ERRORS=1
+/*
+ * Automatic lowering of the bus frequency happens between messages, not between
+ * the transactions of one message.
+ */
+
+#include "Test.h"
+
+static Zforce sensor;
+static TouchGenerator generator;
+static uint8_t payload[BUFFER_SIZE];
+
+// A response long enough to be read in two chunks of the Wire buffer.
+static std::vector<uint8_t> LongMessage()
+{
+  std::vector<uint8_t> body = {0x6C, 0x24, 0xA0, 0x22, 0x8A, 0x20};
+  for (uint8_t i = 0; i < 0x20; i++)
+  {
+    body.push_back(i);
+  }
+  return SensorMessage(0xEF, body);
+}
+
+static void TestFallbackBetweenMessages()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  sensor.SetBusFrequency(400000);
+  fakeSensor.midMessageFrequencyChanges = 0;
+
+  // The window fills up with the retried header, before the payload is read.
+  std::vector<uint8_t> message = LongMessage();
+  fakeSensor.Queue(message);
+  fakeSensor.InjectFault(FakeFault::NACK_ADDRESS, 1);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(memcmp(payload, message.data(), message.size()) == 0);
+  CHECK(sensor.GetBusFrequencyStatus().frequency == 400000);
+
+  fakeSensor.Queue(message);
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(memcmp(payload, message.data(), message.size()) == 0);
+  CHECK(sensor.GetBusFrequencyStatus().frequency == 200000);
+  CHECK(sensor.GetBusFrequencyStatus().fallbacks == 1);
+  CHECK(fakeSensor.frequency == 200000);
+  CHECK(fakeSensor.midMessageFrequencyChanges == 0);
+}
+
+int main()
+{
+  TestFallbackBetweenMessages();
+  return TEST_RESULT();
+}
@@ -0,0 +1,6 @@
+// FLAGS: -O2 -DZFORCE_FAST_TOUCH_DECODERS=0
+/*
+ * DecoderTest with the generic touch decoder.
+ */
+
+#include "DecoderTest.cpp"
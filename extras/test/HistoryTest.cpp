@@ -0,0 +1,112 @@
+// FLAGS: -fsanitize=undefined -fno-sanitize-recover=undefined
+/*
+ * Velocities of TouchHistory at the edges of the 32 bit range and for samples
+ * that share a time.
+ */
+
+#include "Test.h"
+#include "TouchHistory.h"
+
+static TouchHistory history;
+
+static void Update(uint8_t id, TouchEvent event, TouchCoordinate x, TouchCoordinate y, uint32_t time)
+{
+  TouchFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.touchCount = 1;
+  frame.id[0] = id;
+  frame.event[0] = event;
+  frame.x[0] = x;
+  frame.y[0] = y;
+  history.Update(&frame, time);
+}
+
+static void TestLargeChangeDoesNotOverflow()
+{
+  TouchMotion motion;
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 0, 0, 0);
+  Update(0, TouchEvent::MOVE, 60000, 100, 1);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == 60000000);
+  CHECK(motion.velocityY == 100000);
+
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 60000, 0, 0);
+  Update(0, TouchEvent::MOVE, 0, 0, 1);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == -60000000);
+
+#if !ZFORCE_PACKED_TOUCH_DATA
+  // 3 million units in 1 ms is beyond the range of the velocity.
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 0, 0, 0);
+  Update(0, TouchEvent::MOVE, 3000000, 0, 1);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == INT32_MAX);
+#endif
+}
+
+#if !ZFORCE_PACKED_TOUCH_DATA
+// The rates of the two halves are clamped to the range of int32_t, and their
+// difference must not overflow, nor coordinates above 2^31 turn negative.
+static void TestClampedRatesDoNotOverflow()
+{
+  TouchMotion motion;
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 3000000, 0, 0);
+  Update(0, TouchEvent::MOVE, 0, 0, 1);
+  Update(0, TouchEvent::MOVE, 3000000, 0, 2);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == 0);
+  CHECK(motion.accelerationX == 2000000000);
+
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 0, 3000000000UL, 0);
+  Update(0, TouchEvent::MOVE, 3000000000UL, 0, 1);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == INT32_MAX);
+  CHECK(motion.velocityY == INT32_MIN);
+  Update(0, TouchEvent::MOVE, 3000000000UL, 3000000000UL, 2);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == INT32_MAX);
+  CHECK(motion.velocityY == 0);
+  CHECK(motion.accelerationX == -2000000000);
+  CHECK(motion.accelerationY == 2000000000);
+}
+#endif
+
+static void TestSameTime()
+{
+  TouchMotion motion;
+  history.Reset();
+  Update(0, TouchEvent::DOWN, 0, 0, 0);
+  Update(0, TouchEvent::MOVE, 10, 0, 10);
+  Update(0, TouchEvent::MOVE, 20, 0, 20);
+  CHECK(history.GetMotion(0, &motion));
+  CHECK(motion.velocityX == 1000);
+  CHECK(motion.accelerationX == 0);
+
+  // Touches read in the same millisecond as the previous one give no velocity of
+  // their own, so the previous one is carried forward.
+  history.Reset();
+  Update(1, TouchEvent::DOWN, 0, 0, 5);
+  Update(1, TouchEvent::MOVE, 10, 0, 5);
+  CHECK(history.GetMotion(1, &motion));
+  CHECK(motion.x == 10);
+  CHECK(motion.velocityX == 0);
+  CHECK(motion.samples == 2);
+  Update(1, TouchEvent::MOVE, 20, 0, 15);
+  CHECK(history.GetMotion(1, &motion));
+  CHECK(motion.velocityX == 2000);
+}
+
+int main()
+{
+  TestLargeChangeDoesNotOverflow();
+#if !ZFORCE_PACKED_TOUCH_DATA
+  TestClampedRatesDoNotOverflow();
+#endif
+  TestSameTime();
+  return TEST_RESULT();
+}
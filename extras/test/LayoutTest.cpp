@@ -0,0 +1,162 @@
+// FLAGS: -O2
+/*
+ * Transform and gesture loops over the touches of a notification, on the array of
+ * TouchData in a TouchMessage and on the array per field in a TouchFrame. Both
+ * must give the same results. The time per frame of each is printed, for
+ * comparing the layouts; PackedLayoutTest.cpp runs the same with
+ * ZFORCE_PACKED_TOUCH_DATA.
+ */
+
+#include "Test.h"
+#include <chrono>
+
+#define LAYOUT_FRAMES 64
+#define LAYOUT_ROUNDS 20000
+#define SENSOR_WIDTH 4000
+#define SCREEN_WIDTH 1280
+
+typedef struct GestureResult
+{
+  uint32_t centerX;
+  uint32_t centerY;
+  uint32_t spread;
+} GestureResult;
+
+static Zforce sensor;
+static TouchGenerator generator;
+static TouchMessage* messages[LAYOUT_FRAMES];
+static TouchFrame frames[LAYOUT_FRAMES];
+static volatile uint32_t sink;
+
+// Maps sensor coordinates to screen pixels.
+static uint32_t TransformMessage(const TouchMessage* msg)
+{
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    sum += (msg->touchData[i].x * SCREEN_WIDTH) / SENSOR_WIDTH;
+    sum += (msg->touchData[i].y * SCREEN_WIDTH) / SENSOR_WIDTH;
+  }
+  return sum;
+}
+
+static uint32_t TransformFrame(const TouchFrame* frame)
+{
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    sum += (frame->x[i] * SCREEN_WIDTH) / SENSOR_WIDTH;
+  }
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    sum += (frame->y[i] * SCREEN_WIDTH) / SENSOR_WIDTH;
+  }
+  return sum;
+}
+
+// Center and spread of all touches, e.g. for pinch and pan.
+static GestureResult GestureMessage(const TouchMessage* msg)
+{
+  GestureResult result = {0, 0, 0};
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    result.centerX += msg->touchData[i].x;
+    result.centerY += msg->touchData[i].y;
+  }
+  result.centerX /= msg->touchCount;
+  result.centerY /= msg->touchCount;
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    int32_t dx = (int32_t)msg->touchData[i].x - (int32_t)result.centerX;
+    int32_t dy = (int32_t)msg->touchData[i].y - (int32_t)result.centerY;
+    result.spread += (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+  }
+  return result;
+}
+
+static GestureResult GestureFrame(const TouchFrame* frame)
+{
+  GestureResult result = {0, 0, 0};
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    result.centerX += frame->x[i];
+    result.centerY += frame->y[i];
+  }
+  result.centerX /= frame->touchCount;
+  result.centerY /= frame->touchCount;
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    int32_t dx = (int32_t)frame->x[i] - (int32_t)result.centerX;
+    int32_t dy = (int32_t)frame->y[i] - (int32_t)result.centerY;
+    result.spread += (dx < 0 ? -dx : dx) + (dy < 0 ? -dy : dy);
+  }
+  return result;
+}
+
+static void Setup()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  for (uint8_t i = 0; i < ZFORCE_MAX_TOUCHES; i++)
+  {
+    FingerPath path = {PathShape::LISSAJOUS, (uint16_t)(400 + i * 320), 2000, 300, 900, 40, 700000, 0, 0, 0};
+    generator.SetFinger(i, &path);
+  }
+
+  uint8_t payload[BUFFER_SIZE];
+  for (uint8_t n = 0; n < LAYOUT_FRAMES; n++)
+  {
+    CHECK(generator.NextMessage(payload) > 0);
+    Message* other = nullptr;
+    CHECK(sensor.ParseTouchFrame(payload, &frames[n], &other));
+    Message* msg = sensor.ParseMessage(payload);
+    CHECK((msg != nullptr) && (msg->type == MessageType::TOUCHTYPE));
+    messages[n] = (TouchMessage*)msg;
+    CHECK(messages[n]->touchCount == ZFORCE_MAX_TOUCHES);
+  }
+}
+
+template <typename Function>
+static double NanosecondsPerFrame(Function function)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < LAYOUT_ROUNDS; round++)
+  {
+    for (uint8_t n = 0; n < LAYOUT_FRAMES; n++)
+    {
+      sink = sink + function(n);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ((double)LAYOUT_ROUNDS * LAYOUT_FRAMES);
+}
+
+static void TestLayouts()
+{
+  Setup();
+  for (uint8_t n = 0; n < LAYOUT_FRAMES; n++)
+  {
+    CHECK(TransformMessage(messages[n]) == TransformFrame(&frames[n]));
+    GestureResult a = GestureMessage(messages[n]);
+    GestureResult b = GestureFrame(&frames[n]);
+    CHECK((a.centerX == b.centerX) && (a.centerY == b.centerY) && (a.spread == b.spread));
+  }
+
+  double transformMessage = NanosecondsPerFrame([](uint8_t n) { return TransformMessage(messages[n]); });
+  double transformFrame = NanosecondsPerFrame([](uint8_t n) { return TransformFrame(&frames[n]); });
+  double gestureMessage = NanosecondsPerFrame([](uint8_t n) { return GestureMessage(messages[n]).spread; });
+  double gestureFrame = NanosecondsPerFrame([](uint8_t n) { return GestureFrame(&frames[n]).spread; });
+  printf("TouchData %u bytes, %u touches: transform %.1f ns message, %.1f ns frame; gesture %.1f ns message, %.1f ns frame\n",
+         (unsigned)sizeof(TouchData), ZFORCE_MAX_TOUCHES, transformMessage, transformFrame, gestureMessage, gestureFrame);
+
+  for (uint8_t n = 0; n < LAYOUT_FRAMES; n++)
+  {
+    sensor.DestroyMessage(messages[n]);
+  }
+}
+
+int main()
+{
+  TestLayouts();
+  return TEST_RESULT();
+}
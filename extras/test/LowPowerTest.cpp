@@ -0,0 +1,53 @@
+/*
+ * SleepUntilMessage waits for a data ready edge that has not been read yet.
+ */
+
+#include "Test.h"
+
+static Zforce sensor;
+static TouchGenerator generator;
+
+// A message read with GetMessage consumes its data ready edge, so the next
+// SleepUntilMessage waits instead of returning at once.
+static void TestGetMessageConsumesEdge()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  CHECK(sensor.SleepUntilMessage(1) == nullptr);  // attaches the interrupt
+  CHECK(fakeSensor.dataReadyHandler != nullptr);
+
+  fakeSensor.Queue(SensorMessage(0xEF, {0x65, 0x03, 0x81, 0x01, 0x00}));
+  Message* msg = sensor.GetMessage();
+  CHECK(msg != nullptr);
+  sensor.DestroyMessage(msg);
+
+  sensor.ResetLowPowerStatistics();
+  CHECK(sensor.SleepUntilMessage(5) == nullptr);
+  LowPowerStatistics statistics = sensor.GetLowPowerStatistics();
+  CHECK(statistics.wakeups == 0);
+  CHECK(statistics.sleeps > 0);
+  CHECK(statistics.waitTime > 0);
+}
+
+static void TestSleepUntilMessage()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+  CHECK(sensor.SleepUntilMessage(1) == nullptr);
+
+  fakeSensor.Queue(SensorMessage(0xEF, {0x65, 0x03, 0x81, 0x01, 0x00}));
+  sensor.ResetLowPowerStatistics();
+  Message* msg = sensor.SleepUntilMessage(5);
+  CHECK((msg != nullptr) && (msg->type == MessageType::ENABLETYPE));
+  sensor.DestroyMessage(msg);
+  LowPowerStatistics statistics = sensor.GetLowPowerStatistics();
+  CHECK(statistics.wakeups == 1);
+  CHECK(statistics.messages == 1);
+}
+
+int main()
+{
+  TestGetMessageConsumesEdge();
+  TestSleepUntilMessage();
+  return TEST_RESULT();
+}
@@ -0,0 +1,6 @@
+// FLAGS: -O2 -DZFORCE_PACKED_TOUCH_DATA=1
+/*
+ * LayoutTest with the 8 byte TouchData.
+ */
+
+#include "LayoutTest.cpp"
@@ -0,0 +1,79 @@
+/*
+ * TouchSmoothing with the default parameters on a finger dragged at a constant
+ * speed and on a finger held still with jitter.
+ */
+
+#include "Test.h"
+#include "TouchSmoothing.h"
+
+static TouchSmoothing smoothing;
+
+static TouchCoordinate Smooth(TouchEvent event, TouchCoordinate x)
+{
+  TouchFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.touchCount = 1;
+  frame.event[0] = event;
+  frame.x[0] = x;
+  frame.y[0] = 1000;
+  smoothing.Smooth(&frame);
+  CHECK(frame.y[0] == 1000);
+  return frame.x[0];
+}
+
+// The lag of the output behind the finger settles and then changes by at most a
+// unit per frame, instead of the output falling behind and catching up in jumps.
+static void TestConstantSpeedDrag()
+{
+  const int32_t speeds[] = {2, 5, 20, 60, 200};
+  for (uint8_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++)
+  {
+    smoothing.Reset();
+    int32_t x = 100;
+    Smooth(TouchEvent::DOWN, x);
+    int32_t previousLag = 0;
+    int32_t maxLag = 0;
+    int32_t maxLagChange = 0;
+    for (uint16_t n = 1; n < 150; n++)
+    {
+      x += speeds[s];
+      int32_t lag = x - Smooth(TouchEvent::MOVE, x);
+      CHECK(lag >= 0);
+      if (n > 40)
+      {
+        int32_t change = (lag > previousLag) ? (lag - previousLag) : (previousLag - lag);
+        maxLagChange = (change > maxLagChange) ? change : maxLagChange;
+      }
+      maxLag = (lag > maxLag) ? lag : maxLag;
+      previousLag = lag;
+    }
+    printf("speed %d per frame: lag %d, lag change %d per frame\n", (int)speeds[s], (int)maxLag, (int)maxLagChange);
+    CHECK(maxLagChange <= 1);
+    CHECK(maxLag <= 2 * speeds[s] + 12);
+  }
+}
+
+// Jitter of a few units on a still finger does not reach the output.
+static void TestStillFinger()
+{
+  const int8_t jitter[] = {0, 3, -2, 1, -3, 2, -1, 3, 0, -2, 2, -3, 1, -1};
+  smoothing.Reset();
+  Smooth(TouchEvent::DOWN, 2000);
+  int32_t minX = 2000;
+  int32_t maxX = 2000;
+  for (uint16_t n = 0; n < 200; n++)
+  {
+    int32_t x = Smooth(TouchEvent::MOVE, 2000 + jitter[n % sizeof(jitter)]);
+    minX = (x < minX) ? x : minX;
+    maxX = (x > maxX) ? x : maxX;
+  }
+  printf("still finger with jitter of 6: output range %d\n", (int)(maxX - minX));
+  CHECK(maxX - minX <= 1);
+}
+
+int main()
+{
+  TestConstantSpeedDrag();
+  TestStillFinger();
+  return TEST_RESULT();
+}
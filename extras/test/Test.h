@@ -0,0 +1,64 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include "Zforce.h"
+#include "TouchGenerator.h"
+#include "FakeSensor.h"
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define TEST_RESULT() (printf("%s: %s\n", __BASE_FILE__, testFailures ? "FAILED" : "OK"), (testFailures ? 1 : 0))
+
+// A message as the sensor sends it: i2c header, then the ASN.1 message of the
+// given type (0xEF response, 0xF0 notification) with body as its content.
+static inline std::vector<uint8_t> SensorMessage(uint8_t type, const std::vector<uint8_t>& body)
+{
+  std::vector<uint8_t> message = {0xEE, (uint8_t)(body.size() + 6), type, (uint8_t)(body.size() + 4), 0x40, 0x02, 0x02, 0x00};
+  message.insert(message.end(), body.begin(), body.end());
+  return message;
+}
+
+// Starts sensor on the fake bus with the touch descriptor of generator, answering
+// the requests of Start(), and forgets what was written meanwhile.
+static inline void StartSensor(Zforce* sensor, TouchGenerator* generator)
+{
+  uint8_t buffer[BUFFER_SIZE];
+  uint8_t length = generator->BootComplete(buffer);
+  fakeSensor.Queue(std::vector<uint8_t>(buffer, buffer + length));
+  length = generator->TouchFormatResponse(buffer);
+  fakeSensor.Queue(std::vector<uint8_t>(buffer, buffer + length));
+  fakeSensor.Queue(SensorMessage(0xEF, {0x6C, 0x0C, 0xA0, 0x0A, 0x84, 0x01, 0x07, 0x85, 0x01, 0x02, 0x8A, 0x02, 0x12, 0x34}));
+  sensor->Start(FAKE_DATA_READY_PIN);
+  fakeSensor.written.clear();
+  fakeSensor.writeTransactions = 0;
+  fakeSensor.readTransactions = 0;
+}
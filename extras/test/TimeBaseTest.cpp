@@ -0,0 +1,127 @@
+/*
+ * TouchTimeBase fed with the timestamps of a simulated sensor with a 16 bit
+ * counter, whose clock runs 200 ppm slow and drifts further with temperature.
+ * Notifications are received after a read time with jitter, and now and then
+ * much later. The timestamp must be extended across wraps and a long pause, the
+ * clock rate found, and the capture times kept within a bound. A timestamp wider
+ * than 16 bits widens the counter without counting a wrap.
+ */
+
+#include "Test.h"
+#include "TouchTimeBase.h"
+#include <math.h>
+
+#define FRAMES 100000UL
+#define FRAME_TICKS 500          // 5 ms at 10 us per tick
+#define NOMINAL_MICROS_PER_TICK 10.0
+#define READ_MICROS 300          // shortest time from capture to reception
+#define WINDOW_FRAMES 2000       // frames before the rate is checked
+#define RATE_ERROR 0.0002        // relative error allowed in microsPerTick
+// Microseconds allowed between GetCaptureTime() and the capture, at most and on
+// average. Each late notification pulls the regression by its delay / ZFORCE_TIMEBASE_WINDOW.
+#define CAPTURE_ERROR 150
+#define MEAN_CAPTURE_ERROR 20
+
+// Same sequence on every run.
+static uint32_t random32 = 12345;
+static uint32_t Random(uint32_t range)
+{
+  random32 = random32 * 1103515245UL + 12345UL;
+  return (random32 >> 8) % range;
+}
+
+// Local microseconds per sensor tick at frame n: 200 ppm slow, plus 100 ppm of
+// drift rising and falling over the run.
+static double MicrosPerTick(uint32_t n)
+{
+  return NOMINAL_MICROS_PER_TICK * (1.0 + 200e-6 + 100e-6 * sin(n * 6.2832 / FRAMES));
+}
+
+// Half the notifications are read straight away, the rest up to 400 us later,
+// and one in a hundred waits 5 ms for a busy main loop.
+static uint32_t Delay()
+{
+  uint32_t kind = Random(100);
+  return READ_MICROS + ((kind == 0) ? 5000 : ((kind < 50) ? Random(20) : Random(400)));
+}
+
+static void TestDriftAndJitter()
+{
+  TouchTimeBase timeBase;
+  double capture = 1000000.0;  // local time of the capture, in microseconds
+  uint64_t ticks = 40000;      // sensor ticks, of which the low 16 bits are sent, starting below 2^16
+  double worstRate = 0;
+  double worstCapture = 0;
+  double captureErrors = 0;
+  uint32_t wrongTicks = 0;
+
+  for (uint32_t n = 0; n < FRAMES; n++)
+  {
+    uint32_t frameTicks = FRAME_TICKS;
+    // A pause of more than three counter periods, once the rate is known.
+    if (n == FRAMES / 2)
+    {
+      frameTicks = 3 * 65536 + 12345;
+    }
+    ticks += frameTicks;
+    capture += frameTicks * MicrosPerTick(n);
+
+    uint32_t localTime = (uint32_t)(uint64_t)(capture + Delay());
+    uint64_t extended = timeBase.Update((uint32_t)(ticks & 0xFFFF), localTime);
+    wrongTicks += (extended != ticks);
+
+    if (n >= WINDOW_FRAMES)
+    {
+      TimeBaseStatus status = timeBase.GetStatus();
+      double rateError = fabs(status.microsPerTick / MicrosPerTick(n) - 1.0);
+      worstRate = (rateError > worstRate) ? rateError : worstRate;
+      // The capture time is that of a notification read in the shortest time.
+      double captureError = fabs((double)(int32_t)(timeBase.GetCaptureTime() - (uint32_t)(uint64_t)(capture + READ_MICROS)));
+      worstCapture = (captureError > worstCapture) ? captureError : worstCapture;
+      captureErrors += captureError;
+    }
+  }
+
+  TimeBaseStatus status = timeBase.GetStatus();
+  CHECK(wrongTicks == 0);
+  CHECK(status.samples == FRAMES);
+  CHECK(status.wraps == (uint32_t)(ticks >> 16));
+  CHECK(worstRate <= RATE_ERROR);
+  double meanCapture = captureErrors / (FRAMES - WINDOW_FRAMES);
+  CHECK(worstCapture <= CAPTURE_ERROR);
+  CHECK(meanCapture <= MEAN_CAPTURE_ERROR);
+  // The busy main loop shows, less what it pulled the regression.
+  CHECK(status.maxLatency >= 5000 - 5000 / ZFORCE_TIMEBASE_WINDOW - 20);
+  printf("%lu frames, %lu wraps: microsPerTick error at most %.0f ppm, capture time error at most %.0f us, %.1f us on average\n",
+         FRAMES, (unsigned long)status.wraps, worstRate * 1e6, worstCapture, meanCapture);
+}
+
+// A 24 bit counter sends 16 bit timestamps until it passes 0xFFFF.
+static void TestWidening()
+{
+  TouchTimeBase timeBase;
+  uint32_t timestamp = 0xF000;
+  uint32_t localTime = 0;
+  for (uint32_t n = 0; n < 20; n++, timestamp += 500, localTime += 5000)
+  {
+    CHECK(timeBase.Update(timestamp, localTime) == timestamp);
+  }
+  CHECK(timestamp > 0xFFFF);
+  CHECK(timeBase.GetStatus().wraps == 0);
+
+  // Past the end of the 24 bit counter, which wraps once.
+  timestamp = 0xFFFF00;
+  for (uint32_t n = 0; n < 4; n++, timestamp += 500, localTime += 5000)
+  {
+    timeBase.Update(timestamp & 0xFFFFFF, localTime);
+  }
+  CHECK(timeBase.Update(timestamp & 0xFFFFFF, localTime) == timestamp);
+  CHECK(timeBase.GetStatus().wraps == 1);
+}
+
+int main()
+{
+  TestDriftAndJitter();
+  TestWidening();
+  return TEST_RESULT();
+}
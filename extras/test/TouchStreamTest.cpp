@@ -0,0 +1,243 @@
+/*
+ * Round trips of touch frames through TouchStreamEncoder and TouchStreamDecoder:
+ * frames come out exactly as they went in, ten moving touches take about 60
+ * bytes, a corrupted frame is rejected by its CRC, a decoder that lost a frame
+ * resumes at the next key frame, timestamps wrap and ids beyond the tracked ones
+ * are sent in full.
+ */
+
+#include "Test.h"
+#include "TouchStream.h"
+
+static TouchStreamEncoder encoder;
+static TouchStreamDecoder decoder;
+static uint8_t encoded[ZFORCE_STREAM_MAX_FRAME];
+static TouchFrame received;
+
+static void Start()
+{
+  encoder = TouchStreamEncoder();
+  decoder = TouchStreamDecoder();
+}
+
+// Touches with ids 0 to touchCount - 1 moving by a few units per frame.
+static void Fill(TouchFrame* frame, uint32_t n, uint8_t touchCount)
+{
+  memset(frame, 0, sizeof(TouchFrame));
+  frame->timestamp = 1000 + n * 1900;
+  frame->touchCount = touchCount;
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    frame->id[i] = i;
+    frame->event[i] = (n == 0) ? TouchEvent::DOWN : TouchEvent::MOVE;
+    frame->x[i] = (TouchCoordinate)(400 + 300 * i + 3 * n);
+    frame->y[i] = (TouchCoordinate)(3000 + 100 * i - 2 * n);
+    frame->sizeX[i] = (TouchCoordinate)(40 + (n + i) % 5);
+  }
+}
+
+static bool Same(const TouchFrame* a, const TouchFrame* b)
+{
+  if ((a->timestamp != b->timestamp) || (a->touchCount != b->touchCount))
+  {
+    return false;
+  }
+  for (uint8_t i = 0; i < a->touchCount; i++)
+  {
+    if ((a->id[i] != b->id[i]) || (a->event[i] != b->event[i]) || (a->x[i] != b->x[i]) || (a->y[i] != b->y[i]) ||
+        (a->sizeX[i] != b->sizeX[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Feeds the bytes of a frame. Returns true if the last one completed a frame.
+static bool Feed(const uint8_t* data, uint8_t length)
+{
+  bool decoded = false;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    CHECK(!decoded);
+    decoded = decoder.Feed(data[i], &received);
+  }
+  return decoded;
+}
+
+static bool RoundTrip(const TouchFrame* frame)
+{
+  uint8_t length = encoder.Encode(frame, encoded);
+  return Feed(encoded, length) && Same(frame, &received);
+}
+
+static void TestRoundTrip()
+{
+  Start();
+  TouchFrame frame;
+  for (uint32_t n = 0; n < 3 * ZFORCE_STREAM_KEY_FRAME_INTERVAL; n++)
+  {
+    Fill(&frame, n, (uint8_t)(n % (ZFORCE_MAX_TOUCHES + 1)));
+    CHECK(RoundTrip(&frame));
+  }
+
+  // Jumps across the whole coordinate range, in both directions.
+  TouchCoordinate largest = (TouchCoordinate)~(TouchCoordinate)0;
+  const TouchCoordinate jumps[] = {0, largest, 0, largest, 1, (TouchCoordinate)(largest - 1)};
+  for (uint8_t n = 0; n < sizeof(jumps) / sizeof(jumps[0]); n++)
+  {
+    Fill(&frame, n, 2);
+    frame.x[0] = jumps[n];
+    frame.y[1] = jumps[n];
+    frame.sizeX[0] = jumps[n];
+    frame.event[1] = TouchEvent::UP;
+    CHECK(RoundTrip(&frame));
+  }
+
+  TouchStreamStatistics statistics = decoder.GetStatistics();
+  CHECK(statistics.frames == 3 * ZFORCE_STREAM_KEY_FRAME_INTERVAL + sizeof(jumps) / sizeof(jumps[0]));
+  CHECK((statistics.crcErrors == 0) && (statistics.lostFrames == 0) && (statistics.skippedFrames == 0));
+}
+
+static void TestSize()
+{
+  Start();
+  TouchFrame frame;
+  uint32_t bytes = 0;
+  uint8_t largest = 0;
+  uint32_t frames = 0;
+  for (uint32_t n = 0; n < 4 * ZFORCE_STREAM_KEY_FRAME_INTERVAL; n++)
+  {
+    Fill(&frame, n, 10);
+    uint8_t length = encoder.Encode(&frame, encoded);
+    CHECK(Feed(encoded, length) && Same(&frame, &received));
+    if ((n % ZFORCE_STREAM_KEY_FRAME_INTERVAL) != 0)
+    {
+      bytes += length;
+      largest = (length > largest) ? length : largest;
+      frames++;
+    }
+  }
+  // 7 bytes of framing, a 2 byte timestamp delta, the touch count and 5 bytes per touch.
+  CHECK(largest <= 60);
+  printf("10 moving touches: %.1f bytes per frame on average, at most %u\n", (double)bytes / frames, largest);
+}
+
+static void TestCrcRejection()
+{
+  Start();
+  TouchFrame frame;
+  Fill(&frame, 0, 3);
+  CHECK(RoundTrip(&frame));
+
+  // A flipped bit anywhere after the sync bytes, in the length, the payload or the CRC.
+  Fill(&frame, 1, 3);
+  uint8_t length = encoder.Encode(&frame, encoded);
+  uint32_t rejected = 0;
+  for (uint8_t i = 2; i < length; i++)
+  {
+    uint8_t corrupted[ZFORCE_STREAM_MAX_FRAME];
+    memcpy(corrupted, encoded, length);
+    corrupted[i] ^= 0x10;
+    TouchStreamDecoder saved = decoder;
+    rejected += !Feed(corrupted, length);
+    decoder = saved;
+  }
+  CHECK(rejected == (uint32_t)(length - 2));
+
+  uint8_t corrupted[ZFORCE_STREAM_MAX_FRAME];
+  memcpy(corrupted, encoded, length);
+  corrupted[length - 1] ^= 0x01;
+  CHECK(!Feed(corrupted, length));
+  CHECK(decoder.GetStatistics().crcErrors == 1);
+}
+
+static void TestResyncAtKeyFrame()
+{
+  Start();
+  TouchFrame frame;
+  uint32_t n = 0;
+  for (; n < 5; n++)
+  {
+    Fill(&frame, n, 4);
+    CHECK(RoundTrip(&frame));
+  }
+
+  // One frame is lost, and one arrives with a bad CRC.
+  Fill(&frame, n++, 4);
+  encoder.Encode(&frame, encoded);
+  Fill(&frame, n++, 4);
+  uint8_t length = encoder.Encode(&frame, encoded);
+  encoded[length / 2] ^= 0xFF;
+  CHECK(!Feed(encoded, length));
+
+  // The frames up to the next key frame can not be decoded without the lost deltas.
+  for (; (n % ZFORCE_STREAM_KEY_FRAME_INTERVAL) != 0; n++)
+  {
+    Fill(&frame, n, 4);
+    length = encoder.Encode(&frame, encoded);
+    CHECK(!Feed(encoded, length));
+  }
+  for (uint8_t i = 0; i < 5; i++, n++)
+  {
+    Fill(&frame, n, 4);
+    CHECK(RoundTrip(&frame));
+  }
+
+  TouchStreamStatistics statistics = decoder.GetStatistics();
+  CHECK(statistics.crcErrors == 1);
+  CHECK(statistics.lostFrames == 2);
+  CHECK(statistics.skippedFrames == ZFORCE_STREAM_KEY_FRAME_INTERVAL - 7);
+  CHECK(statistics.frames == 10);
+
+  // Noise between frames is skipped over, including false sync bytes.
+  const uint8_t noise[] = {0x00, ZFORCE_STREAM_SYNC1, 0x13, ZFORCE_STREAM_SYNC1, ZFORCE_STREAM_SYNC1, 0x01, 0xFF};
+  CHECK(!Feed(noise, sizeof(noise)));
+  Fill(&frame, n, 4);
+  CHECK(RoundTrip(&frame));
+}
+
+static void TestTimestampWrap()
+{
+  Start();
+  TouchFrame frame;
+  uint32_t timestamp = 0xFFFFFFFFUL - 3 * 1900;
+  for (uint8_t n = 0; n < 8; n++, timestamp += 1900)
+  {
+    Fill(&frame, n, 2);
+    frame.timestamp = timestamp;
+    uint8_t length = encoder.Encode(&frame, encoded);
+    CHECK(Feed(encoded, length) && Same(&frame, &received));
+    // Only the key frame has the whole timestamp, the rest a 2 byte delta even across the wrap.
+    CHECK((n == 0) || (length == 7 + 2 + 1 + 2 * 5));
+  }
+}
+
+// Untracked ids must not disturb the deltas of the tracked ones, and are sent
+// relative to 0, so they take 7 bytes per touch here instead of 5.
+static void TestUntrackedIds()
+{
+  Start();
+  TouchFrame frame;
+  for (uint32_t n = 0; n < 10; n++)
+  {
+    Fill(&frame, n, 4);
+    frame.id[1] = ZFORCE_STREAM_MAX_IDS;
+    frame.id[2] = 0xFF;
+    frame.id[3] = ZFORCE_STREAM_MAX_IDS - 1;
+    uint8_t length = encoder.Encode(&frame, encoded);
+    CHECK(Feed(encoded, length) && Same(&frame, &received));
+    CHECK((n == 0) || (length == 7 + 2 + 1 + 2 * 5 + 2 * 7));
+  }
+}
+
+int main()
+{
+  TestRoundTrip();
+  TestSize();
+  TestCrcRejection();
+  TestResyncAtKeyFrame();
+  TestTimestampWrap();
+  TestUntrackedIds();
+  return TEST_RESULT();
+}
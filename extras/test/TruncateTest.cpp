@@ -0,0 +1,55 @@
+// FLAGS: -DMAX_PAYLOAD=64
+/*
+ * Messages longer than MAX_PAYLOAD are read to the end and dropped, and the
+ * following message is read intact.
+ */
+
+#include "Test.h"
+#include <Wire.h>
+
+static Zforce sensor;
+static TouchGenerator generator;
+static uint8_t payload[BUFFER_SIZE];
+
+static std::vector<uint8_t> Response(uint8_t bodyLength)
+{
+  std::vector<uint8_t> body = {0x6C, (uint8_t)(bodyLength + 4), 0xA0, (uint8_t)(bodyLength + 2), 0x8A, bodyLength};
+  for (uint8_t i = 0; i < bodyLength; i++)
+  {
+    body.push_back(i);
+  }
+  return SensorMessage(0xEF, body);
+}
+
+static void TestTruncatedMessageIsDrained()
+{
+  fakeSensor.Reset();
+  StartSensor(&sensor, &generator);
+
+  std::vector<uint8_t> longMessage = Response(150);
+  std::vector<uint8_t> next = Response(8);
+  fakeSensor.Queue(longMessage);
+  fakeSensor.Queue(next);
+  uint16_t windowTransactions = sensor.GetBusFrequencyStatus().windowTransactions;
+
+  CHECK(sensor.Read(payload) == ZFORCE_MESSAGE_TRUNCATED);
+  CHECK(payload[1] == MAX_PAYLOAD);
+  CHECK(memcmp(&payload[2], &longMessage[2], MAX_PAYLOAD) == 0);
+  // Header, MAX_PAYLOAD bytes and the rest in chunks of the Wire buffer.
+  uint8_t dropped = longMessage[1] - MAX_PAYLOAD;
+  uint32_t transactions = 1 + (MAX_PAYLOAD + BUFFER_LENGTH - 1) / BUFFER_LENGTH + (dropped + BUFFER_LENGTH - 1) / BUFFER_LENGTH;
+  CHECK(fakeSensor.readTransactions == transactions);
+  CHECK(sensor.GetBusFrequencyStatus().windowTransactions == windowTransactions + 3);
+  CHECK(fakeSensor.messages.size() == 1);
+  CHECK(fakeSensor.Position() == 0);
+
+  CHECK(sensor.Read(payload) == 0);
+  CHECK(memcmp(payload, next.data(), next.size()) == 0);
+  CHECK(sensor.GetBusStatistics().failedTransactions == 0);
+}
+
+int main()
+{
+  TestTruncatedMessageIsDrained();
+  return TEST_RESULT();
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Builds Benchmark.cpp with the fake Arduino core once per transport model and touch
+# decoder, and appends the results of each to a CSV file, by default
+# benchmark-<library version>.csv in the current folder. Keep the files of several
+# library versions to compare them.
+# Usage: extras/test/benchmark.sh [results.csv], with CXX set to use another compiler than g++.
+version=$(sed -n 's/^#define ZFORCE_LIBRARY_VERSION "\(.*\)"/\1/p' "$(dirname "$0")/../../src/Zforce.h")
+results=${1:-benchmark-$version.csv}
+case $results in
+  /*) ;;
+  *) results="$(pwd)/$results" ;;
+esac
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+# Wire with its 32 byte buffer, the AVR I2C library, and Wire with a buffer that
+# holds a whole message, as on platforms that read a message in one transaction.
+failed=0
+for transport in wire twi wire255; do
+  case $transport in
+    wire) flags="" ;;
+    twi) flags="-DUSE_I2C_LIB=1" ;;
+    wire255) flags="-DBUFFER_LENGTH=255" ;;
+  esac
+  for decoders in 1 0; do
+    if ! $CXX -std=gnu++11 -O2 -DNDEBUG -DARDUINO=10819 -Ifake -I../../src -include Arduino.h \
+        $flags -DZFORCE_FAST_TOUCH_DECODERS=$decoders -DBENCHMARK_TRANSPORT="\"$transport\"" \
+        -o "$out/Benchmark" Benchmark.cpp fake/*.cpp ../../src/*.cpp -lpthread; then
+      echo "$transport: build FAILED"
+      failed=1
+    elif ! "$out/Benchmark" "$results"; then
+      failed=1
+    fi
+  done
+done
+echo "Results appended to $results"
+exit $failed
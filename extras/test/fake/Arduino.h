@@ -0,0 +1,74 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * The parts of the Arduino core the library uses, for building it and its tests on
+ * a PC. Time only advances when the library waits or reads the clock, so tests
+ * run fast and give the same result every time. The pins are those of the
+ * sensor modelled in FakeSensor.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define HEX 16
+#define NOT_AN_INTERRUPT -1
+#define SDA 20
+#define SCL 21
+
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void pinMode(uint8_t pin, uint8_t mode);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void noInterrupts();
+void interrupts();
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+
+class FakeSerial
+{
+	public:
+		void begin(unsigned long) {}
+		operator bool() { return true; }
+		template <typename T> size_t print(T) { return 0; }
+		template <typename T> size_t print(T, int) { return 0; }
+		template <typename T> size_t println(T) { return 0; }
+		template <typename T> size_t println(T, int) { return 0; }
+		size_t println() { return 0; }
+		size_t write(const uint8_t*, size_t length) { return length; }
+		void flush() {}
+};
+
+extern FakeSerial Serial;
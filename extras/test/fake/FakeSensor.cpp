@@ -0,0 +1,349 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "FakeSensor.h"
+
+FakeSensor fakeSensor;
+FakeSerial Serial;
+TwoWire Wire;
+
+FakeSensor::FakeSensor()
+{
+  dataReadyHandler = nullptr;
+  Reset();
+}
+
+void FakeSensor::Reset()
+{
+  messages.clear();
+  written.clear();
+  readTransactions = 0;
+  writeTransactions = 0;
+  bytesRead = 0;
+  bytesWritten = 0;
+  clockPulses = 0;
+  stopConditions = 0;
+  busBegins = 0;
+  busEnds = 0;
+  frequency = 0;
+  frequencyChanges = 0;
+  midMessageFrequencyChanges = 0;
+  now = 0;
+  sdaHeldClocks = 0;
+  position = 0;
+  fault = FakeFault::NONE;
+  faultCount = 0;
+  faultDelay = 0;
+  faultClocks = 0;
+  sclLow = false;
+  sdaLow = false;
+}
+
+void FakeSensor::Queue(const std::vector<uint8_t>& message)
+{
+  bool wasReady = DataReady();
+  messages.push_back(message);
+  if (!wasReady && (dataReadyHandler != nullptr))
+  {
+    dataReadyHandler();
+  }
+}
+
+void FakeSensor::InjectFault(FakeFault fault, uint8_t count, uint8_t clocks, uint8_t after)
+{
+  this->fault = fault;
+  faultCount = count;
+  faultDelay = after;
+  faultClocks = clocks;
+}
+
+bool FakeSensor::DataReady()
+{
+  return !messages.empty();
+}
+
+size_t FakeSensor::Position()
+{
+  return position;
+}
+
+uint8_t FakeSensor::Send(uint8_t* destination, uint8_t quantity)
+{
+  if (messages.empty())
+  {
+    return 0;
+  }
+
+  std::vector<uint8_t>& message = messages.front();
+  uint8_t length = 0;
+  while ((length < quantity) && (position < message.size()))
+  {
+    destination[length++] = message[position++];
+  }
+  bytesRead += length;
+  if (position == message.size())
+  {
+    messages.pop_front();
+    position = 0;
+  }
+  return length;
+}
+
+FakeFault FakeSensor::TakeFault()
+{
+  if (sdaHeldClocks > 0)
+  {
+    return FakeFault::TIMEOUT;
+  }
+  if (faultCount == 0)
+  {
+    return FakeFault::NONE;
+  }
+  if (faultDelay > 0)
+  {
+    faultDelay--;
+    return FakeFault::NONE;
+  }
+
+  faultCount--;
+  if (fault == FakeFault::STUCK_SDA)
+  {
+    sdaHeldClocks = faultClocks;
+  }
+  return fault;
+}
+
+// The sensor gives up on the message being read, and sends it again from the start.
+void FakeSensor::BusError()
+{
+  position = 0;
+}
+
+int digitalRead(uint8_t pin)
+{
+  if (pin == FAKE_DATA_READY_PIN)
+  {
+    return fakeSensor.DataReady() ? HIGH : LOW;
+  }
+  if (pin == SDA)
+  {
+    return ((fakeSensor.sdaHeldClocks > 0) || fakeSensor.sdaLow) ? LOW : HIGH;
+  }
+  return fakeSensor.sclLow ? LOW : HIGH;
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+}
+
+/*
+ * The bus is driven open drain, by switching a pin between OUTPUT (low) and
+ * INPUT_PULLUP (released).
+ */
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  bool low = (mode == OUTPUT);
+  if (pin == SCL)
+  {
+    if (fakeSensor.sclLow && !low)
+    {
+      fakeSensor.clockPulses++;
+      if (fakeSensor.sdaHeldClocks > 0)
+      {
+        fakeSensor.sdaHeldClocks--;
+      }
+    }
+    fakeSensor.sclLow = low;
+  }
+  else if (pin == SDA)
+  {
+    if (fakeSensor.sdaLow && !low && !fakeSensor.sclLow)
+    {
+      fakeSensor.stopConditions++;
+    }
+    fakeSensor.sdaLow = low;
+  }
+}
+
+unsigned long millis()
+{
+  return ++fakeSensor.now / 1000;
+}
+
+unsigned long micros()
+{
+  return ++fakeSensor.now;
+}
+
+void delay(unsigned long ms)
+{
+  fakeSensor.now += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  fakeSensor.now += us;
+}
+
+void yield()
+{
+  fakeSensor.now++;
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+int digitalPinToInterrupt(uint8_t pin)
+{
+  return (pin == FAKE_DATA_READY_PIN) ? 0 : NOT_AN_INTERRUPT;
+}
+
+void attachInterrupt(uint8_t, void (*handler)(void), int)
+{
+  fakeSensor.dataReadyHandler = handler;
+}
+
+void detachInterrupt(uint8_t)
+{
+  fakeSensor.dataReadyHandler = nullptr;
+}
+
+void TwoWire::begin()
+{
+  fakeSensor.busBegins++;
+  rxLength = 0;
+  rxIndex = 0;
+  timeoutFlag = false;
+}
+
+void TwoWire::end()
+{
+  fakeSensor.busEnds++;
+}
+
+void TwoWire::setClock(uint32_t frequency)
+{
+  if (fakeSensor.Position() > 0)
+  {
+    fakeSensor.midMessageFrequencyChanges++;
+  }
+  fakeSensor.frequency = frequency;
+  fakeSensor.frequencyChanges++;
+}
+
+void TwoWire::setWireTimeout(uint32_t, bool)
+{
+}
+
+bool TwoWire::getWireTimeoutFlag()
+{
+  return timeoutFlag;
+}
+
+void TwoWire::clearWireTimeoutFlag()
+{
+  timeoutFlag = false;
+}
+
+void TwoWire::beginTransmission(uint8_t)
+{
+  fakeSensor.written.push_back(std::vector<uint8_t>());
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  fakeSensor.bytesWritten++;
+  fakeSensor.written.back().push_back(data);
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool)
+{
+  fakeSensor.writeTransactions++;
+  switch (fakeSensor.TakeFault())
+  {
+    case FakeFault::NONE:
+    case FakeFault::SHORT_READ:
+      return 0;
+    case FakeFault::NACK_ADDRESS:
+      fakeSensor.written.pop_back();
+      return 2;
+    case FakeFault::NACK_DATA:
+      fakeSensor.written.pop_back();
+      return 3;
+    default:
+      fakeSensor.written.pop_back();
+      fakeSensor.BusError();
+      timeoutFlag = true;
+      return 5;
+  }
+}
+
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t quantity, uint8_t)
+{
+  fakeSensor.readTransactions++;
+  rxLength = 0;
+  rxIndex = 0;
+  if (quantity > BUFFER_LENGTH)
+  {
+    quantity = BUFFER_LENGTH;
+  }
+
+  FakeFault fault = fakeSensor.TakeFault();
+  if ((fault == FakeFault::TIMEOUT) || (fault == FakeFault::STUCK_SDA))
+  {
+    fakeSensor.BusError();
+    timeoutFlag = true;
+    return 0;
+  }
+  if ((fault == FakeFault::NACK_ADDRESS) || (fault == FakeFault::NACK_DATA) || fakeSensor.messages.empty())
+  {
+    return 0;
+  }
+  if (fault == FakeFault::SHORT_READ)
+  {
+    quantity /= 2;
+  }
+
+  rxLength = fakeSensor.Send(rxBuffer, quantity);
+  if (fault == FakeFault::SHORT_READ)
+  {
+    // The sensor aborted the transfer and starts the message over.
+    fakeSensor.BusError();
+  }
+  return rxLength;
+}
+
+int TwoWire::available()
+{
+  return rxLength - rxIndex;
+}
+
+int TwoWire::read()
+{
+  return (rxIndex < rxLength) ? rxBuffer[rxIndex++] : -1;
+}
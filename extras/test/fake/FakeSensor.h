@@ -0,0 +1,102 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * A zForce sensor on a fake i2c bus, for testing the library on a PC.
+ *
+ * Queued messages are sent one after the other, and the data ready pin is HIGH
+ * while there is anything left to send. Like the real sensor, a read continues
+ * where the previous read ended, also across transactions, and the next message
+ * starts once the previous one has been read completely. Writes are recorded.
+ *
+ * Faults are injected into the next transactions: the sensor can NACK, the bus can
+ * time out, or the sensor can hold SDA low until SCL has been clocked a number of
+ * times. After a timeout or a stuck bus the sensor starts the message over from
+ * its i2c header.
+ *
+ * The sensor is reached through the fake Wire library, or through the fake I2C
+ * library of AVR when built with USE_I2C_LIB defined as 1.
+ */
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#define FAKE_DATA_READY_PIN 2
+
+enum class FakeFault : uint8_t
+{
+	NONE,
+	NACK_ADDRESS,  // no answer, requestFrom() returns 0 and endTransmission() 2
+	NACK_DATA,     // endTransmission() returns 3, reads behave as NACK_ADDRESS
+	TIMEOUT,       // the Wire timeout flag is set
+	STUCK_SDA,     // times out, and SDA stays low until SCL has been clocked
+	SHORT_READ     // half of the requested bytes are returned, the message restarts
+};
+
+class FakeSensor
+{
+	public:
+		FakeSensor();
+		// Forgets everything, including the recorded writes and the time.
+		void Reset();
+		// Queues a complete message, starting with the i2c header 0xEE and length.
+		void Queue(const std::vector<uint8_t>& message);
+		// After the next after transactions, count transactions fail with fault. For
+		// STUCK_SDA, clocks is the number of SCL pulses needed before the sensor
+		// releases SDA.
+		void InjectFault(FakeFault fault, uint8_t count, uint8_t clocks = 9, uint8_t after = 0);
+		bool DataReady();
+		// Bytes of the current message that have been read.
+		size_t Position();
+		// Sends up to quantity bytes of the current message, for a read transaction.
+		// Returns the number of bytes sent.
+		uint8_t Send(uint8_t* destination, uint8_t quantity);
+
+		std::deque<std::vector<uint8_t>> messages;
+		std::vector<std::vector<uint8_t>> written;
+		uint32_t readTransactions;
+		uint32_t writeTransactions;
+		uint32_t bytesRead;
+		uint32_t bytesWritten;
+		uint32_t clockPulses;         // SCL pulses while recovering the bus
+		uint32_t stopConditions;      // STOPs generated while recovering the bus
+		uint32_t busBegins;
+		uint32_t busEnds;
+		uint32_t frequency;           // set with Wire.setClock()
+		uint32_t frequencyChanges;
+		uint32_t midMessageFrequencyChanges;  // changes while a message was partly read
+		unsigned long now;            // microseconds
+
+		// Used by the fake Wire and Arduino functions.
+		FakeFault TakeFault();
+		void BusError();
+		uint8_t sdaHeldClocks;
+		size_t position;
+		FakeFault fault;
+		uint8_t faultCount;
+		uint8_t faultDelay;
+		uint8_t faultClocks;
+		bool sclLow;
+		bool sdaLow;
+		void (*dataReadyHandler)(void);
+};
+
+extern FakeSensor fakeSensor;
@@ -0,0 +1,165 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/*
+ * The I2C library used on AVR, connected to the sensor modelled in FakeSensor.h.
+ * It is built instead of Wire when USE_I2C_LIB is defined as 1. Like the real
+ * library, reads go straight into the destination without a buffer size limit,
+ * and errors are reported with the TWI status codes.
+ */
+
+#include "Arduino.h"
+#include "I2C/I2C.h"
+#include "FakeSensor.h"
+
+#if USE_I2C_LIB
+
+#define FAKE_F_CPU 16000000UL
+
+uint8_t I2C::bytesAvailable = 0;
+uint8_t I2C::bufferIndex = 0;
+uint8_t I2C::totalBytes = 0;
+uint16_t I2C::timeOutDelay = 0;
+
+I2C::I2C()
+{
+}
+
+void I2C::begin()
+{
+  fakeSensor.busBegins++;
+}
+
+void I2C::end()
+{
+  fakeSensor.busEnds++;
+}
+
+void I2C::timeOut(uint16_t _timeOut)
+{
+  timeOutDelay = _timeOut;
+}
+
+// The frequency the TWI of a 16 MHz AVR can make, closest to but not above frequency.
+uint32_t I2C::setFrequency(uint32_t frequency)
+{
+  uint32_t cycles = (frequency > 0) ? ((FAKE_F_CPU + frequency - 1) / frequency) : 0xFFFFFFFF;
+  if (cycles < 16)
+  {
+    cycles = 16;
+  }
+  uint32_t actual = 0;
+  for (uint8_t prescaler = 0; prescaler < 4; prescaler++)
+  {
+    uint32_t multiplier = 2UL << (2 * prescaler);
+    uint32_t bitRate = (cycles - 16 + multiplier - 1) / multiplier;
+    if ((bitRate <= 255) || (prescaler == 3))
+    {
+      actual = FAKE_F_CPU / (16 + multiplier * ((bitRate > 255) ? 255 : bitRate));
+      break;
+    }
+  }
+
+  if (fakeSensor.Position() > 0)
+  {
+    fakeSensor.midMessageFrequencyChanges++;
+  }
+  fakeSensor.frequency = actual;
+  fakeSensor.frequencyChanges++;
+  return actual;
+}
+
+uint8_t I2C::write(uint8_t, uint8_t numberBytes, uint8_t (*source)(void*, uint8_t), void* context)
+{
+  fakeSensor.writeTransactions++;
+  switch (fakeSensor.TakeFault())
+  {
+    case FakeFault::NONE:
+    case FakeFault::SHORT_READ:
+      break;
+    case FakeFault::NACK_ADDRESS:
+      return MT_SLA_NACK;
+    case FakeFault::NACK_DATA:
+      return MT_DATA_NACK;
+    default:
+      fakeSensor.BusError();
+      return 1;
+  }
+
+  fakeSensor.written.push_back(std::vector<uint8_t>());
+  for (uint8_t i = 0; i < numberBytes; i++)
+  {
+    fakeSensor.written.back().push_back(source(context, i));
+  }
+  fakeSensor.bytesWritten += numberBytes;
+  return 0;
+}
+
+uint8_t I2C::read(uint8_t, uint8_t numberBytes, uint8_t* dataBuffer)
+{
+  fakeSensor.readTransactions++;
+  bytesAvailable = 0;
+  bufferIndex = 0;
+
+  FakeFault fault = fakeSensor.TakeFault();
+  if ((fault == FakeFault::TIMEOUT) || (fault == FakeFault::STUCK_SDA))
+  {
+    fakeSensor.BusError();
+    return 1;
+  }
+  if ((fault == FakeFault::NACK_ADDRESS) || (fault == FakeFault::NACK_DATA) || !fakeSensor.DataReady())
+  {
+    return MR_SLA_NACK;
+  }
+  if (fault == FakeFault::SHORT_READ)
+  {
+    // The sensor stops answering halfway, which the TWI sees as a timeout.
+    totalBytes = fakeSensor.Send(dataBuffer, numberBytes / 2);
+    fakeSensor.BusError();
+    return 6;
+  }
+
+  totalBytes = fakeSensor.Send(dataBuffer, numberBytes);
+  bytesAvailable = totalBytes;
+  return (totalBytes == numberBytes) ? 0 : 6;
+}
+
+uint8_t I2C::read(uint8_t address, uint8_t numberBytes)
+{
+  return read(address, (numberBytes > MAX_BUFFER_SIZE) ? (uint8_t)MAX_BUFFER_SIZE : numberBytes, data);
+}
+
+uint8_t I2C::recover()
+{
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+  for (uint8_t i = 0; (i < 9) && (digitalRead(SDA) == LOW); i++)
+  {
+    pinMode(SCL, OUTPUT);
+    pinMode(SCL, INPUT_PULLUP);
+  }
+  pinMode(SDA, OUTPUT);
+  pinMode(SDA, INPUT_PULLUP);
+  return (digitalRead(SDA) == HIGH) ? 0 : 1;
+}
+
+I2C I2c = I2C();
+
+#endif
@@ -0,0 +1,53 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+// Wire interface of the AVR core, connected to the sensor modelled in FakeSensor.h.
+
+#include "Arduino.h"
+
+// 32 as on AVR, larger to model transports that read a whole message at once.
+#ifndef BUFFER_LENGTH
+#define BUFFER_LENGTH 32
+#endif
+#define WIRE_HAS_TIMEOUT 1
+
+class TwoWire
+{
+	public:
+		void begin();
+		void end();
+		void setClock(uint32_t frequency);
+		void setWireTimeout(uint32_t timeout, bool resetOnTimeout);
+		bool getWireTimeoutFlag();
+		void clearWireTimeoutFlag();
+		void beginTransmission(uint8_t address);
+		size_t write(uint8_t data);
+		uint8_t endTransmission(bool sendStop = true);
+		uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = true);
+		int available();
+		int read();
+	private:
+		uint8_t rxBuffer[BUFFER_LENGTH];
+		uint8_t rxLength;
+		uint8_t rxIndex;
+		bool timeoutFlag;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Builds the library with the fake Arduino core in fake/ and runs every *Test.cpp.
+# Extra compiler flags for a test are given on a line "// FLAGS: ..." in it.
+# Usage: extras/test/run.sh, with CXX set to use another compiler than g++.
+cd "$(dirname "$0")" || exit 1
+CXX=${CXX:-g++}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+
+failed=0
+for test in *Test.cpp; do
+  name=${test%.cpp}
+  flags=$(sed -n 's|^// FLAGS: ||p' "$test")
+  if ! $CXX -std=gnu++11 -Wall -Wextra -g -DARDUINO=10819 -Ifake -I../../src -include Arduino.h \
+      $flags -o "$out/$name" "$test" fake/*.cpp ../../src/*.cpp -lpthread; then
+    echo "$name: build FAILED"
+    failed=1
+  else
+    "$out/$name"
+    status=$?
+    if [ $status -ne 0 ]; then
+      echo "$name: exit status $status"
+      failed=1
+    fi
+  fi
+done
+exit $failed
@@ -114,14 +114,38 @@ void I2C::timeOut(uint16_t _timeOut)
 
 void I2C::setSpeed(uint8_t _fast)
 {
-  if(!_fast)
+  setFrequency(_fast ? 400000 : 100000);
+}
+
+/*setFrequency() sets the SCL frequency closest to, but not above, the
+  requested one. SCL = F_CPU / (16 + 2 * TWBR * 4^prescaler), so the
+  smallest prescaler that lets TWBR fit in 8 bits is used. The highest
+  possible frequency is F_CPU / 16, e.g. 1MHz (Fast-mode Plus) at 16MHz.
+  Returns the frequency actually set.*/
+
+uint32_t I2C::setFrequency(uint32_t frequency)
+{
+  uint32_t cycles = (frequency > 0) ? ((F_CPU + frequency - 1) / frequency) : 0xFFFFFFFF;
+  if(cycles < 16)
   {
-    TWBR = ((F_CPU / 100000) - 16) / 2;
+    cycles = 16;
   }
-  else
+  for(uint8_t prescaler = 0; prescaler < 4; prescaler++)
   {
-    TWBR = ((F_CPU / 400000) - 16) / 2;
+    uint32_t multiplier = 2UL << (2 * prescaler);
+    uint32_t bitRate = (cycles - 16 + multiplier - 1) / multiplier; //round up to stay at or below frequency
+    if((bitRate <= 255) || (prescaler == 3))
+    {
+      if(bitRate > 255)
+      {
+        bitRate = 255;
+      }
+      TWSR = (TWSR & ~(_BV(TWPS0) | _BV(TWPS1))) | prescaler;
+      TWBR = (uint8_t)bitRate;
+      return(F_CPU / (16 + multiplier * bitRate));
+    }
   }
+  return(0);
 }
   
 void I2C::pullup(uint8_t activate)
@@ -345,6 +369,39 @@ uint8_t I2C::write(uint8_t address, uint8_t registerAddress, uint8_t *data, uint
   return(returnStatus);
 }
 
+/*write() with a byte source sends numberBytes bytes, each one fetched by
+  calling source(context, index) just before it is sent. Lets the caller
+  send data that is not in RAM, e.g. stored in flash, without copying it.*/
+
+uint8_t I2C::write(uint8_t address, uint8_t numberBytes, uint8_t (*source)(void*, uint8_t), void* context)
+{
+  returnStatus = 0;
+  returnStatus = start();
+  if(returnStatus){return(returnStatus);}
+  returnStatus = sendAddress(SLA_W(address));
+  if(returnStatus)
+  {
+    if(returnStatus == 1){return(2);}
+    return(returnStatus);
+  }
+  for (uint8_t i = 0; i < numberBytes; i++)
+  {
+    returnStatus = sendByte(source(context, i));
+    if(returnStatus)
+      {
+        if(returnStatus == 1){return(3);}
+        return(returnStatus);
+      }
+  }
+  returnStatus = stop();
+  if(returnStatus)
+  {
+    if(returnStatus == 1){return(7);}
+    return(returnStatus);
+  }
+  return(returnStatus);
+}
+
 uint8_t I2C::read(int address, int numberBytes)
 {
   return(read((uint8_t) address, (uint8_t) numberBytes));
@@ -560,6 +617,43 @@ uint8_t I2C::read(uint8_t address, uint8_t registerAddress, uint8_t numberBytes,
   return(returnStatus);
 }
 
+/*recover() frees a bus where a slave is holding SDA low, typically
+  because a transfer was aborted in the middle of a byte. The TWI
+  module is disabled and SCL is clocked manually (up to 9 pulses)
+  until the slave releases SDA, after which a STOP condition is
+  generated and the TWI module is reinitialized.
+  Returns 0 if both lines are released afterwards, otherwise 1.*/
+
+uint8_t I2C::recover()
+{
+  TWCR = 0; //hand SDA and SCL back to the port logic
+  //release both lines, relying on the pull-ups
+  cbi(TWI_DDR, TWI_SDA);
+  cbi(TWI_DDR, TWI_SCL);
+  sbi(TWI_PORT, TWI_SDA);
+  sbi(TWI_PORT, TWI_SCL);
+  delayMicroseconds(5);
+  for(uint8_t i = 0; (i < 9) && !(TWI_PIN & _BV(TWI_SDA)); i++)
+  {
+    cbi(TWI_PORT, TWI_SCL);
+    sbi(TWI_DDR, TWI_SCL); //drive SCL low
+    delayMicroseconds(5);
+    cbi(TWI_DDR, TWI_SCL);
+    sbi(TWI_PORT, TWI_SCL); //release SCL
+    delayMicroseconds(5);
+  }
+  //generate a STOP condition: SDA low to high while SCL is high
+  cbi(TWI_PORT, TWI_SDA);
+  sbi(TWI_DDR, TWI_SDA);
+  delayMicroseconds(5);
+  cbi(TWI_DDR, TWI_SDA);
+  sbi(TWI_PORT, TWI_SDA);
+  delayMicroseconds(5);
+  returnStatus = ((TWI_PIN & _BV(TWI_SDA)) && (TWI_PIN & _BV(TWI_SCL))) ? 0 : 1;
+  TWCR = _BV(TWEN) | _BV(TWEA); //reinitialize TWI
+  return(returnStatus);
+}
+
 
 /////////////// Private Methods ////////////////////////////////////////
 
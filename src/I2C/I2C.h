@@ -54,11 +54,13 @@
 */
 
 
+#ifndef USE_I2C_LIB
 #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega128__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega32U4__) 
 #define USE_I2C_LIB 1
 #else
 #define USE_I2C_LIB 0
 #endif
+#endif
 
 #if USE_I2C_LIB
 
@@ -91,7 +93,24 @@
 #define cbi(sfr, bit)   (_SFR_BYTE(sfr) &= ~_BV(bit))
 #define sbi(sfr, bit)   (_SFR_BYTE(sfr) |= _BV(bit))
 
+// Only used by the read() overloads without a destination buffer.
+#ifndef MAX_BUFFER_SIZE
 #define MAX_BUFFER_SIZE 32
+#endif
+
+#if defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__) || defined(__AVR_ATmega328P__)
+#define TWI_PORT        PORTC
+#define TWI_DDR         DDRC
+#define TWI_PIN         PINC
+#define TWI_SDA         4
+#define TWI_SCL         5
+#else
+#define TWI_PORT        PORTD
+#define TWI_DDR         DDRD
+#define TWI_PIN         PIND
+#define TWI_SDA         1
+#define TWI_SCL         0
+#endif
 
 
 
@@ -104,6 +123,7 @@ class I2C
     void end();
     void timeOut(uint16_t);
     void setSpeed(uint8_t); 
+    uint32_t setFrequency(uint32_t);
     void pullup(uint8_t);
     void scan();
     uint8_t available();
@@ -114,12 +134,14 @@ class I2C
     uint8_t write(int, int, int);
     uint8_t write(uint8_t, uint8_t, char*);
     uint8_t write(uint8_t, uint8_t, uint8_t*, uint8_t);
+    uint8_t write(uint8_t, uint8_t, uint8_t (*)(void*, uint8_t), void*);
     uint8_t read(uint8_t, uint8_t);
     uint8_t read(int, int);
     uint8_t read(uint8_t, uint8_t, uint8_t);
     uint8_t read(int, int, int);
     uint8_t read(uint8_t, uint8_t, uint8_t*);
     uint8_t read(uint8_t, uint8_t, uint8_t, uint8_t*);
+    uint8_t recover();
 
 
   private:
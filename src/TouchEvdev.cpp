@@ -0,0 +1,423 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchEvdev.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+#endif
+
+#if ZFORCE_EVDEV_SLOTS > 127
+#error "ZFORCE_EVDEV_SLOTS must be at most 127"
+#endif
+
+EvdevMemorySink::EvdevMemorySink()
+{
+  overflows = 0;
+  Clear();
+}
+
+bool EvdevMemorySink::Write(const EvdevEvent* events, uint8_t count)
+{
+  if ((uint16_t)(this->count + count) > ZFORCE_EVDEV_MEMORY_EVENTS)
+  {
+    overflows++;
+    return false;
+  }
+
+  memcpy(&this->events[this->count], events, count * sizeof(EvdevEvent));
+  this->count += count;
+  return true;
+}
+
+void EvdevMemorySink::Clear()
+{
+  count = 0;
+}
+
+#if defined(__linux__)
+EvdevUinputSink::EvdevUinputSink()
+{
+  fd = -1;
+}
+
+EvdevUinputSink::~EvdevUinputSink()
+{
+  Close();
+}
+
+bool EvdevUinputSink::Open(const char* name, int32_t maxX, int32_t maxY, int32_t maxMajor, const char* path)
+{
+  Close();
+  fd = open(path, O_WRONLY | O_NONBLOCK);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  const uint16_t axes[] = {ABS_X, ABS_Y, ABS_MT_SLOT, ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y, ABS_MT_TOUCH_MAJOR};
+  const int32_t maximums[] = {maxX, maxY, ZFORCE_EVDEV_SLOTS - 1, 65535, maxX, maxY, maxMajor};
+
+  bool ok = (ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0) &&
+            (ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH) >= 0) &&
+            (ioctl(fd, UI_SET_EVBIT, EV_ABS) >= 0) &&
+            (ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT) >= 0);
+
+  for (uint8_t i = 0; ok && (i < sizeof(axes) / sizeof(axes[0])); i++)
+  {
+    struct uinput_abs_setup axis;
+    memset(&axis, 0, sizeof(axis));
+    axis.code = axes[i];
+    axis.absinfo.maximum = maximums[i];
+    ok = (ioctl(fd, UI_SET_ABSBIT, axes[i]) >= 0) && (ioctl(fd, UI_ABS_SETUP, &axis) >= 0);
+  }
+
+  if (ok)
+  {
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+    ok = (ioctl(fd, UI_DEV_SETUP, &setup) >= 0) && (ioctl(fd, UI_DEV_CREATE) >= 0);
+  }
+
+  if (!ok)
+  {
+    close(fd);
+    fd = -1;
+  }
+  return ok;
+}
+
+void EvdevUinputSink::Close()
+{
+  if (fd >= 0)
+  {
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    fd = -1;
+  }
+}
+
+// The kernel sets the time of injected events, so it is left at zero.
+bool EvdevUinputSink::Write(const EvdevEvent* events, uint8_t count)
+{
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct input_event converted[ZFORCE_EVDEV_MAX_EVENTS];
+  while (count > 0)
+  {
+    uint8_t chunk = (count < ZFORCE_EVDEV_MAX_EVENTS) ? count : ZFORCE_EVDEV_MAX_EVENTS;
+    memset(converted, 0, chunk * sizeof(struct input_event));
+    for (uint8_t i = 0; i < chunk; i++)
+    {
+      converted[i].type = events[i].type;
+      converted[i].code = events[i].code;
+      converted[i].value = events[i].value;
+    }
+
+    ssize_t size = chunk * sizeof(struct input_event);
+    if (write(fd, converted, size) != size)
+    {
+      return false;
+    }
+    events += chunk;
+    count -= chunk;
+  }
+  return true;
+}
+#endif
+
+TouchEvdevEncoder::TouchEvdevEncoder()
+{
+  sink = nullptr;
+  nextTrackingId = 0;
+  memset(&statistics, 0, sizeof(statistics));
+  Reset();
+}
+
+void TouchEvdevEncoder::SetSink(EvdevSink* sink)
+{
+  this->sink = sink;
+}
+
+void TouchEvdevEncoder::Reset()
+{
+  memset(slots, 0, sizeof(slots));
+  currentSlot = -1;
+  touching = 0;
+  pointerX = 0;
+  pointerY = 0;
+  pointerSynced = false;
+  eventCount = 0;
+  frameChanged = false;
+  sinkFailed = false;
+  resync = false;
+}
+
+TouchEvdevStatistics TouchEvdevEncoder::GetStatistics()
+{
+  return statistics;
+}
+
+bool TouchEvdevEncoder::Update(const TouchFrame* frame)
+{
+  Resync();
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    UpdateTouch(frame->id[i], frame->event[i], frame->x[i], frame->y[i], frame->sizeX[i]);
+  }
+  return EndFrame();
+}
+
+bool TouchEvdevEncoder::Update(TouchMessage* msg)
+{
+  Resync();
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    TouchData* touch = &msg->touchData[i];
+    UpdateTouch(touch->id, touch->event, touch->x, touch->y, touch->sizeX);
+  }
+  return EndFrame();
+}
+
+bool TouchEvdevEncoder::ReleaseAll()
+{
+  Resync();
+  for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+  {
+    if (slots[i].active)
+    {
+      SelectSlot(i);
+      Emit(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, -1);
+      slots[i].active = false;
+    }
+  }
+  return EndFrame();
+}
+
+// Sends the tracking id of every slot again after a failed write, in case it was lost.
+void TouchEvdevEncoder::Resync()
+{
+  if (!resync)
+  {
+    return;
+  }
+
+  for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+  {
+    SelectSlot(i);
+    Emit(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, slots[i].active ? slots[i].trackingId : -1);
+  }
+  resync = false;
+}
+
+/*
+ * A DOWN for an id that is already down starts a new contact in the same slot, and
+ * a MOVE for an id that is not down starts a contact, as the DOWN was probably
+ * dropped by the touch filter. GHOST and INVALID touches are ignored.
+ */
+void TouchEvdevEncoder::UpdateTouch(uint8_t id, TouchEvent event, int32_t x, int32_t y, int32_t major)
+{
+  if ((event != TouchEvent::DOWN) && (event != TouchEvent::MOVE) && (event != TouchEvent::UP))
+  {
+    return;
+  }
+
+  int8_t slot = -1;
+  int8_t freeSlot = -1;
+  for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+  {
+    if (slots[i].active && (slots[i].id == id))
+    {
+      slot = i;
+      break;
+    }
+    if (!slots[i].active && (freeSlot < 0))
+    {
+      freeSlot = i;
+    }
+  }
+
+  if (event == TouchEvent::UP)
+  {
+    if (slot >= 0)
+    {
+      SelectSlot(slot);
+      Emit(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, -1);
+      slots[slot].active = false;
+    }
+    return;
+  }
+
+  if (slot < 0)
+  {
+    if (freeSlot < 0)
+    {
+      statistics.droppedTouches++;
+      return;
+    }
+    slot = freeSlot;
+    StartContact(slot, id);
+  }
+  else if (event == TouchEvent::DOWN)
+  {
+    StartContact(slot, id);
+  }
+
+  EvdevSlot* state = &slots[slot];
+  SetAxis(slot, ZFORCE_ABS_MT_POSITION_X, &state->x, x);
+  SetAxis(slot, ZFORCE_ABS_MT_POSITION_Y, &state->y, y);
+  SetAxis(slot, ZFORCE_ABS_MT_TOUCH_MAJOR, &state->major, major);
+  state->synced = true;
+}
+
+void TouchEvdevEncoder::StartContact(uint8_t slot, uint8_t id)
+{
+  SelectSlot(slot);
+  slots[slot].trackingId = nextTrackingId++;
+  Emit(ZFORCE_EV_ABS, ZFORCE_ABS_MT_TRACKING_ID, slots[slot].trackingId);
+  slots[slot].active = true;
+  slots[slot].id = id;
+  statistics.contacts++;
+}
+
+// The kernel keeps the axes of a slot between contacts, so an axis is only sent when
+// it differs from the value last sent for the slot.
+void TouchEvdevEncoder::SetAxis(uint8_t slot, uint16_t code, int32_t* current, int32_t value)
+{
+  if (!slots[slot].synced || (*current != value))
+  {
+    SelectSlot(slot);
+    Emit(ZFORCE_EV_ABS, code, value);
+    *current = value;
+  }
+}
+
+void TouchEvdevEncoder::SelectSlot(uint8_t slot)
+{
+  if (currentSlot != (int8_t)slot)
+  {
+    Emit(ZFORCE_EV_ABS, ZFORCE_ABS_MT_SLOT, slot);
+    currentSlot = slot;
+  }
+}
+
+void TouchEvdevEncoder::Emit(uint16_t type, uint16_t code, int32_t value)
+{
+  if (eventCount == ZFORCE_EVDEV_MAX_EVENTS)
+  {
+    Flush();
+  }
+
+  EvdevEvent* event = &events[eventCount++];
+  event->type = type;
+  event->code = code;
+  event->value = value;
+  frameChanged = true;
+}
+
+/*
+ * Writes the buffered events to the sink. If that fails, all state is marked as
+ * unsent, so that the next frame sends every contact and axis again.
+ */
+bool TouchEvdevEncoder::Flush()
+{
+  if (eventCount == 0)
+  {
+    return true;
+  }
+
+  bool ok = (sink != nullptr) && sink->Write(events, eventCount);
+  if (ok)
+  {
+    statistics.events += eventCount;
+  }
+  else
+  {
+    statistics.sinkErrors++;
+    sinkFailed = true;
+    for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+    {
+      slots[i].synced = false;
+    }
+    currentSlot = -1;
+    pointerSynced = false;
+    touching = -1;
+    resync = true;
+  }
+  eventCount = 0;
+  return ok;
+}
+
+// Sends the single touch state of the lowest slot in use and SYN_REPORT, if anything changed.
+bool TouchEvdevEncoder::EndFrame()
+{
+  int8_t pointer = -1;
+  for (uint8_t i = 0; i < ZFORCE_EVDEV_SLOTS; i++)
+  {
+    if (slots[i].active)
+    {
+      pointer = i;
+      break;
+    }
+  }
+
+  int8_t nowTouching = (pointer >= 0) ? 1 : 0;
+  if (nowTouching != touching)
+  {
+    touching = nowTouching;
+    Emit(ZFORCE_EV_KEY, ZFORCE_BTN_TOUCH, touching);
+  }
+  if (pointer >= 0)
+  {
+    if (!pointerSynced || (pointerX != slots[pointer].x))
+    {
+      pointerX = slots[pointer].x;
+      Emit(ZFORCE_EV_ABS, ZFORCE_ABS_X, pointerX);
+    }
+    if (!pointerSynced || (pointerY != slots[pointer].y))
+    {
+      pointerY = slots[pointer].y;
+      Emit(ZFORCE_EV_ABS, ZFORCE_ABS_Y, pointerY);
+    }
+    pointerSynced = true;
+  }
+
+  if (frameChanged)
+  {
+    Emit(ZFORCE_EV_SYN, ZFORCE_SYN_REPORT, 0);
+    statistics.reports++;
+  }
+  Flush();
+
+  bool ok = !sinkFailed;
+  frameChanged = false;
+  sinkFailed = false;
+  return ok;
+}
@@ -0,0 +1,166 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * Converts touch frames to the event sequence of the Linux multi-touch protocol B
+ * (Documentation/input/multi-touch-protocol.rst in the kernel sources), so that
+ * touches can be fed to X11 or Wayland through uinput when the library runs on a
+ * Linux host.
+ *
+ * Each touch id is given a slot for as long as it is down. For each frame, only the
+ * slots and axes that changed since the previous frame are sent, followed by
+ * SYN_REPORT, and nothing at all is sent for a frame without changes. A contact
+ * starts with a new ABS_MT_TRACKING_ID and ends with ABS_MT_TRACKING_ID -1.
+ * BTN_TOUCH, ABS_X and ABS_Y are sent as well, following the lowest slot in use,
+ * for applications that only handle a single touch.
+ */
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Event types and codes, same values as in linux/input-event-codes.h.
+#define ZFORCE_EV_SYN 0x00
+#define ZFORCE_EV_KEY 0x01
+#define ZFORCE_EV_ABS 0x03
+#define ZFORCE_SYN_REPORT 0x00
+#define ZFORCE_BTN_TOUCH 0x14A
+#define ZFORCE_ABS_X 0x00
+#define ZFORCE_ABS_Y 0x01
+#define ZFORCE_ABS_MT_SLOT 0x2F
+#define ZFORCE_ABS_MT_TOUCH_MAJOR 0x30
+#define ZFORCE_ABS_MT_POSITION_X 0x35
+#define ZFORCE_ABS_MT_POSITION_Y 0x36
+#define ZFORCE_ABS_MT_TRACKING_ID 0x39
+
+// Number of contacts tracked at the same time.
+#ifndef ZFORCE_EVDEV_SLOTS
+#define ZFORCE_EVDEV_SLOTS ZFORCE_MAX_TOUCHES
+#endif
+// Events buffered before they are written to the sink: slot, tracking id and three
+// axes per contact, and BTN_TOUCH, ABS_X, ABS_Y and SYN_REPORT.
+#define ZFORCE_EVDEV_MAX_EVENTS (ZFORCE_EVDEV_SLOTS * 5 + 4)
+#ifndef ZFORCE_EVDEV_MEMORY_EVENTS
+#define ZFORCE_EVDEV_MEMORY_EVENTS 128
+#endif
+
+typedef struct EvdevEvent
+{
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+} EvdevEvent;
+
+// Receives the events of the encoder, e.g. EvdevUinputSink or EvdevMemorySink.
+class EvdevSink
+{
+	public:
+		virtual ~EvdevSink() {}
+		// Returns false if the events could not be delivered.
+		virtual bool Write(const EvdevEvent* events, uint8_t count) = 0;
+};
+
+// Keeps the events in memory, for tests or for forwarding them in some other way.
+class EvdevMemorySink : public EvdevSink
+{
+	public:
+		EvdevMemorySink();
+		// Fails and counts an overflow if the events do not fit.
+		bool Write(const EvdevEvent* events, uint8_t count);
+		void Clear();
+		EvdevEvent events[ZFORCE_EVDEV_MEMORY_EVENTS];
+		uint16_t count;
+		uint32_t overflows;
+};
+
+#if defined(__linux__)
+// Creates a touchscreen input device through /dev/uinput, which needs write access
+// to it, and injects the events into it.
+class EvdevUinputSink : public EvdevSink
+{
+	public:
+		EvdevUinputSink();
+		~EvdevUinputSink();
+		// The axes range from 0 up to and including the given maximums, normally the
+		// touch active area and the largest touch size of the sensor.
+		bool Open(const char* name, int32_t maxX, int32_t maxY, int32_t maxMajor, const char* path = "/dev/uinput");
+		void Close();
+		bool Write(const EvdevEvent* events, uint8_t count);
+	private:
+		int fd;
+};
+#endif
+
+typedef struct TouchEvdevStatistics
+{
+	uint32_t reports;        // SYN_REPORTs sent, one per frame with changes
+	uint32_t events;         // events sent, including SYN_REPORT
+	uint32_t contacts;       // contacts started
+	uint32_t droppedTouches; // touches dropped because all slots were in use
+	uint32_t sinkErrors;     // failed writes to the sink
+} TouchEvdevStatistics;
+
+typedef struct EvdevSlot
+{
+	bool active;
+	bool synced;      // x, y and major are the values last sent for the slot
+	uint8_t id;
+	int32_t trackingId;
+	int32_t x;
+	int32_t y;
+	int32_t major;
+} EvdevSlot;
+
+class TouchEvdevEncoder
+{
+	public:
+		TouchEvdevEncoder();
+		void SetSink(EvdevSink* sink);
+		// Sends the changes of a frame. Returns false if the sink failed.
+		bool Update(const TouchFrame* frame);
+		bool Update(TouchMessage* msg);
+		// Ends all contacts, e.g. when the sensor is disabled or has restarted.
+		bool ReleaseAll();
+		// Forgets all state without sending anything, e.g. for a new sink.
+		void Reset();
+		TouchEvdevStatistics GetStatistics();
+	private:
+		void Resync();
+		void UpdateTouch(uint8_t id, TouchEvent event, int32_t x, int32_t y, int32_t major);
+		void StartContact(uint8_t slot, uint8_t id);
+		void SetAxis(uint8_t slot, uint16_t code, int32_t* current, int32_t value);
+		void SelectSlot(uint8_t slot);
+		void Emit(uint16_t type, uint16_t code, int32_t value);
+		bool Flush();
+		bool EndFrame();
+		EvdevSink* sink;
+		EvdevSlot slots[ZFORCE_EVDEV_SLOTS];
+		int8_t currentSlot;     // slot of the last ABS_MT_SLOT, -1 before the first
+		uint16_t nextTrackingId;
+		int8_t touching;        // last BTN_TOUCH value, -1 when unknown
+		int32_t pointerX;
+		int32_t pointerY;
+		bool pointerSynced;
+		EvdevEvent events[ZFORCE_EVDEV_MAX_EVENTS];
+		uint8_t eventCount;
+		bool frameChanged;
+		bool sinkFailed;
+		bool resync;            // a write failed, so the contacts of all slots are sent again
+		TouchEvdevStatistics statistics;
+};
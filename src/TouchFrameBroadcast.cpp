@@ -0,0 +1,224 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include "TouchFrameBroadcast.h"
+
+#if (ZFORCE_BROADCAST_SIZE & (ZFORCE_BROADCAST_SIZE - 1)) || (ZFORCE_BROADCAST_SIZE < 2)
+#error "ZFORCE_BROADCAST_SIZE must be a power of two of at least 2"
+#endif
+
+#define SLOT_INDEX(number) ((number) & (ZFORCE_BROADCAST_SIZE - 1))
+
+static uint32_t Load(QueueCounter* value)
+{
+#if ZFORCE_HAS_ATOMIC
+  return value->load(std::memory_order_acquire);
+#else
+  return *value;
+#endif
+}
+
+static void Store(QueueCounter* value, uint32_t newValue)
+{
+#if ZFORCE_HAS_ATOMIC
+  value->store(newValue, std::memory_order_release);
+#else
+  *value = newValue;
+#endif
+}
+
+// Keeps the reads of a frame from being moved past the check of its sequence number.
+static void ReadFence()
+{
+#if ZFORCE_HAS_ATOMIC
+  std::atomic_thread_fence(std::memory_order_acquire);
+#endif
+}
+
+TouchFrameBroadcast::TouchFrameBroadcast()
+{
+  Store(&head, 0);
+  for (uint8_t i = 0; i < ZFORCE_BROADCAST_SIZE; i++)
+  {
+    Store(&sequences[i], 0);
+  }
+  memset(subscribers, 0, sizeof(subscribers));
+}
+
+/*
+ * Producer side. The sequence number of the slot is cleared first, so that a
+ * subscriber still reading the previous frame in it notices when it releases it.
+ */
+TouchFrame* TouchFrameBroadcast::BeginPublish()
+{
+  uint32_t number = Load(&head);
+  Store(&sequences[SLOT_INDEX(number)], 0);
+#if ZFORCE_HAS_ATOMIC
+  std::atomic_thread_fence(std::memory_order_release);
+#endif
+  return &slots[SLOT_INDEX(number)];
+}
+
+void TouchFrameBroadcast::CommitPublish()
+{
+  uint32_t number = Load(&head);
+  Store(&sequences[SLOT_INDEX(number)], number + 1);
+  Store(&head, number + 1);
+}
+
+void TouchFrameBroadcast::Publish(const TouchFrame* frame)
+{
+  memcpy(BeginPublish(), frame, sizeof(TouchFrame));
+  CommitPublish();
+}
+
+uint32_t TouchFrameBroadcast::GetPublished()
+{
+  return Load(&head);
+}
+
+int8_t TouchFrameBroadcast::Subscribe(BroadcastPolicy policy)
+{
+  for (uint8_t i = 0; i < ZFORCE_BROADCAST_MAX_SUBSCRIBERS; i++)
+  {
+    if (!subscribers[i].active)
+    {
+      memset(&subscribers[i], 0, sizeof(BroadcastSubscriber));
+      subscribers[i].policy = policy;
+      subscribers[i].cursor = Load(&head);
+      subscribers[i].active = true;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void TouchFrameBroadcast::Unsubscribe(int8_t subscriber)
+{
+  if ((subscriber >= 0) && (subscriber < ZFORCE_BROADCAST_MAX_SUBSCRIBERS))
+  {
+    subscribers[subscriber].active = false;
+  }
+}
+
+/*
+ * Handles a subscriber whose next frame has already been overwritten, according to
+ * its policy. A skipping subscriber continues one frame after the oldest one left,
+ * since the oldest is the next to be overwritten.
+ *
+ * Return value   false if the subscriber was dropped.
+ */
+bool TouchFrameBroadcast::CatchUp(BroadcastSubscriber* subscriber, uint32_t currentHead)
+{
+  if ((uint32_t)(currentHead - subscriber->cursor) <= ZFORCE_BROADCAST_SIZE)
+  {
+    return true;
+  }
+
+  if (subscriber->policy == BroadcastPolicy::DROP)
+  {
+    subscriber->statistics.dropped = true;
+    return false;
+  }
+
+  uint32_t oldest = currentHead - ZFORCE_BROADCAST_SIZE + 1;
+  subscriber->statistics.skipped += oldest - subscriber->cursor;
+  subscriber->cursor = oldest;
+  return true;
+}
+
+const TouchFrame* TouchFrameBroadcast::Peek(int8_t subscriber)
+{
+  if ((subscriber < 0) || (subscriber >= ZFORCE_BROADCAST_MAX_SUBSCRIBERS))
+  {
+    return nullptr;
+  }
+
+  BroadcastSubscriber* reader = &subscribers[subscriber];
+  if (!reader->active || reader->statistics.dropped)
+  {
+    return nullptr;
+  }
+
+  uint32_t currentHead = Load(&head);
+  if ((reader->cursor == currentHead) || !CatchUp(reader, currentHead))
+  {
+    return nullptr;
+  }
+
+  // The slot may already be in the middle of being reused.
+  while (Load(&sequences[SLOT_INDEX(reader->cursor)]) != reader->cursor + 1)
+  {
+    reader->statistics.skipped++;
+    reader->cursor++;
+    currentHead = Load(&head);
+    if ((reader->cursor == currentHead) || !CatchUp(reader, currentHead))
+    {
+      return nullptr;
+    }
+  }
+
+  return &slots[SLOT_INDEX(reader->cursor)];
+}
+
+bool TouchFrameBroadcast::Release(int8_t subscriber)
+{
+  if ((subscriber < 0) || (subscriber >= ZFORCE_BROADCAST_MAX_SUBSCRIBERS))
+  {
+    return false;
+  }
+
+  BroadcastSubscriber* reader = &subscribers[subscriber];
+  ReadFence();
+  bool intact = (Load(&sequences[SLOT_INDEX(reader->cursor)]) == reader->cursor + 1);
+  if (intact)
+  {
+    reader->statistics.received++;
+  }
+  else
+  {
+    reader->statistics.overruns++;
+  }
+  reader->cursor++;
+  return intact;
+}
+
+uint32_t TouchFrameBroadcast::Pending(int8_t subscriber)
+{
+  if ((subscriber < 0) || (subscriber >= ZFORCE_BROADCAST_MAX_SUBSCRIBERS) || !subscribers[subscriber].active)
+  {
+    return 0;
+  }
+
+  uint32_t pending = Load(&head) - subscribers[subscriber].cursor;
+  return (pending > ZFORCE_BROADCAST_SIZE) ? ZFORCE_BROADCAST_SIZE : pending;
+}
+
+SubscriberStatistics TouchFrameBroadcast::GetStatistics(int8_t subscriber)
+{
+  SubscriberStatistics statistics;
+  if ((subscriber < 0) || (subscriber >= ZFORCE_BROADCAST_MAX_SUBSCRIBERS))
+  {
+    memset(&statistics, 0, sizeof(statistics));
+    return statistics;
+  }
+  return subscribers[subscriber].statistics;
+}
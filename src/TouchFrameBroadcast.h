@@ -0,0 +1,105 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+#include "TouchFrameQueue.h"
+
+// Number of frame slots, must be a power of two.
+#ifndef ZFORCE_BROADCAST_SIZE
+#define ZFORCE_BROADCAST_SIZE 8
+#endif
+#ifndef ZFORCE_BROADCAST_MAX_SUBSCRIBERS
+#define ZFORCE_BROADCAST_MAX_SUBSCRIBERS 4
+#endif
+
+// What happens to a subscriber that falls more than ZFORCE_BROADCAST_SIZE frames behind.
+enum class BroadcastPolicy : uint8_t
+{
+	SKIP,  // continues with the oldest frame still available
+	DROP   // stops receiving frames until it subscribes again
+};
+
+typedef struct SubscriberStatistics
+{
+	uint32_t received;  // frames released after being read intact
+	uint32_t skipped;   // frames overwritten before they were read
+	uint32_t overruns;  // frames overwritten while they were being read
+	bool dropped;       // the subscriber was dropped for falling behind
+} SubscriberStatistics;
+
+typedef struct BroadcastSubscriber
+{
+	bool active;
+	BroadcastPolicy policy;
+	uint32_t cursor;  // number of the next frame to read
+	SubscriberStatistics statistics;
+} BroadcastSubscriber;
+
+/*
+ * Ring of touch frames written by one producer and read by up to
+ * ZFORCE_BROADCAST_MAX_SUBSCRIBERS subscribers, each at its own pace, e.g. a HID
+ * bridge, a recorder and analytics fed from the same sensor.
+ *
+ * The producer never waits for subscribers, but overwrites the oldest frame. Each
+ * subscriber reads frames in place and learns from Release() whether the frame was
+ * overwritten while being read, in which case what was read must be discarded.
+ * With <atomic> the producer and each subscriber may run on their own thread,
+ * otherwise they must all run in the same context. Subscribe() and Unsubscribe()
+ * must not be called concurrently with each other or with the subscriber's own reads.
+ *
+ * As in a seqlock, writing a frame into a slot is not synchronized with subscribers
+ * reading the previous frame in it. This data race is by design and is detected by
+ * Release() afterwards, but a race detector such as ThreadSanitizer reports it
+ * unless the subscriber's reads of the frame are excluded from its checks.
+ *
+ * Producer:    TouchFrame* slot = broadcast.BeginPublish();
+ *              if (zforce.GetTouchFrame(slot, nullptr)) broadcast.CommitPublish();
+ * Subscriber:  const TouchFrame* frame = broadcast.Peek(id);
+ *              if (frame != nullptr) { ...; if (!broadcast.Release(id)) discard; }
+ */
+class TouchFrameBroadcast
+{
+	public:
+		TouchFrameBroadcast();
+		// Returns the slot for the next frame, which is published with CommitPublish().
+		// Calling BeginPublish() again without committing reuses the same slot.
+		TouchFrame* BeginPublish();
+		void CommitPublish();
+		void Publish(const TouchFrame* frame);
+		// Returns the id of the new subscriber, or -1 if there is no room. Subscribers
+		// receive the frames published after subscribing.
+		int8_t Subscribe(BroadcastPolicy policy);
+		void Unsubscribe(int8_t subscriber);
+		// Returns the next frame of subscriber, or nullptr if there is none.
+		const TouchFrame* Peek(int8_t subscriber);
+		// Moves on to the next frame. Returns false if the frame returned by Peek()
+		// was overwritten while it was being read.
+		bool Release(int8_t subscriber);
+		uint32_t Pending(int8_t subscriber);
+		SubscriberStatistics GetStatistics(int8_t subscriber);
+		uint32_t GetPublished();
+	private:
+		bool CatchUp(BroadcastSubscriber* subscriber, uint32_t currentHead);
+		TouchFrame slots[ZFORCE_BROADCAST_SIZE];
+		QueueCounter sequences[ZFORCE_BROADCAST_SIZE];  // number of the frame in each slot plus one, 0 while it is written
+		QueueCounter head;                              // number of frames published
+		BroadcastSubscriber subscribers[ZFORCE_BROADCAST_MAX_SUBSCRIBERS];
+};
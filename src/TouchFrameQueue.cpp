@@ -0,0 +1,173 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include "TouchFrameQueue.h"
+
+#if (ZFORCE_FRAME_QUEUE_SIZE & (ZFORCE_FRAME_QUEUE_SIZE - 1)) || (ZFORCE_FRAME_QUEUE_SIZE > 128)
+#error "ZFORCE_FRAME_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+#define SLOT(index) (slots[(index) & (ZFORCE_FRAME_QUEUE_SIZE - 1)])
+
+TouchFrameQueue::TouchFrameQueue()
+{
+  head = 0;
+  tail = 0;
+  pushed = 0;
+  popped = 0;
+  full = 0;
+  empty = 0;
+  highWater = 0;
+}
+
+// The indices run freely from 0 to 255, their difference is the number of queued frames.
+uint8_t TouchFrameQueue::LoadHead()
+{
+#if ZFORCE_HAS_ATOMIC
+  return head.load(std::memory_order_acquire);
+#else
+  return head;
+#endif
+}
+
+uint8_t TouchFrameQueue::LoadTail()
+{
+#if ZFORCE_HAS_ATOMIC
+  return tail.load(std::memory_order_acquire);
+#else
+  return tail;
+#endif
+}
+
+// Each counter has a single writer, so a plain read-modify-write is enough.
+void TouchFrameQueue::Increment(QueueCounter* counter)
+{
+#if ZFORCE_HAS_ATOMIC
+  counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#else
+  *counter = *counter + 1;
+#endif
+}
+
+/*
+ * Producer side. Returns the slot to fill with the next frame, or nullptr if the
+ * queue is full. The frame is published with CommitPush().
+ */
+TouchFrame* TouchFrameQueue::BeginPush()
+{
+  uint8_t currentHead = LoadHead();
+  if ((uint8_t)(currentHead - LoadTail()) == ZFORCE_FRAME_QUEUE_SIZE)
+  {
+    Increment(&full);
+    return nullptr;
+  }
+
+  return &SLOT(currentHead);
+}
+
+void TouchFrameQueue::CommitPush()
+{
+  uint8_t currentHead = LoadHead() + 1;
+  uint8_t count = currentHead - LoadTail();
+#if ZFORCE_HAS_ATOMIC
+  head.store(currentHead, std::memory_order_release);
+  if (count > highWater.load(std::memory_order_relaxed))
+  {
+    highWater.store(count, std::memory_order_relaxed);
+  }
+#else
+  head = currentHead;
+  if (count > highWater)
+  {
+    highWater = count;
+  }
+#endif
+  Increment(&pushed);
+}
+
+bool TouchFrameQueue::Push(const TouchFrame* frame)
+{
+  TouchFrame* slot = BeginPush();
+  if (slot == nullptr)
+  {
+    return false;
+  }
+
+  memcpy(slot, frame, sizeof(TouchFrame));
+  CommitPush();
+  return true;
+}
+
+/*
+ * Consumer side. Returns the oldest frame, or nullptr if the queue is empty.
+ * The frame stays valid until Release() is called.
+ */
+const TouchFrame* TouchFrameQueue::Peek()
+{
+  uint8_t currentTail = LoadTail();
+  if (currentTail == LoadHead())
+  {
+    Increment(&empty);
+    return nullptr;
+  }
+
+  return &SLOT(currentTail);
+}
+
+void TouchFrameQueue::Release()
+{
+  uint8_t currentTail = LoadTail() + 1;
+#if ZFORCE_HAS_ATOMIC
+  tail.store(currentTail, std::memory_order_release);
+#else
+  tail = currentTail;
+#endif
+  Increment(&popped);
+}
+
+bool TouchFrameQueue::Pop(TouchFrame* frame)
+{
+  const TouchFrame* slot = Peek();
+  if (slot == nullptr)
+  {
+    return false;
+  }
+
+  memcpy(frame, slot, sizeof(TouchFrame));
+  Release();
+  return true;
+}
+
+uint8_t TouchFrameQueue::Count()
+{
+  return LoadHead() - LoadTail();
+}
+
+FrameQueueStatistics TouchFrameQueue::GetStatistics()
+{
+  FrameQueueStatistics statistics;
+  statistics.pushed = pushed;
+  statistics.popped = popped;
+  statistics.full = full;
+  statistics.empty = empty;
+  statistics.highWater = highWater;
+  return statistics;
+}
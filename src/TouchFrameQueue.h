@@ -0,0 +1,87 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Number of frame slots, must be a power of two no larger than 128.
+#ifndef ZFORCE_FRAME_QUEUE_SIZE
+#define ZFORCE_FRAME_QUEUE_SIZE 4
+#endif
+
+#if !defined(__AVR__) && defined(__has_include)
+#if __has_include(<atomic>)
+#include <atomic>
+#define ZFORCE_HAS_ATOMIC 1
+#endif
+#endif
+
+#if ZFORCE_HAS_ATOMIC
+typedef std::atomic<uint8_t> QueueIndex;
+typedef std::atomic<uint32_t> QueueCounter;
+#else
+typedef volatile uint8_t QueueIndex;   // Single byte accesses are atomic on AVR
+typedef volatile uint32_t QueueCounter;
+#endif
+
+typedef struct FrameQueueStatistics
+{
+	uint32_t pushed;
+	uint32_t popped;
+	uint32_t full;      // times the producer found the queue full
+	uint32_t empty;     // times the consumer found the queue empty
+	uint8_t highWater;  // largest number of frames queued at once
+} FrameQueueStatistics;
+
+/*
+ * Lock-free queue of touch frames between exactly one producer and one consumer,
+ * e.g. a thread or core that reads the sensor and one that uses the touches.
+ * Frames are decoded directly into the slots, so nothing is allocated per frame.
+ *
+ * Producer:  TouchFrame* slot = queue.BeginPush();
+ *            if (slot != nullptr && zforce.GetTouchFrame(slot, nullptr)) queue.CommitPush();
+ * Consumer:  const TouchFrame* frame = queue.Peek();
+ *            if (frame != nullptr) { ...; queue.Release(); }
+ */
+class TouchFrameQueue
+{
+	public:
+		TouchFrameQueue();
+		TouchFrame* BeginPush();
+		void CommitPush();
+		bool Push(const TouchFrame* frame);
+		const TouchFrame* Peek();
+		void Release();
+		bool Pop(TouchFrame* frame);
+		uint8_t Count();
+		FrameQueueStatistics GetStatistics();
+	private:
+		uint8_t LoadHead();
+		uint8_t LoadTail();
+		void Increment(QueueCounter* counter);
+		TouchFrame slots[ZFORCE_FRAME_QUEUE_SIZE];
+		QueueIndex head;  // written by the producer only
+		QueueIndex tail;  // written by the consumer only
+		QueueCounter pushed;
+		QueueCounter popped;
+		QueueCounter full;
+		QueueCounter empty;
+		QueueIndex highWater;
+};
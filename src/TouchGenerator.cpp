@@ -0,0 +1,467 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchGenerator.h"
+
+#define HEADER_LENGTH 10        // i2c header, message type, ASN.1 length, address, tag and length
+#define MAX_SHORT_LENGTH 127    // The parser only handles single byte ASN.1 lengths
+#define TIMESTAMP_TAG 0x58
+
+// One quarter of a sine wave in 16 steps, scaled to 32767.
+static const int16_t quarterSine[17] = {0, 3212, 6393, 9512, 12539, 15446, 18204, 20787, 23170,
+                                         25329, 27245, 28898, 30273, 31356, 32137, 32609, 32767};
+
+// Sine of phase, where 1024 is a full turn.
+static int32_t Sine(uint16_t phase)
+{
+  phase &= 1023;
+  uint16_t quarterPhase = phase & 255;
+  if (phase & 256)
+  {
+    quarterPhase = 256 - quarterPhase;
+  }
+
+  uint8_t index = quarterPhase >> 4;
+  uint8_t fraction = quarterPhase & 15;
+  int32_t value = quarterSine[index];
+  if (fraction)
+  {
+    value += ((int32_t)(quarterSine[index + 1] - quarterSine[index]) * fraction) >> 4;
+  }
+
+  return (phase & 512) ? -value : value;
+}
+
+static uint16_t Clamp(int32_t value)
+{
+  return (value < 0) ? 0 : ((value > 0xFFFF) ? 0xFFFF : (uint16_t)value);
+}
+
+TouchGenerator::TouchGenerator()
+{
+  static const TouchDescriptor defaultDescriptor[] = {TouchDescriptor::Id, TouchDescriptor::Event,
+                                                      TouchDescriptor::LocXByte1, TouchDescriptor::LocXByte2,
+                                                      TouchDescriptor::LocYByte1, TouchDescriptor::LocYByte2,
+                                                      TouchDescriptor::SizeXByte1};
+  SetTouchFormat(defaultDescriptor, sizeof(defaultDescriptor));
+  timestampLength = 2;
+  framePeriod = 1000;
+  time = 0;
+  memset(&injection, 0, sizeof(injection));
+  randomState = 1;
+  memset(&statistics, 0, sizeof(statistics));
+  ClearFingers();
+}
+
+/*
+ * The descriptor lists the fields of a touch in the order they are sent, which
+ * is also the order of the bits in the touch format response.
+ */
+bool TouchGenerator::SetTouchFormat(const TouchDescriptor* descriptor, uint8_t count)
+{
+  bool hasId = false;
+  bool hasEvent = false;
+
+  if ((count == 0) || (count > (uint8_t)TouchDescriptor::MaxValue))
+  {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if ((descriptor[i] >= TouchDescriptor::MaxValue) || ((i > 0) && (descriptor[i] <= descriptor[i - 1])))
+    {
+      return false;
+    }
+    hasId |= (descriptor[i] == TouchDescriptor::Id);
+    hasEvent |= (descriptor[i] == TouchDescriptor::Event);
+  }
+
+  if (!hasId || !hasEvent)
+  {
+    return false;
+  }
+
+  memcpy(this->descriptor, descriptor, count * sizeof(TouchDescriptor));
+  descriptorLength = count;
+  return true;
+}
+
+void TouchGenerator::SetTimestampLength(uint8_t length)
+{
+  timestampLength = (length > 4) ? 4 : length;
+}
+
+void TouchGenerator::SetFrameRate(uint32_t framesPerSecond)
+{
+  framePeriod = (framesPerSecond > 0) ? (1000000UL / framesPerSecond) : 1000000UL;
+}
+
+void TouchGenerator::SetFinger(uint8_t index, const FingerPath* path)
+{
+  if (index < ZFORCE_GENERATOR_MAX_FINGERS)
+  {
+    fingers[index] = *path;
+    fingerUsed[index] = true;
+    fingerDown[index] = false;
+  }
+}
+
+void TouchGenerator::ClearFingers()
+{
+  memset(fingerUsed, 0, sizeof(fingerUsed));
+  memset(fingerDown, 0, sizeof(fingerDown));
+}
+
+void TouchGenerator::SetInjection(const GeneratorInjection* injection, uint32_t seed)
+{
+  this->injection = *injection;
+  randomState = (seed != 0) ? seed : 1;
+}
+
+uint32_t TouchGenerator::GetTime()
+{
+  return time;
+}
+
+GeneratorStatistics TouchGenerator::GetStatistics()
+{
+  return statistics;
+}
+
+uint8_t TouchGenerator::NextMessage(uint8_t* buffer)
+{
+  time += framePeriod;
+
+  if (Chance(injection.bootCompleteRate))
+  {
+    return BootComplete(buffer);
+  }
+  if (Chance(injection.malformedRate))
+  {
+    return Malformed(buffer);
+  }
+
+  return TouchNotification(buffer);
+}
+
+uint8_t TouchGenerator::WriteHeader(uint8_t* buffer, uint8_t type)
+{
+  buffer[0] = 0xEE;
+  buffer[2] = type;
+  buffer[4] = 0x40;
+  buffer[5] = 0x02;
+  buffer[6] = 0x02;
+  buffer[7] = 0x00;
+  return 8;
+}
+
+uint8_t TouchGenerator::TouchFormatResponse(uint8_t* buffer)
+{
+  uint8_t length = WriteHeader(buffer, 0xEF);
+  uint32_t bits = 0;
+
+  for (uint8_t i = 0; i < descriptorLength; i++)
+  {
+    bits |= 0x80000000UL >> (uint8_t)descriptor[i];
+  }
+
+  buffer[length++] = 0x66;
+  buffer[length++] = 6;
+  buffer[length++] = 0x80;
+  buffer[length++] = 4;  // Three bytes of bits plus the unused bits count
+  buffer[length++] = 24 - (uint8_t)TouchDescriptor::MaxValue;
+  buffer[length++] = (uint8_t)(bits >> 24);
+  buffer[length++] = (uint8_t)(bits >> 16);
+  buffer[length++] = (uint8_t)(bits >> 8);
+
+  buffer[1] = length - 2;
+  buffer[3] = length - 4;
+  return length;
+}
+
+uint8_t TouchGenerator::BootComplete(uint8_t* buffer)
+{
+  uint8_t length = WriteHeader(buffer, 0xF0);
+
+  buffer[length++] = 0x63;
+  buffer[length++] = 3;
+  buffer[length++] = 0x82;
+  buffer[length++] = 1;
+  buffer[length++] = 0x00;
+
+  buffer[1] = length - 2;
+  buffer[3] = length - 4;
+  statistics.bootCompletes++;
+  return length;
+}
+
+/*
+ * Valid touch notifications with one thing wrong: a touch count larger than the
+ * message, a message cut off in the middle of a touch, or an unknown tag or type.
+ */
+uint8_t TouchGenerator::Malformed(uint8_t* buffer)
+{
+  uint8_t length = TouchNotification(buffer);
+  uint8_t expectedTouchLength = descriptorLength + 2;
+
+  if (length == 0)
+  {
+    length = BootComplete(buffer);
+    statistics.bootCompletes--;
+  }
+  else
+  {
+    statistics.touchNotifications--;
+  }
+
+  switch (Random() % 4)
+  {
+    case 0:
+      buffer[9] += expectedTouchLength;
+      break;
+    case 1:
+      if (length > HEADER_LENGTH + 1)
+      {
+        length -= (length - HEADER_LENGTH) / 2 + 1;
+        buffer[1] = length - 2;
+        buffer[3] = length - 4;
+      }
+      break;
+    case 2:
+      buffer[8] = 0xA5;
+      break;
+    default:
+      buffer[2] = 0x00;
+      break;
+  }
+
+  statistics.malformed++;
+  return length;
+}
+
+uint8_t TouchGenerator::TouchNotification(uint8_t* buffer)
+{
+  uint8_t expectedTouchLength = descriptorLength + 2;
+  uint8_t timestampBytes = (timestampLength > 0) ? (timestampLength + 2) : 0;
+  uint8_t maxLength = MAX_SHORT_LENGTH - 6;
+  if (maxLength > BUFFER_SIZE - HEADER_LENGTH)
+  {
+    maxLength = BUFFER_SIZE - HEADER_LENGTH;
+  }
+  uint8_t maxTouches = (maxLength > timestampBytes) ? ((maxLength - timestampBytes) / expectedTouchLength) : 0;
+
+  uint8_t length = WriteHeader(buffer, 0xF0);
+  buffer[length++] = 0xA0;
+  length++;  // Length of the touches, filled in below
+
+  uint8_t touchCount = 0;
+  for (uint8_t i = 0; i < ZFORCE_GENERATOR_MAX_FINGERS; i++)
+  {
+    if (!fingerUsed[i])
+    {
+      continue;
+    }
+
+    FingerPath* path = &fingers[i];
+    bool active = false;
+    if (time >= path->start)
+    {
+      uint32_t elapsed = time - path->start;
+      if (path->repeat > 0)
+      {
+        elapsed %= path->repeat;
+      }
+      active = (path->duration == 0) || (elapsed < path->duration);
+    }
+
+    TouchEvent event;
+    if (active)
+    {
+      event = fingerDown[i] ? TouchEvent::MOVE : TouchEvent::DOWN;
+    }
+    else if (fingerDown[i])
+    {
+      event = TouchEvent::UP;
+    }
+    else
+    {
+      continue;
+    }
+    fingerDown[i] = active;
+
+    if (touchCount >= maxTouches)
+    {
+      statistics.droppedTouches++;
+      continue;
+    }
+
+    // Ghost and invalid events replace moves, so DOWN and UP of each id still pair up.
+    if (event == TouchEvent::MOVE)
+    {
+      if (Chance(injection.ghostRate))
+      {
+        event = TouchEvent::GHOST;
+        statistics.ghosts++;
+      }
+      else if (Chance(injection.invalidRate))
+      {
+        event = TouchEvent::INVALID;
+        statistics.invalids++;
+      }
+    }
+
+    uint16_t x, y;
+    FingerPosition(path, time, &x, &y);
+    buffer[length++] = 0x80;
+    buffer[length++] = descriptorLength;
+    length += EncodeTouch(&buffer[length], i, event, x, y, path->size);
+    touchCount++;
+  }
+
+  // The sensor does not send notifications without touches.
+  if (touchCount == 0)
+  {
+    return 0;
+  }
+
+  if (timestampLength > 0)
+  {
+    buffer[length++] = TIMESTAMP_TAG;
+    buffer[length++] = timestampLength;
+    for (int8_t i = timestampLength - 1; i >= 0; i--)
+    {
+      buffer[length++] = (uint8_t)(time >> (8 * i));
+    }
+  }
+
+  buffer[1] = length - 2;
+  buffer[3] = length - 4;
+  buffer[9] = length - HEADER_LENGTH;
+  statistics.touchNotifications++;
+  statistics.touches += touchCount;
+  return length;
+}
+
+/*
+ * Writes one touch in descriptor order. Values spanning several bytes are sent
+ * most significant byte first, using as many bytes as the descriptor has for them.
+ */
+uint8_t TouchGenerator::EncodeTouch(uint8_t* destination, uint8_t id, TouchEvent event, uint16_t x, uint16_t y, uint16_t size)
+{
+  for (uint8_t j = 0; j < descriptorLength; j++)
+  {
+    uint8_t field = (uint8_t)descriptor[j];
+    uint32_t value = 0;
+
+    if (field == (uint8_t)TouchDescriptor::Id)
+    {
+      destination[j] = id;
+      continue;
+    }
+    if (field == (uint8_t)TouchDescriptor::Event)
+    {
+      destination[j] = (uint8_t)event;
+      continue;
+    }
+    if (field >= (uint8_t)TouchDescriptor::Orientation)
+    {
+      destination[j] = (field == (uint8_t)TouchDescriptor::Confidence) ? 100 : 0;
+      continue;
+    }
+
+    // Fields from LocXByte1 to SizeZByte3 come in groups of three bytes.
+    uint8_t groupStart = field - ((field - (uint8_t)TouchDescriptor::LocXByte1) % 3);
+    switch ((TouchDescriptor)groupStart)
+    {
+      case TouchDescriptor::LocXByte1:
+        value = x;
+        break;
+      case TouchDescriptor::LocYByte1:
+        value = y;
+        break;
+      case TouchDescriptor::SizeXByte1:
+      case TouchDescriptor::SizeYByte1:
+        value = size;
+        break;
+      default:
+        break;
+    }
+
+    // Bytes of the group that follow this one hold the less significant parts.
+    uint8_t shift = 0;
+    for (uint8_t k = j + 1; (k < descriptorLength) && ((uint8_t)descriptor[k] < groupStart + 3); k++)
+    {
+      shift += 8;
+    }
+    destination[j] = (uint8_t)(value >> shift);
+  }
+
+  return descriptorLength;
+}
+
+void TouchGenerator::FingerPosition(const FingerPath* path, uint32_t time, uint16_t* x, uint16_t* y)
+{
+  uint16_t phase = 0;
+  if (path->period > 0)
+  {
+    uint32_t elapsed = (time - path->start) % path->period;
+    phase = (uint16_t)(((uint64_t)elapsed << 10) / path->period);
+  }
+
+  switch (path->shape)
+  {
+    case PathShape::LINE:
+    {
+      int32_t position = (phase < 512) ? phase : (1023 - phase);
+      *x = Clamp(path->x0 + (((int32_t)path->x1 - path->x0) * position) / 511);
+      *y = Clamp(path->y0 + (((int32_t)path->y1 - path->y0) * position) / 511);
+      break;
+    }
+    case PathShape::ELLIPSE:
+      *x = Clamp(path->x0 + (((int32_t)path->x1 * Sine(phase + 256)) >> 15));
+      *y = Clamp(path->y0 + (((int32_t)path->y1 * Sine(phase)) >> 15));
+      break;
+    case PathShape::LISSAJOUS:
+      *x = Clamp(path->x0 + (((int32_t)path->x1 * Sine(phase)) >> 15));
+      *y = Clamp(path->y0 + (((int32_t)path->y1 * Sine(phase * 2)) >> 15));
+      break;
+    default:
+      *x = path->x0;
+      *y = path->y0;
+      break;
+  }
+}
+
+bool TouchGenerator::Chance(uint16_t rate)
+{
+  return (rate > 0) && ((Random() & 0xFFFF) < rate);
+}
+
+// xorshift32
+uint32_t TouchGenerator::Random()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
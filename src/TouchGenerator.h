@@ -0,0 +1,121 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * Synthesizes the messages a sensor would send, for exercising the parser and the
+ * code consuming touches without a sensor, or under more load than a real one gives.
+ *
+ * Messages are written to a buffer exactly as Read() returns them, i2c header
+ * included. Touch notifications follow the touch descriptor given to
+ * SetTouchFormat(), and TouchFormatResponse() produces the matching response so a
+ * parser can be set up for that descriptor. Fingers follow parametric paths and
+ * GHOST and INVALID events, boot complete notifications and malformed messages
+ * can be mixed in at configurable rates.
+ */
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+#define ZFORCE_GENERATOR_MAX_FINGERS ZFORCE_MAX_TOUCHES
+
+enum class PathShape : uint8_t
+{
+	STILL,    // stays at (x0, y0)
+	LINE,     // moves from (x0, y0) to (x1, y1) and back
+	ELLIPSE,  // circles around (x0, y0) with radii x1 and y1
+	LISSAJOUS // like ELLIPSE, but y moves twice as fast as x
+};
+
+typedef struct FingerPath
+{
+	PathShape shape;
+	uint16_t x0;
+	uint16_t y0;
+	uint16_t x1;
+	uint16_t y1;
+	uint16_t size;
+	uint32_t period;    // time for one lap of the path, in microseconds
+	uint32_t start;     // time of the DOWN event, in microseconds
+	uint32_t duration;  // time until the UP event, 0 for never
+	uint32_t repeat;    // time between consecutive DOWN events, 0 for once
+} FingerPath;
+
+// Rates are given as occurrences per 65536 messages or touches.
+typedef struct GeneratorInjection
+{
+	uint16_t ghostRate;
+	uint16_t invalidRate;
+	uint16_t bootCompleteRate;
+	uint16_t malformedRate;
+} GeneratorInjection;
+
+typedef struct GeneratorStatistics
+{
+	uint32_t touchNotifications;
+	uint32_t touches;
+	uint32_t ghosts;
+	uint32_t invalids;
+	uint32_t bootCompletes;
+	uint32_t malformed;
+	uint32_t droppedTouches;  // touches that did not fit in a notification
+} GeneratorStatistics;
+
+class TouchGenerator
+{
+	public:
+		TouchGenerator();
+		// Returns false if the descriptor is empty, too long or lacks Id or Event.
+		bool SetTouchFormat(const TouchDescriptor* descriptor, uint8_t count);
+		// Number of timestamp bytes in touch notifications, 0 to 4.
+		void SetTimestampLength(uint8_t length);
+		void SetFrameRate(uint32_t framesPerSecond);
+		void SetFinger(uint8_t index, const FingerPath* path);
+		void ClearFingers();
+		void SetInjection(const GeneratorInjection* injection, uint32_t seed);
+		// Each of these write one complete message to buffer, which must hold
+		// BUFFER_SIZE bytes, and return its length.
+		uint8_t TouchFormatResponse(uint8_t* buffer);
+		uint8_t BootComplete(uint8_t* buffer);
+		// Advances the time by one frame and writes the next message. Returns 0 when
+		// no finger is down or lifted in this frame, as the sensor then sends nothing,
+		// and buffer does not hold a valid message.
+		uint8_t NextMessage(uint8_t* buffer);
+		uint32_t GetTime();
+		GeneratorStatistics GetStatistics();
+	private:
+		uint8_t TouchNotification(uint8_t* buffer);
+		uint8_t Malformed(uint8_t* buffer);
+		uint8_t WriteHeader(uint8_t* buffer, uint8_t type);
+		uint8_t EncodeTouch(uint8_t* destination, uint8_t id, TouchEvent event, uint16_t x, uint16_t y, uint16_t size);
+		void FingerPosition(const FingerPath* path, uint32_t time, uint16_t* x, uint16_t* y);
+		bool Chance(uint16_t rate);
+		uint32_t Random();
+		TouchDescriptor descriptor[(int)TouchDescriptor::MaxValue];
+		uint8_t descriptorLength;
+		uint8_t timestampLength;
+		uint32_t framePeriod;
+		uint32_t time;
+		FingerPath fingers[ZFORCE_GENERATOR_MAX_FINGERS];
+		bool fingerUsed[ZFORCE_GENERATOR_MAX_FINGERS];
+		bool fingerDown[ZFORCE_GENERATOR_MAX_FINGERS];
+		GeneratorInjection injection;
+		uint32_t randomState;
+		GeneratorStatistics statistics;
+};
@@ -0,0 +1,129 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchHeatmap.h"
+
+#if ZFORCE_HEATMAP_MAX_IDS > 32
+#error "ZFORCE_HEATMAP_MAX_IDS can be at most 32"
+#endif
+
+TouchHeatmap::TouchHeatmap()
+{
+  SetArea(0, 0, 0xFFFF, 0xFFFF);
+  Reset();
+}
+
+void TouchHeatmap::SetArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY)
+{
+  this->minX = minX;
+  this->minY = minY;
+  width = (maxX > minX) ? ((uint32_t)maxX - minX + 1) : 1;
+  height = (maxY > minY) ? ((uint32_t)maxY - minY + 1) : 1;
+}
+
+void TouchHeatmap::SetArea(TouchActiveAreaMessage* area)
+{
+  SetArea(area->minX, area->minY, area->maxX, area->maxY);
+}
+
+void TouchHeatmap::Reset()
+{
+  memset(&statistics, 0, sizeof(statistics));
+  activeIds = 0;
+}
+
+void TouchHeatmap::GetSnapshot(HeatmapSnapshot* snapshot, bool reset)
+{
+  memcpy(snapshot, &statistics, sizeof(HeatmapSnapshot));
+  if (reset)
+  {
+    // Touches that are down keep their DOWN time, so their dwell ends up in the next snapshot.
+    memset(&statistics, 0, sizeof(statistics));
+  }
+}
+
+void TouchHeatmap::Update(TouchMessage* msg, uint32_t time)
+{
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    TouchData* touch = &msg->touchData[i];
+    UpdateTouch(touch->x, touch->y, touch->id, touch->event, time);
+  }
+}
+
+void TouchHeatmap::Update(const TouchFrame* frame, uint32_t time)
+{
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    UpdateTouch(frame->x[i], frame->y[i], frame->id[i], frame->event[i], time);
+  }
+}
+
+void TouchHeatmap::UpdateTouch(TouchCoordinate x, TouchCoordinate y, uint8_t id, TouchEvent event, uint32_t time)
+{
+  uint32_t idMask = (id < ZFORCE_HEATMAP_MAX_IDS) ? ((uint32_t)1 << id) : 0;
+
+  switch (event)
+  {
+    case TouchEvent::DOWN:
+      statistics.downCount++;
+      if (idMask)
+      {
+        downTime[id] = time;
+        activeIds |= idMask;
+      }
+      break;
+
+    case TouchEvent::UP:
+      statistics.upCount++;
+      if (activeIds & idMask)
+      {
+        uint32_t dwell = time - downTime[id];
+        activeIds &= ~idMask;
+        statistics.dwellCount++;
+        statistics.dwellTotal = (statistics.dwellTotal + dwell < statistics.dwellTotal) ? 0xFFFFFFFF : statistics.dwellTotal + dwell;
+        if (dwell > statistics.dwellMax)
+        {
+          statistics.dwellMax = dwell;
+        }
+      }
+      return;
+
+    case TouchEvent::MOVE:
+      break;
+
+    default:  // INVALID and GHOST touches are not real touches.
+      return;
+  }
+
+  // Touches outside the area are counted in the nearest cell.
+  uint32_t offsetX = (x > minX) ? ((uint32_t)x - minX) : 0;
+  uint32_t offsetY = (y > minY) ? ((uint32_t)y - minY) : 0;
+  uint8_t column = (offsetX < width) ? (offsetX * ZFORCE_HEATMAP_COLUMNS / width) : (ZFORCE_HEATMAP_COLUMNS - 1);
+  uint8_t row = (offsetY < height) ? (offsetY * ZFORCE_HEATMAP_ROWS / height) : (ZFORCE_HEATMAP_ROWS - 1);
+
+  uint16_t* cell = &statistics.cells[row][column];
+  if (*cell != 0xFFFF)
+  {
+    (*cell)++;
+  }
+}
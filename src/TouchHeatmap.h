@@ -0,0 +1,73 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Size of the grid the touch active area is divided into. Each cell takes 2 bytes.
+#ifndef ZFORCE_HEATMAP_COLUMNS
+#define ZFORCE_HEATMAP_COLUMNS 8
+#endif
+#ifndef ZFORCE_HEATMAP_ROWS
+#define ZFORCE_HEATMAP_ROWS 8
+#endif
+// Touch ids whose dwell time is tracked, higher ids only count towards the grid and events.
+#ifndef ZFORCE_HEATMAP_MAX_IDS
+#define ZFORCE_HEATMAP_MAX_IDS 16
+#endif
+
+typedef struct HeatmapSnapshot
+{
+	uint16_t cells[ZFORCE_HEATMAP_ROWS][ZFORCE_HEATMAP_COLUMNS];  // touch samples per cell, saturating at 0xFFFF
+	uint32_t downCount;
+	uint32_t upCount;
+	uint32_t dwellCount;  // touches with a completed dwell time
+	uint32_t dwellTotal;  // sum of the time between DOWN and UP
+	uint32_t dwellMax;
+} HeatmapSnapshot;
+
+/*
+ * Aggregates where and for how long the sensor is touched, using a fixed amount
+ * of memory. Every DOWN and MOVE touch adds one to the grid cell it is in, and
+ * the time from DOWN to UP of each touch id is accumulated. Times are in the unit
+ * passed to Update(), e.g. millis() or the timestamp of the touch notification.
+ */
+class TouchHeatmap
+{
+	public:
+		TouchHeatmap();
+		// Sets the area covered by the grid, normally the touch active area of the sensor.
+		void SetArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY);
+		void SetArea(TouchActiveAreaMessage* area);
+		void Update(TouchMessage* msg, uint32_t time);
+		void Update(const TouchFrame* frame, uint32_t time);
+		// Copies the collected statistics to snapshot, and clears them if reset is true.
+		void GetSnapshot(HeatmapSnapshot* snapshot, bool reset);
+		void Reset();
+	private:
+		void UpdateTouch(TouchCoordinate x, TouchCoordinate y, uint8_t id, TouchEvent event, uint32_t time);
+		uint16_t minX;
+		uint16_t minY;
+		uint32_t width;
+		uint32_t height;
+		uint32_t downTime[ZFORCE_HEATMAP_MAX_IDS];
+		uint32_t activeIds;
+		HeatmapSnapshot statistics;
+};
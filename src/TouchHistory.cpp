@@ -0,0 +1,236 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include "TouchHistory.h"
+
+#if (ZFORCE_HISTORY_DEPTH < 2) || (ZFORCE_HISTORY_DEPTH & (ZFORCE_HISTORY_DEPTH - 1))
+#error "ZFORCE_HISTORY_DEPTH must be a power of two of at least 2"
+#endif
+
+#define HISTORY_INDEX(index) ((index) & (ZFORCE_HISTORY_DEPTH - 1))
+// Velocity differences are clamped so that the acceleration fits in 32 bits.
+#define MAX_VELOCITY_CHANGE 2000000L
+
+// Changes up to this size can be scaled to per second in 32 bits.
+#define MAX_SMALL_CHANGE (INT32_MAX / ZFORCE_HISTORY_TIME_SCALE)
+
+// Difference of two coordinates, which needs 64 bits for 32 bit coordinates.
+#if ZFORCE_PACKED_TOUCH_DATA
+typedef int32_t CoordinateChange;
+#else
+typedef int64_t CoordinateChange;
+#endif
+
+static CoordinateChange Change(TouchCoordinate from, TouchCoordinate to)
+{
+  return (CoordinateChange)to - (CoordinateChange)from;
+}
+
+// Change per second between two samples, clamped to the range of int32_t.
+static int32_t Rate(CoordinateChange change, uint32_t duration)
+{
+  if ((change <= MAX_SMALL_CHANGE) && (change >= -MAX_SMALL_CHANGE) && (duration <= INT32_MAX))
+  {
+    return ((int32_t)change * (int32_t)ZFORCE_HISTORY_TIME_SCALE) / (int32_t)duration;
+  }
+
+  // Only large changes, e.g. of 32 bit coordinates or with microsecond times, pay for 64 bit division.
+  int64_t rate = ((int64_t)change * ZFORCE_HISTORY_TIME_SCALE) / (int64_t)duration;
+  return (rate > INT32_MAX) ? INT32_MAX : ((rate < INT32_MIN) ? INT32_MIN : (int32_t)rate);
+}
+
+// Difference of two velocities, which may already be clamped to the range of int32_t.
+static int32_t VelocityChange(int32_t older, int32_t recent)
+{
+  int64_t change = (int64_t)recent - older;
+  return (change > MAX_VELOCITY_CHANGE) ? MAX_VELOCITY_CHANGE : ((change < -MAX_VELOCITY_CHANGE) ? -MAX_VELOCITY_CHANGE : (int32_t)change);
+}
+
+TouchHistory::TouchHistory()
+{
+  Reset();
+}
+
+void TouchHistory::Reset()
+{
+  memset(slots, 0, sizeof(slots));
+  memset(slotUsed, 0, sizeof(slotUsed));
+}
+
+void TouchHistory::Update(TouchMessage* msg, uint32_t time)
+{
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    TouchData* touch = &msg->touchData[i];
+    UpdateTouch(touch->id, touch->event, touch->x, touch->y, time);
+  }
+}
+
+void TouchHistory::Update(const TouchFrame* frame, uint32_t time)
+{
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    UpdateTouch(frame->id[i], frame->event[i], frame->x[i], frame->y[i], time);
+  }
+}
+
+bool TouchHistory::GetMotion(uint8_t id, TouchMotion* motion)
+{
+  TouchHistorySlot* slot = FindSlot(id);
+  if (slot == nullptr)
+  {
+    return false;
+  }
+
+  *motion = slot->motion;
+  return true;
+}
+
+TouchHistorySlot* TouchHistory::FindSlot(uint8_t id)
+{
+  for (uint8_t i = 0; i < ZFORCE_HISTORY_SLOTS; i++)
+  {
+    if (slotUsed[i] && (slots[i].motion.id == id))
+    {
+      return &slots[i];
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Takes a free slot for id, preferring one that has never been used, then the one
+ * released longest ago. Returns nullptr if all slots hold active touches.
+ */
+TouchHistorySlot* TouchHistory::TakeSlot(uint8_t id)
+{
+  TouchHistorySlot* slot = nullptr;
+  for (uint8_t i = 0; i < ZFORCE_HISTORY_SLOTS; i++)
+  {
+    if (!slotUsed[i])
+    {
+      slotUsed[i] = true;
+      slot = &slots[i];
+      break;
+    }
+    if (!slots[i].active && ((slot == nullptr) || ((int32_t)(slots[i].motion.time - slot->motion.time) < 0)))
+    {
+      slot = &slots[i];
+    }
+  }
+
+  if (slot != nullptr)
+  {
+    memset(slot, 0, sizeof(TouchHistorySlot));
+    slot->active = true;
+    slot->motion.id = id;
+  }
+  return slot;
+}
+
+void TouchHistory::UpdateTouch(uint8_t id, TouchEvent event, TouchCoordinate x, TouchCoordinate y, uint32_t time)
+{
+  if ((event != TouchEvent::DOWN) && (event != TouchEvent::MOVE) && (event != TouchEvent::UP))
+  {
+    return;
+  }
+
+  TouchHistorySlot* slot = FindSlot(id);
+  if ((slot != nullptr) && !slot->active)
+  {
+    // A released touch whose id is used again is a new touch.
+    slot = nullptr;
+  }
+  if ((slot == nullptr) || (event == TouchEvent::DOWN))
+  {
+    if (event == TouchEvent::UP)
+    {
+      return;
+    }
+    if (slot == nullptr)
+    {
+      slot = TakeSlot(id);
+      if (slot == nullptr)
+      {
+        return;
+      }
+    }
+    else
+    {
+      memset(slot, 0, sizeof(TouchHistorySlot));
+      slot->active = true;
+      slot->motion.id = id;
+    }
+  }
+
+  uint8_t newest = HISTORY_INDEX(slot->head);
+  slot->x[newest] = x;
+  slot->y[newest] = y;
+  slot->time[newest] = time;
+  slot->head++;
+  if (slot->motion.samples < ZFORCE_HISTORY_DEPTH)
+  {
+    slot->motion.samples++;
+  }
+
+  TouchMotion* motion = &slot->motion;
+  motion->event = event;
+  motion->x = x;
+  motion->y = y;
+  motion->time = time;
+  slot->active = (event != TouchEvent::UP);
+
+  // Velocity over the whole history, and acceleration from the velocities over its two halves.
+  // Samples with the same time, e.g. several messages read within one millisecond, give no
+  // rate, so the velocity and acceleration of the previous sample are carried forward.
+  uint8_t samples = motion->samples;
+  if (samples >= 2)
+  {
+    uint8_t oldest = HISTORY_INDEX(slot->head - samples);
+    uint32_t duration = time - slot->time[oldest];
+    if (duration == 0)
+    {
+      return;
+    }
+    motion->velocityX = Rate(Change(slot->x[oldest], x), duration);
+    motion->velocityY = Rate(Change(slot->y[oldest], y), duration);
+
+    if (samples >= 3)
+    {
+      uint8_t middle = HISTORY_INDEX(slot->head - 1 - (samples - 1) / 2);
+      uint32_t recent = time - slot->time[middle];
+      uint32_t older = slot->time[middle] - slot->time[oldest];
+      if ((recent > 0) && (older > 0))
+      {
+        int32_t changeX = VelocityChange(Rate(Change(slot->x[oldest], slot->x[middle]), older),
+                                         Rate(Change(slot->x[middle], x), recent));
+        int32_t changeY = VelocityChange(Rate(Change(slot->y[oldest], slot->y[middle]), older),
+                                         Rate(Change(slot->y[middle], y), recent));
+        // The two velocities are measured at the midpoints of their halves.
+        uint32_t between = (recent + older) / 2;
+        motion->accelerationX = (between > 0) ? Rate(changeX, between) : 0;
+        motion->accelerationY = (between > 0) ? Rate(changeY, between) : 0;
+      }
+    }
+  }
+}
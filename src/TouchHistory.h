@@ -0,0 +1,89 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Number of touches tracked at the same time.
+#ifndef ZFORCE_HISTORY_SLOTS
+#define ZFORCE_HISTORY_SLOTS ZFORCE_MAX_TOUCHES
+#endif
+// Samples kept per touch, must be a power of two of at least 2. Velocity is
+// averaged over this many samples, so more samples give smoother but later values.
+#ifndef ZFORCE_HISTORY_DEPTH
+#define ZFORCE_HISTORY_DEPTH 4
+#endif
+// Time units per second of the times passed to Update(), 1000 for millis() and
+// 1000000 for micros().
+#ifndef ZFORCE_HISTORY_TIME_SCALE
+#define ZFORCE_HISTORY_TIME_SCALE 1000L
+#endif
+
+typedef struct TouchMotion
+{
+	uint8_t id;
+	TouchEvent event;       // latest event, UP once the touch has been lifted
+	TouchCoordinate x;      // latest position
+	TouchCoordinate y;
+	uint32_t time;          // time of the latest sample
+	int32_t velocityX;      // coordinate units per second
+	int32_t velocityY;
+	int32_t accelerationX;  // coordinate units per second squared
+	int32_t accelerationY;
+	uint8_t samples;        // samples the values are based on, at most ZFORCE_HISTORY_DEPTH
+} TouchMotion;
+
+typedef struct TouchHistorySlot
+{
+	bool active;
+	uint8_t head;
+	TouchCoordinate x[ZFORCE_HISTORY_DEPTH];
+	TouchCoordinate y[ZFORCE_HISTORY_DEPTH];
+	uint32_t time[ZFORCE_HISTORY_DEPTH];
+	TouchMotion motion;
+} TouchHistorySlot;
+
+/*
+ * Keeps the latest positions of each touch id and derives velocity and
+ * acceleration from them, with a constant amount of work per touch. Times are
+ * in milliseconds, e.g. millis() when the touch message was received, or in the
+ * unit set with ZFORCE_HISTORY_TIME_SCALE. Samples with the same time keep the
+ * velocity and acceleration of the previous sample.
+ *
+ * A slot is taken when a touch goes DOWN and released when it goes UP. The motion
+ * of a released touch stays available until its slot is taken by a new touch,
+ * e.g. to start a fling with the velocity at the moment the finger was lifted.
+ */
+class TouchHistory
+{
+	public:
+		TouchHistory();
+		void Update(TouchMessage* msg, uint32_t time);
+		void Update(const TouchFrame* frame, uint32_t time);
+		// Returns false if the id has not been seen or its slot has been reused.
+		bool GetMotion(uint8_t id, TouchMotion* motion);
+		void Reset();
+	private:
+		void UpdateTouch(uint8_t id, TouchEvent event, TouchCoordinate x, TouchCoordinate y, uint32_t time);
+		TouchHistorySlot* FindSlot(uint8_t id);
+		TouchHistorySlot* TakeSlot(uint8_t id);
+		TouchHistorySlot slots[ZFORCE_HISTORY_SLOTS];
+		bool slotUsed[ZFORCE_HISTORY_SLOTS];
+};
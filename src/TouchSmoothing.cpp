@@ -0,0 +1,164 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchSmoothing.h"
+
+#define FRACTION_BITS 4
+#define ALPHA_ONE 32767
+// Largest value of the 16 bit arithmetic, for positions and speeds in 1/16 units.
+#define MAX_VALUE 32767
+// Cutoff relative to the frame rate at which the smoothing factor is 0.9, the
+// fastest touches still lag by a ninth of their change per frame. Spreading the
+// table further would leave all real finger speeds to its first entries.
+#define MAX_CUTOFF_RATIO (9.0f / (2.0f * 3.14159265f))
+
+// Smoothing factor of an exponential filter with the given cutoff, in Q15.
+static int16_t Alpha(float cutoff, float frameRate)
+{
+  float w = 2.0f * 3.14159265f * cutoff / frameRate;
+  float alpha = w / (1.0f + w);
+  return (alpha >= 1.0f) ? ALPHA_ONE : (int16_t)(alpha * ALPHA_ONE + 0.5f);
+}
+
+static int16_t Saturate(int32_t value)
+{
+  return (value > MAX_VALUE) ? MAX_VALUE : ((value < -MAX_VALUE) ? -MAX_VALUE : (int16_t)value);
+}
+
+// value + alpha * (target - value), with a 16 x 16 bit multiplication.
+static int16_t Blend(int16_t value, int16_t target, int16_t alpha)
+{
+  int16_t difference = Saturate((int32_t)target - value);
+  return Saturate(value + (((int32_t)difference * alpha + (1L << 14)) >> 15));
+}
+
+TouchSmoothing::TouchSmoothing()
+{
+  SetParameters(1.0f, 0.01f, 1.0f, 100);
+  Reset();
+}
+
+/*
+ * Fills the table of smoothing factors by speed. The table is spread so that its
+ * last entry is where the smoothing factor reaches 0.9, and AlphaForSpeed()
+ * interpolates between entries.
+ */
+void TouchSmoothing::SetParameters(float minCutoff, float beta, float derivativeCutoff, uint16_t frameRate)
+{
+  float rate = (frameRate > 0) ? frameRate : 1;
+  alphaDerivative = Alpha(derivativeCutoff, rate);
+
+  speedShift = 0;
+  if (beta > 0.0f)
+  {
+    // Change per frame in 1/16 units at which the cutoff reaches its useful maximum.
+    float maxSpeed = ((MAX_CUTOFF_RATIO * rate - minCutoff) / beta) / rate * (1 << FRACTION_BITS);
+    while ((speedShift < 15) && ((float)((uint32_t)(ZFORCE_SMOOTHING_TABLE_SIZE - 1) << speedShift) < maxSpeed))
+    {
+      speedShift++;
+    }
+  }
+
+  for (uint8_t i = 0; i < ZFORCE_SMOOTHING_TABLE_SIZE; i++)
+  {
+    float speed = (float)((uint32_t)i << speedShift) / (1 << FRACTION_BITS) * rate;
+    alphaTable[i] = Alpha(minCutoff + beta * speed, rate);
+  }
+}
+
+void TouchSmoothing::Reset()
+{
+  memset(states, 0, sizeof(states));
+}
+
+void TouchSmoothing::Smooth(TouchMessage* msg)
+{
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    TouchData* touch = &msg->touchData[i];
+    SmoothTouch(touch->id, touch->event, &touch->x, &touch->y);
+  }
+}
+
+void TouchSmoothing::Smooth(TouchFrame* frame)
+{
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    SmoothTouch(frame->id[i], frame->event[i], &frame->x[i], &frame->y[i]);
+  }
+}
+
+/*
+ * Smoothing factor for a change per frame in 1/16 units, interpolated linearly
+ * between the table entries, so that the factor follows the speed without steps.
+ */
+int16_t TouchSmoothing::AlphaForSpeed(int16_t speed)
+{
+  uint16_t magnitude = (speed < 0) ? -speed : speed;
+  uint16_t index = magnitude >> speedShift;
+  if (index >= (ZFORCE_SMOOTHING_TABLE_SIZE - 1))
+  {
+    return alphaTable[ZFORCE_SMOOTHING_TABLE_SIZE - 1];
+  }
+  int32_t fraction = magnitude & ((1U << speedShift) - 1);
+  int32_t step = (int32_t)alphaTable[index + 1] - alphaTable[index];
+  return alphaTable[index] + (int16_t)((step * fraction) >> speedShift);
+}
+
+void TouchSmoothing::SmoothTouch(uint8_t id, TouchEvent event, TouchCoordinate* x, TouchCoordinate* y)
+{
+  if ((id >= ZFORCE_SMOOTHING_MAX_IDS) || ((event != TouchEvent::DOWN) && (event != TouchEvent::MOVE) && (event != TouchEvent::UP)))
+  {
+    return;
+  }
+
+  SmoothingState* state = &states[id];
+  int32_t rawX = (int32_t)*x << FRACTION_BITS;
+  int32_t rawY = (int32_t)*y << FRACTION_BITS;
+  int32_t changeX = rawX - state->x;
+  int32_t changeY = rawY - state->y;
+
+  // A new touch, or one that jumped too far for the 16 bit arithmetic, starts over.
+  if ((event == TouchEvent::DOWN) || !state->active ||
+      (changeX > MAX_VALUE) || (changeX < -MAX_VALUE) || (changeY > MAX_VALUE) || (changeY < -MAX_VALUE))
+  {
+    state->active = (event != TouchEvent::UP);
+    state->x = rawX;
+    state->y = rawY;
+    state->speedX = 0;
+    state->speedY = 0;
+    return;
+  }
+
+  state->speedX = Blend(state->speedX, (int16_t)changeX, alphaDerivative);
+  state->speedY = Blend(state->speedY, (int16_t)changeY, alphaDerivative);
+
+  int16_t alphaX = AlphaForSpeed(state->speedX);
+  int16_t alphaY = AlphaForSpeed(state->speedY);
+
+  state->x += ((int32_t)(int16_t)changeX * alphaX + (1L << 14)) >> 15;
+  state->y += ((int32_t)(int16_t)changeY * alphaY + (1L << 14)) >> 15;
+  state->active = (event != TouchEvent::UP);
+
+  *x = (TouchCoordinate)((state->x + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+  *y = (TouchCoordinate)((state->y + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+}
@@ -0,0 +1,77 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Touch ids that are smoothed, touches with higher ids are left unchanged.
+#ifndef ZFORCE_SMOOTHING_MAX_IDS
+#define ZFORCE_SMOOTHING_MAX_IDS 16
+#endif
+// Number of speeds the filter strength is precomputed for, it is interpolated between them.
+#ifndef ZFORCE_SMOOTHING_TABLE_SIZE
+#define ZFORCE_SMOOTHING_TABLE_SIZE 16
+#endif
+
+typedef struct SmoothingState
+{
+	bool active;
+	int32_t x;          // filtered position in 1/16 units
+	int32_t y;
+	int16_t speedX;     // filtered change per frame in 1/16 units
+	int16_t speedY;
+} SmoothingState;
+
+/*
+ * One Euro filter (Casiez, Roussel and Vogel, CHI 2012) for the positions of each
+ * touch id. A low-pass filter removes the jitter of a still finger, and its
+ * cutoff frequency rises with the speed of the finger, so that moving touches
+ * follow with little lag:
+ *
+ *   cutoff = minCutoff + beta * speed
+ *
+ * where speed is in coordinate units per second, itself low-pass filtered at
+ * derivativeCutoff. Lower minCutoff removes more jitter, higher beta reduces lag.
+ *
+ * The filter assumes one touch notification per frame at frameRate, normally the
+ * finger frequency of the sensor. SetParameters() precomputes the filter strength
+ * for a range of speeds, up to where the smoothing factor reaches 0.9, and it is
+ * interpolated between them, so that smoothing a touch takes no divisions or
+ * floating point arithmetic. Faster touches are smoothed with a factor of 0.9. The state of a touch is reset when it goes DOWN, and a jump of
+ * more than 2047 units within a frame is passed through unfiltered.
+ */
+class TouchSmoothing
+{
+	public:
+		TouchSmoothing();
+		// Cutoff frequencies are in Hz, beta in Hz per coordinate unit per second.
+		void SetParameters(float minCutoff, float beta, float derivativeCutoff, uint16_t frameRate);
+		// Replaces the positions of the touches with the smoothed positions.
+		void Smooth(TouchMessage* msg);
+		void Smooth(TouchFrame* frame);
+		void Reset();
+	private:
+		int16_t AlphaForSpeed(int16_t speed);
+		void SmoothTouch(uint8_t id, TouchEvent event, TouchCoordinate* x, TouchCoordinate* y);
+		int16_t alphaDerivative;                           // Q15
+		uint8_t speedShift;                                // table index = speed >> speedShift
+		int16_t alphaTable[ZFORCE_SMOOTHING_TABLE_SIZE];   // Q15, by speed
+		SmoothingState states[ZFORCE_SMOOTHING_MAX_IDS];
+};
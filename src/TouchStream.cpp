@@ -0,0 +1,321 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchStream.h"
+
+enum DecoderState : uint8_t
+{
+  WAITSYNC1,
+  WAITSYNC2,
+  WAITLENGTH,
+  PAYLOAD,
+  CRCHIGH,
+  CRCLOW
+};
+
+uint16_t TouchStreamCrc(uint16_t crc, uint8_t data)
+{
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+  }
+  return crc;
+}
+
+static uint8_t WriteVarint(uint8_t* buffer, uint32_t value)
+{
+  uint8_t length = 0;
+  while (value >= 0x80)
+  {
+    buffer[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[length++] = (uint8_t)value;
+  return length;
+}
+
+// Returns false if the varint runs past end.
+static bool ReadVarint(const uint8_t* buffer, uint8_t end, uint8_t* position, uint32_t* value)
+{
+  *value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7)
+  {
+    if (*position >= end)
+    {
+      return false;
+    }
+    uint8_t data = buffer[(*position)++];
+    *value |= (uint32_t)(data & 0x7F) << shift;
+    if (!(data & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Signed deltas are zigzag encoded, so small negative values stay short.
+static uint8_t WriteDelta(uint8_t* buffer, uint32_t value, uint32_t previous)
+{
+  int32_t delta = (int32_t)(value - previous);
+  return WriteVarint(buffer, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+}
+
+static bool ReadDelta(const uint8_t* buffer, uint8_t end, uint8_t* position, uint32_t previous, uint32_t* value)
+{
+  uint32_t zigzag;
+  if (!ReadVarint(buffer, end, position, &zigzag))
+  {
+    return false;
+  }
+  *value = previous + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+  return true;
+}
+
+TouchStreamEncoder::TouchStreamEncoder()
+{
+  sequence = 0;
+  Reset();
+}
+
+void TouchStreamEncoder::Reset()
+{
+  framesSinceKeyFrame = ZFORCE_STREAM_KEY_FRAME_INTERVAL;
+}
+
+uint8_t TouchStreamEncoder::Encode(const TouchFrame* frame, uint8_t* buffer)
+{
+  bool keyFrame = (framesSinceKeyFrame >= ZFORCE_STREAM_KEY_FRAME_INTERVAL);
+  uint8_t touchCount = (frame->touchCount > ZFORCE_MAX_TOUCHES) ? ZFORCE_MAX_TOUCHES : frame->touchCount;
+  uint8_t length = 5;
+
+  if (keyFrame)
+  {
+    memset(previousX, 0, sizeof(previousX));
+    memset(previousY, 0, sizeof(previousY));
+    memset(previousSizeX, 0, sizeof(previousSizeX));
+    previousTimestamp = 0;
+    framesSinceKeyFrame = 0;
+  }
+  framesSinceKeyFrame++;
+
+  buffer[0] = ZFORCE_STREAM_SYNC1;
+  buffer[1] = ZFORCE_STREAM_SYNC2;
+  buffer[3] = sequence++;
+  buffer[4] = keyFrame ? ZFORCE_STREAM_KEY_FRAME : 0;
+  length += WriteVarint(&buffer[length], frame->timestamp - previousTimestamp);
+  previousTimestamp = frame->timestamp;
+  buffer[length++] = touchCount;
+
+  for (uint8_t i = 0; i < touchCount; i++)
+  {
+    uint8_t id = frame->id[i];
+    buffer[length++] = id;
+    buffer[length++] = frame->event[i];
+    if (id < ZFORCE_STREAM_MAX_IDS)
+    {
+      length += WriteDelta(&buffer[length], frame->x[i], previousX[id]);
+      length += WriteDelta(&buffer[length], frame->y[i], previousY[id]);
+      length += WriteDelta(&buffer[length], frame->sizeX[i], previousSizeX[id]);
+      previousX[id] = frame->x[i];
+      previousY[id] = frame->y[i];
+      previousSizeX[id] = frame->sizeX[i];
+    }
+    else
+    {
+      length += WriteDelta(&buffer[length], frame->x[i], 0);
+      length += WriteDelta(&buffer[length], frame->y[i], 0);
+      length += WriteDelta(&buffer[length], frame->sizeX[i], 0);
+    }
+  }
+
+  buffer[2] = length - 3;
+
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 2; i < length; i++)
+  {
+    crc = TouchStreamCrc(crc, buffer[i]);
+  }
+  buffer[length++] = (uint8_t)(crc >> 8);
+  buffer[length++] = (uint8_t)crc;
+
+  return length;
+}
+
+TouchStreamDecoder::TouchStreamDecoder()
+{
+  memset(&statistics, 0, sizeof(statistics));
+  Reset();
+}
+
+void TouchStreamDecoder::Reset()
+{
+  state = WAITSYNC1;
+  synchronized = false;
+}
+
+TouchStreamStatistics TouchStreamDecoder::GetStatistics()
+{
+  return statistics;
+}
+
+bool TouchStreamDecoder::Feed(uint8_t data, TouchFrame* frame)
+{
+  switch (state)
+  {
+    case WAITSYNC1:
+      if (data == ZFORCE_STREAM_SYNC1)
+      {
+        state = WAITSYNC2;
+      }
+      break;
+
+    case WAITSYNC2:
+      state = (data == ZFORCE_STREAM_SYNC2) ? WAITLENGTH : ((data == ZFORCE_STREAM_SYNC1) ? WAITSYNC2 : WAITSYNC1);
+      break;
+
+    case WAITLENGTH:
+      // Anything shorter than an empty frame or longer than the largest one is a false sync.
+      if ((data < 4) || (data > ZFORCE_STREAM_MAX_FRAME - 5))
+      {
+        state = (data == ZFORCE_STREAM_SYNC1) ? WAITSYNC2 : WAITSYNC1;
+        break;
+      }
+      length = data;
+      position = 0;
+      crc = TouchStreamCrc(0xFFFF, data);
+      state = PAYLOAD;
+      break;
+
+    case PAYLOAD:
+      payload[position++] = data;
+      crc = TouchStreamCrc(crc, data);
+      if (position == length)
+      {
+        state = CRCHIGH;
+      }
+      break;
+
+    case CRCHIGH:
+      receivedCrc = (uint16_t)data << 8;
+      state = CRCLOW;
+      break;
+
+    case CRCLOW:
+      receivedCrc |= data;
+      state = WAITSYNC1;
+      if (receivedCrc != crc)
+      {
+        statistics.crcErrors++;
+        break;
+      }
+      return DecodePayload(frame);
+  }
+
+  return false;
+}
+
+bool TouchStreamDecoder::DecodePayload(TouchFrame* frame)
+{
+  uint8_t sequence = payload[0];
+  bool keyFrame = payload[1] & ZFORCE_STREAM_KEY_FRAME;
+
+  if (synchronized && (sequence != expectedSequence))
+  {
+    statistics.lostFrames += (uint8_t)(sequence - expectedSequence);
+    synchronized = false;
+  }
+  expectedSequence = sequence + 1;
+
+  // Deltas are meaningless once a frame has been lost, so wait for the next key frame.
+  if (!synchronized && !keyFrame)
+  {
+    statistics.skippedFrames++;
+    return false;
+  }
+
+  if (keyFrame)
+  {
+    memset(previousX, 0, sizeof(previousX));
+    memset(previousY, 0, sizeof(previousY));
+    memset(previousSizeX, 0, sizeof(previousSizeX));
+    previousTimestamp = 0;
+  }
+
+  uint8_t index = 2;
+  uint32_t timestampDelta;
+  if (!ReadVarint(payload, length, &index, &timestampDelta) || (index >= length))
+  {
+    statistics.crcErrors++;
+    synchronized = false;
+    return false;
+  }
+  frame->timestamp = previousTimestamp + timestampDelta;
+  previousTimestamp = frame->timestamp;
+  frame->touchCount = payload[index++];
+
+  if (frame->touchCount > ZFORCE_MAX_TOUCHES)
+  {
+    statistics.crcErrors++;
+    synchronized = false;
+    return false;
+  }
+
+  for (uint8_t i = 0; i < frame->touchCount; i++)
+  {
+    uint32_t x, y, sizeX;
+    if (index + 2 > length)
+    {
+      statistics.crcErrors++;
+      synchronized = false;
+      return false;
+    }
+    uint8_t id = payload[index++];
+    frame->id[i] = id;
+    frame->event[i] = (TouchEvent)payload[index++];
+
+    bool tracked = (id < ZFORCE_STREAM_MAX_IDS);
+    if (!ReadDelta(payload, length, &index, tracked ? previousX[id] : 0, &x) ||
+        !ReadDelta(payload, length, &index, tracked ? previousY[id] : 0, &y) ||
+        !ReadDelta(payload, length, &index, tracked ? previousSizeX[id] : 0, &sizeX))
+    {
+      statistics.crcErrors++;
+      synchronized = false;
+      return false;
+    }
+
+    frame->x[i] = x;
+    frame->y[i] = y;
+    frame->sizeX[i] = sizeX;
+    if (tracked)
+    {
+      previousX[id] = x;
+      previousY[id] = y;
+      previousSizeX[id] = sizeX;
+    }
+  }
+
+  synchronized = true;
+  statistics.frames++;
+  return true;
+}
@@ -0,0 +1,110 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * Compact binary format for forwarding touch frames over a serial line.
+ *
+ * Each frame is sent as
+ *
+ *   0xA5 0x5A | length | sequence | flags | timestamp | touchCount | touches | CRC
+ *
+ * where length is the number of bytes from sequence up to and including the
+ * touches, and the CRC is CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+ * over length and those bytes, sent most significant byte first. The timestamp
+ * is a varint, absolute in key frames and relative to the previous frame
+ * otherwise. Each touch is its id, its event, and x, y and sizeX as zigzag
+ * varints relative to the previous values of the same id (relative to 0 in key
+ * frames and for ids of ZFORCE_STREAM_MAX_IDS and above).
+ *
+ * The decoder only depends on this file, TouchStream.cpp and the types in
+ * Zforce.h, so it can be built on a PC to read the stream.
+ */
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+#define ZFORCE_STREAM_SYNC1 0xA5
+#define ZFORCE_STREAM_SYNC2 0x5A
+#define ZFORCE_STREAM_KEY_FRAME 0x01
+// Touch ids that are tracked for delta encoding.
+#ifndef ZFORCE_STREAM_MAX_IDS
+#define ZFORCE_STREAM_MAX_IDS 16
+#endif
+// Number of frames between key frames, which let a decoder resynchronize after lost bytes.
+#ifndef ZFORCE_STREAM_KEY_FRAME_INTERVAL
+#define ZFORCE_STREAM_KEY_FRAME_INTERVAL 32
+#endif
+// Worst case size of an encoded frame: sync, length, sequence, flags, a 5 byte
+// timestamp, touchCount, id, event and three 5 byte values per touch, and the CRC.
+#define ZFORCE_STREAM_MAX_FRAME (2 + 1 + 2 + 5 + 1 + (ZFORCE_MAX_TOUCHES * 17) + 2)
+
+uint16_t TouchStreamCrc(uint16_t crc, uint8_t data);
+
+class TouchStreamEncoder
+{
+	public:
+		TouchStreamEncoder();
+		// Encodes frame into buffer, which must hold ZFORCE_STREAM_MAX_FRAME bytes.
+		// Returns the number of bytes to send.
+		uint8_t Encode(const TouchFrame* frame, uint8_t* buffer);
+		// Makes the next frame a key frame.
+		void Reset();
+	private:
+		uint8_t sequence;
+		uint8_t framesSinceKeyFrame;
+		uint32_t previousTimestamp;
+		TouchCoordinate previousX[ZFORCE_STREAM_MAX_IDS];
+		TouchCoordinate previousY[ZFORCE_STREAM_MAX_IDS];
+		TouchCoordinate previousSizeX[ZFORCE_STREAM_MAX_IDS];
+};
+
+typedef struct TouchStreamStatistics
+{
+	uint32_t frames;         // frames decoded
+	uint32_t crcErrors;      // frames dropped because of a CRC or format error
+	uint32_t lostFrames;     // gaps in the sequence numbers
+	uint32_t skippedFrames;  // frames dropped while waiting for a key frame
+} TouchStreamStatistics;
+
+class TouchStreamDecoder
+{
+	public:
+		TouchStreamDecoder();
+		// Feeds one received byte. Returns true when a complete frame has been
+		// decoded into frame, which must be the same for every call.
+		bool Feed(uint8_t data, TouchFrame* frame);
+		TouchStreamStatistics GetStatistics();
+		void Reset();
+	private:
+		bool DecodePayload(TouchFrame* frame);
+		uint8_t state;
+		uint8_t length;
+		uint8_t position;
+		uint16_t crc;
+		uint16_t receivedCrc;
+		uint8_t payload[ZFORCE_STREAM_MAX_FRAME];
+		bool synchronized;
+		uint8_t expectedSequence;
+		uint32_t previousTimestamp;
+		TouchCoordinate previousX[ZFORCE_STREAM_MAX_IDS];
+		TouchCoordinate previousY[ZFORCE_STREAM_MAX_IDS];
+		TouchCoordinate previousSizeX[ZFORCE_STREAM_MAX_IDS];
+		TouchStreamStatistics statistics;
+};
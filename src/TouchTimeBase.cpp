@@ -0,0 +1,154 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+#include <inttypes.h>
+#include "TouchTimeBase.h"
+
+TouchTimeBase::TouchTimeBase()
+{
+  SetTimestampBits(ZFORCE_TIMEBASE_SENSOR_BITS);
+  Reset();
+}
+
+void TouchTimeBase::SetTimestampBits(uint8_t bits)
+{
+  timestampBits = ((bits == 0) || (bits > 32)) ? 32 : bits;
+  timestampMask = (timestampBits == 32) ? 0xFFFFFFFF : ((1UL << timestampBits) - 1);
+}
+
+void TouchTimeBase::Reset()
+{
+  lastTimestamp = 0;
+  lastExtended = 0;
+  lastLocal = 0;
+  meanTicks = 0;
+  meanMicros = 0;
+  varianceTicks = 0;
+  covariance = 0;
+  latencyFloor = 0;
+  memset(&status, 0, sizeof(status));
+}
+
+float TouchTimeBase::Slope()
+{
+  return ((status.samples >= 2) && (varianceTicks > 0) && (covariance > 0)) ? (covariance / varianceTicks) : 0;
+}
+
+uint64_t TouchTimeBase::Update(TouchMessage* msg, uint32_t localTime)
+{
+  return Update(msg->timestamp, localTime);
+}
+
+uint64_t TouchTimeBase::Update(const TouchFrame* frame, uint32_t localTime)
+{
+  return Update(frame->timestamp, localTime);
+}
+
+uint64_t TouchTimeBase::Update(uint32_t timestamp, uint32_t localTime)
+{
+  while (timestamp & ~timestampMask)
+  {
+    SetTimestampBits(timestampBits + 8);
+  }
+
+  if (status.samples == 0)
+  {
+    lastExtended = timestamp;
+  }
+  else
+  {
+    uint64_t ticks = (timestamp - lastTimestamp) & timestampMask;
+    uint32_t elapsed = localTime - lastLocal;
+
+    // Whole counter periods that passed unseen during a long gap, estimated from the local clock.
+    float slope = Slope();
+    if (slope > 0)
+    {
+      float period = (float)timestampMask + 1.0f;
+      float missing = ((float)elapsed / slope - (float)ticks) / period;
+      if (missing >= 0.5f)
+      {
+        ticks += (uint64_t)(missing + 0.5f) << timestampBits;
+      }
+    }
+
+    uint64_t extended = lastExtended + ticks;
+    status.wraps += (uint32_t)((extended >> timestampBits) - (lastExtended >> timestampBits));
+    lastExtended = extended;
+
+    // Move the regression origin to the new notification.
+    meanTicks -= (float)ticks;
+    meanMicros -= (float)elapsed;
+  }
+
+  lastTimestamp = timestamp;
+  lastLocal = localTime;
+  status.samples++;
+
+  // Exponentially weighted regression, a plain average until the window is full.
+  float weight = 1.0f / (float)((status.samples < ZFORCE_TIMEBASE_WINDOW) ? status.samples : ZFORCE_TIMEBASE_WINDOW);
+  float deviationTicks = -meanTicks;
+  float deviationMicros = -meanMicros;
+  meanTicks += weight * deviationTicks;
+  meanMicros += weight * deviationMicros;
+  varianceTicks = (1.0f - weight) * (varianceTicks + weight * deviationTicks * deviationTicks);
+  covariance = (1.0f - weight) * (covariance + weight * deviationTicks * deviationMicros);
+
+  // How much later than predicted this notification arrived, compared to the fastest one.
+  float slope = Slope();
+  status.microsPerTick = slope;
+  uint32_t latency = 0;
+  if (slope > 0)
+  {
+    float delay = -(meanMicros - slope * meanTicks);
+    latencyFloor += ZFORCE_TIMEBASE_FLOOR_RISE;
+    if ((status.samples == 2) || (delay < latencyFloor))
+    {
+      latencyFloor = delay;
+    }
+    latency = (uint32_t)(delay - latencyFloor);
+  }
+
+  status.lastLatency = latency;
+  status.latencyTotal += latency;
+  if (latency > status.maxLatency)
+  {
+    status.maxLatency = latency;
+  }
+
+  return lastExtended;
+}
+
+uint32_t TouchTimeBase::GetCaptureTime()
+{
+  return lastLocal - status.lastLatency;
+}
+
+uint32_t TouchTimeBase::ToLocalTime(uint64_t sensorTime)
+{
+  float ticks = (sensorTime >= lastExtended) ? (float)(sensorTime - lastExtended) : -(float)(lastExtended - sensorTime);
+  return GetCaptureTime() + (uint32_t)(int32_t)(ticks * Slope());
+}
+
+TimeBaseStatus TouchTimeBase::GetStatus()
+{
+  return status;
+}
@@ -0,0 +1,95 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+#include <inttypes.h>
+#include "Zforce.h"
+
+// Width of the timestamp counter of the sensor. The timestamp is sent as an ASN.1
+// integer, whose length depends on its value, so the width cannot be told from a
+// single message. It is widened automatically if a larger timestamp is received.
+#ifndef ZFORCE_TIMEBASE_SENSOR_BITS
+#define ZFORCE_TIMEBASE_SENSOR_BITS 16
+#endif
+// Number of notifications the clock rate and offset are averaged over. Longer
+// windows give a steadier rate but follow temperature drift more slowly.
+#ifndef ZFORCE_TIMEBASE_WINDOW
+#define ZFORCE_TIMEBASE_WINDOW 256
+#endif
+// Microseconds per notification that the fastest seen delivery is allowed to
+// slow down, so that the latency floor follows changes of the bus timing.
+#ifndef ZFORCE_TIMEBASE_FLOOR_RISE
+#define ZFORCE_TIMEBASE_FLOOR_RISE 1
+#endif
+
+typedef struct TimeBaseStatus
+{
+	uint32_t samples;         // notifications added since Reset()
+	uint32_t wraps;           // times the sensor timestamp has wrapped
+	float microsPerTick;      // local microseconds per sensor timestamp tick, 0 until known
+	uint32_t lastLatency;     // microseconds from capture to reception of the latest notification
+	uint32_t maxLatency;
+	uint32_t latencyTotal;    // summed over all notifications, for the average
+} TimeBaseStatus;
+
+/*
+ * Relates the timestamps of touch notifications to the local micros() clock.
+ *
+ * The timestamp of the sensor is extended to 64 bits across wraps, and a running
+ * linear regression of the local reception time against it gives the rate and
+ * offset between the two clocks. The capture time of a notification is the local
+ * time the regression predicts for its timestamp, shifted so that the fastest
+ * notification seen has zero latency. The latency therefore excludes the shortest
+ * possible read of a notification, and includes everything that delays it further,
+ * such as a busy main loop.
+ *
+ * Gaps between notifications longer than the sensor counter period can only be
+ * bridged once the rate is known. Call Reset() when the sensor restarts.
+ */
+class TouchTimeBase
+{
+	public:
+		TouchTimeBase();
+		void SetTimestampBits(uint8_t bits);
+		// Adds a notification received at localTime, in micros(). Returns the
+		// extended sensor timestamp.
+		uint64_t Update(uint32_t timestamp, uint32_t localTime);
+		uint64_t Update(TouchMessage* msg, uint32_t localTime);
+		uint64_t Update(const TouchFrame* frame, uint32_t localTime);
+		// Local time at which the latest notification was captured by the sensor.
+		uint32_t GetCaptureTime();
+		// Local time at which the sensor captured an extended timestamp.
+		uint32_t ToLocalTime(uint64_t sensorTime);
+		TimeBaseStatus GetStatus();
+		void Reset();
+	private:
+		float Slope();
+		uint8_t timestampBits;
+		uint32_t timestampMask;
+		uint32_t lastTimestamp;
+		uint64_t lastExtended;
+		uint32_t lastLocal;
+		// Regression state, relative to the latest notification.
+		float meanTicks;
+		float meanMicros;
+		float varianceTicks;
+		float covariance;
+		float latencyFloor;
+		TimeBaseStatus status;
+};
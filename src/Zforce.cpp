@@ -30,10 +30,71 @@
     #include <WProgram.h>
   #endif
 #endif
+#if ZFORCE_FEATURE_LOW_POWER && defined(__AVR__)
+  #include <avr/sleep.h>
+#endif
+#if defined(__AVR__)
+  #include <avr/pgmspace.h>
+#endif
+#ifndef PROGMEM
+  #define PROGMEM
+#endif
+#ifndef pgm_read_byte
+  #define pgm_read_byte(address) (*(const uint8_t*)(address))
+#endif
+
+// Largest number of bytes the i2c library can move in one transaction. Longer
+// reads are split in chunks of this size. The Wire libraries of most platforms
+// tell their buffer size through one of the defines below.
+#ifndef ZFORCE_I2C_MAX_TRANSACTION
+  #if USE_I2C_LIB == 1
+    #define ZFORCE_I2C_MAX_TRANSACTION 255 // Reads go straight into the destination buffer.
+  #elif defined(BUFFER_LENGTH)
+    #define ZFORCE_I2C_MAX_TRANSACTION BUFFER_LENGTH
+  #elif defined(I2C_BUFFER_LENGTH)
+    #define ZFORCE_I2C_MAX_TRANSACTION I2C_BUFFER_LENGTH
+  #elif defined(WIRE_BUFFER_SIZE)
+    #define ZFORCE_I2C_MAX_TRANSACTION WIRE_BUFFER_SIZE
+  #elif defined(ARDUINO_ARCH_SAMD) && defined(SERIAL_BUFFER_SIZE)
+    // The SAMD core sizes the Wire RingBuffer with SERIAL_BUFFER_SIZE. Elsewhere
+    // it is the HardwareSerial buffer and says nothing about Wire.
+    #define ZFORCE_I2C_MAX_TRANSACTION SERIAL_BUFFER_SIZE
+  #else
+    #define ZFORCE_I2C_MAX_TRANSACTION 32
+  #endif
+#endif
+
+// Whether chunked reads keep the bus with a repeated start between the chunks.
+#ifndef ZFORCE_I2C_REPEATED_START
+  #if USE_I2C_LIB == 1
+    #define ZFORCE_I2C_REPEATED_START 0
+  #else
+    #define ZFORCE_I2C_REPEATED_START 1
+  #endif
+#endif
+
+static TouchDecodeFunction SelectTouchDecoder(const TouchMetaInformation* meta);
 
 Zforce::Zforce()
 {
+  this->pendingRequestCount = 0;
+  this->busStarted = false;
+  memset(&busFrequency, 0, sizeof(busFrequency));
+  busFrequency.frequency = ZFORCE_I2C_FREQUENCY;
+  this->busFrequencyFallbackPending = false;
+  this->touchDescriptorInitialized = false;
+#if ZFORCE_FEATURE_RAW_MESSAGES
   this->remainingRawLength = 0;
+#endif
+  ResetBusStatistics();
+#if ZFORCE_FEATURE_TOUCH_FILTER
+  this->touchFilterEnabled = false;
+  ResetTouchFilterStatistics();
+#endif
+#if ZFORCE_FEATURE_LOW_POWER
+  this->dataReadyInterruptAttached = false;
+  ResetLowPowerStatistics();
+#endif
 }
 
 void Zforce::Start(int dr)
@@ -46,12 +107,7 @@ void Zforce::Start(int dr, int i2cAddress)
   this->i2cAddress = i2cAddress;
   dataReady = dr;
   pinMode(dataReady, INPUT);
-#if USE_I2C_LIB == 1
-  I2c.setSpeed(1);
-  I2c.begin();
-#else
-  Wire.begin();
-#endif
+  BeginBus();
 
   /* Reading of boot complete and sending/reading of touchformat 
    * can be moved to user side but is by default 
@@ -82,6 +138,7 @@ void Zforce::Start(int dr, int i2cAddress)
     this->DestroyMessage(msg);
   }
     
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
   // Get Platform information
   this->GetPlatformInformation();
   do
@@ -99,235 +156,809 @@ void Zforce::Start(int dr, int i2cAddress)
     this->MCUUniqueIdentifier[length] = '\0';
   }
   this->DestroyMessage(msg);
+#endif
 }
 
-int Zforce::Read(uint8_t * payload)
+void Zforce::BeginBus()
 {
 #if USE_I2C_LIB == 1
-  int status = 0;
-
-  status = I2c.read(this->i2cAddress, 2);
-
-  // Read the 2 I2C header bytes.
-  payload[0] = I2c.receive();
-  payload[1] = I2c.receive();
-
-  status = I2c.read(this->i2cAddress, payload[1], &payload[2]);
-
-  return status; // return 0 if success, otherwise error code according to Atmel Data Sheet
+  I2c.begin();
+  I2c.timeOut(ZFORCE_I2C_TIMEOUT_MS);
 #else
-  Wire.requestFrom(this->i2cAddress, 2);
-  payload[0] = Wire.read();
-  payload[1] = Wire.read();
-  
-  int index = 2;
-  Wire.requestFrom(this->i2cAddress, payload[1]);
-  while (Wire.available())
-  {
-    payload[index++] = Wire.read();
-  }
-  
-  return 0;
+  Wire.begin();
+#if defined(WIRE_HAS_TIMEOUT)
+  Wire.setWireTimeout(ZFORCE_I2C_TIMEOUT_MS * 1000UL, true);
+#endif
 #endif
+  // begin() resets the clock, so the frequency is set afterwards.
+  busStarted = true;
+  ApplyBusFrequency();
 }
 
-/*
- * Sends a message in the form of a byte array.
- */
-int Zforce::Write(uint8_t* payload)
+void Zforce::ApplyBusFrequency()
 {
+  if (!busStarted)
+  {
+    return;
+  }
 #if USE_I2C_LIB == 1
-  int len = payload[1] + 1;
-  int status = I2c.write(this->i2cAddress, payload[0], &payload[1], len);
-
-  return status; // return 0 if success, otherwise error code according to Atmel Data Sheet
+  busFrequency.actualFrequency = I2c.setFrequency(busFrequency.frequency);
 #else
-  Wire.beginTransmission(this->i2cAddress);
-  Wire.write(payload, payload[1] + 2);
-  Wire.endTransmission();
-
-  return 0;
+  Wire.setClock(busFrequency.frequency);
+  busFrequency.actualFrequency = busFrequency.frequency;
 #endif
 }
 
+#if ZFORCE_FEATURE_LOW_POWER
+// Set by the data ready interrupt. Only one sensor at a time can use SleepUntilMessage.
+static volatile bool dataReadyEdge = false;
+static volatile uint32_t dataReadyEdgeTime = 0;
+#endif
+
 /*
- * Send the octet array containing an ASN.1 command as is, without validation.
- * If you need to send more than 255 bytes, call it more times with new data until done.
- *
- * payload        Pointer to the octet buffer containing the ASN.1 payload to send.
- * payloadLength  Length of the data to send.
- *
- * Return Value   true for successful send and false if any error occured.
- *                Sadly, some Arduino i2c drivers do not signal errors.
+ * Reads one message from the sensor, retrying failed transactions.
+ * If the bus had to be recovered, the read is restarted from the i2c header
+ * as long as the sensor still signals that it has data for us.
  */
-bool Zforce::SendRawMessage(uint8_t* payload, uint8_t payloadLength)
+int Zforce::Read(uint8_t * payload)
 {
-  if ((payload == nullptr) || (payloadLength == 0))
-  {
-    return false;
-  }
-
-  buffer[0] = 0xEE;
-  buffer[1] = payloadLength;
-  memcpy(&buffer[2], payload, payloadLength);
+  int status = 0;
+  bool headerRead = false;
 
-  return Write(buffer) == 0;
-}
+  ApplyPendingFallback();
+#if ZFORCE_FEATURE_LOW_POWER
+  // This is the message of any edge seen so far, also when it is read without
+  // SleepUntilMessage, so a later sleep must wait for the next edge.
+  dataReadyEdge = false;
+#endif
 
-/*
- * Receive a raw ASN.1 message. The only validation done is decoding the initial ASN.1 payload length
- * to see if more data should follow.
- *
- * receivedLength   A pointer to where the size of the returned data should be placed.
- * remainingLength  A pointer to where the size of the remaining data should be placed, if any.
- *
- * Return value     If an error occured (see comment above for the return value of SendRawMessage),
- *                  the pointer will be nullptr.
- *                  A pointer to the ASN.1 payload of the received data is returned.
- *                  Note, that any subsequent read or write-operation, even notifications, touches, etc will
- *                  will overwrite the buffer, so make sure to copy any data you want to save.
- */
-uint8_t* Zforce::ReceiveRawMessage(uint8_t* receivedLength, uint16_t *remainingLength)
-{
-  if ((GetDataReady() == HIGH) && !Read(buffer))
+  for (uint8_t attempt = 0; ; attempt++)
   {
-    uint8_t i2cPayloadLength = buffer[1];
-    // Check if this is a second or first call.
-    if (this->remainingRawLength == 0)
+    if (!headerRead)
     {
-      // This is the first invocation.
-      // Check if it's a short, 2, or 3 byte length encoding.
-      uint8_t firstLengthByte = buffer[3];
-      uint16_t asn1AfterHeaderLength;
-      uint8_t asn1HeaderLength = 2; // EE/EF/F0 + First byte of length.
-      if (firstLengthByte < 0x80)
+      // Read the 2 I2C header bytes.
+      status = ReadTransaction(payload, 2);
+      CountTransaction(status);
+      headerRead = (status == 0);
+    }
+
+    if (headerRead)
+    {
+#if MAX_PAYLOAD < 255
+      if (payload[1] > MAX_PAYLOAD)
       {
-        // Short form. Lower 7 bits are the length, but since the high bit is 0, we don't need to & 0x7F to get the lower 7.
-        asn1AfterHeaderLength = firstLengthByte;
+        // Read what fits and discard the rest, so that the next read starts
+        // at a message boundary. The message is dropped either way.
+        status = ReadTransaction(&payload[2], MAX_PAYLOAD);
+        CountTransaction(status);
+        if (status == 0)
+        {
+          status = ReadTransaction(nullptr, payload[1] - MAX_PAYLOAD);
+          CountTransaction(status);
+        }
+        if (status == 0)
+        {
+          payload[1] = MAX_PAYLOAD;
+          return ZFORCE_MESSAGE_TRUNCATED;
+        }
       }
       else
+#endif
       {
-        // Long form. First byte's top bit is set. The lower 7 bits contain the number of length bytes.
-        // The following 1 or 2 bytes contain the actual length, in Big Endian / Motorola Byte Order encoding.
-        uint8_t numberOfLengthBytes = (firstLengthByte & 0x7F);
-        asn1HeaderLength += numberOfLengthBytes;
-        asn1AfterHeaderLength = buffer[4];
-        if (numberOfLengthBytes == 2)
-        {
-          asn1AfterHeaderLength <<= 8;
-          asn1AfterHeaderLength += buffer[5];
-        }
-        else if (numberOfLengthBytes != 1)
+        status = ReadTransaction(&payload[2], payload[1]);
+        CountTransaction(status);
+        if (status == 0)
         {
-          // The data is most likely corrupted. Valid numbers are 1 and 2.
-          *receivedLength = 0;
-          *remainingLength = 0;
-          return nullptr;
+          return 0;
         }
       }
-      uint16_t fullAsn1MessageLength = asn1AfterHeaderLength + asn1HeaderLength;
-      // Full is the full ASN.1 payload, which can be split over several i2c payloads.
-      this->remainingRawLength = fullAsn1MessageLength - i2cPayloadLength;
-      *remainingLength = this->remainingRawLength;
-      *receivedLength = i2cPayloadLength;
     }
-    else
+
+    RecordBusError(status);
+    if (attempt == ZFORCE_I2C_RETRIES)
     {
-      // Since this is the second or later invocation, we do NOT parse the ASN.1, since it
-      // may well be in the middle of some data, and we already know the lengths.
-      this->remainingRawLength -= i2cPayloadLength;
-      *remainingLength = this->remainingRawLength;
-      *receivedLength = i2cPayloadLength;
+      break;
+    }
+
+    if (PrepareRetry(status, attempt))
+    {
+      headerRead = false;
+      if (GetDataReady() == LOW)
+      {
+        break;
+      }
     }
   }
-  else
+
+  busStatistics.failedTransactions++;
+#if ZFORCE_FEATURE_RAW_MESSAGES
+  this->remainingRawLength = 0; // A partially read raw message cannot be continued.
+#endif
+  return status;
+}
+
+// A byte of a command that depends on the arguments, replacing the byte at offset.
+typedef struct CommandPatch
+{
+  uint8_t offset;
+  uint8_t value;
+} CommandPatch;
+
+// Where the bytes of a command being written come from.
+typedef struct CommandSource
+{
+  const uint8_t* bytes;
+  bool inFlash;
+  const CommandPatch* patches;
+  uint8_t patchCount;
+} CommandSource;
+
+static uint8_t CommandByte(void* context, uint8_t index)
+{
+  const CommandSource* source = (const CommandSource*)context;
+  for (uint8_t i = 0; i < source->patchCount; i++)
   {
-    // Either Data Ready was not high, or the read failed.
-    *remainingLength = 0;
-    *receivedLength = 0;
-    return nullptr;
+    if (source->patches[i].offset == index)
+    {
+      return source->patches[i].value;
+    }
   }
+  return source->inFlash ? pgm_read_byte(&source->bytes[index]) : source->bytes[index];
+}
 
-  return &buffer[2]; // Skipping the i2c header in the response.
+/*
+ * Sends a message in the form of a byte array, retrying failed transactions.
+ */
+int Zforce::Write(uint8_t* payload)
+{
+  CommandSource source = {payload, false, nullptr, 0};
+  return WriteSource(&source, payload[1] + 2);
 }
 
-bool Zforce::Enable(bool isEnabled)
+/*
+ * Sends a command stored in flash, with the bytes given in patches replaced, without
+ * copying it to RAM first. command is a PROGMEM array of length bytes, including the i2c header.
+ */
+int Zforce::WriteCommand(const uint8_t* command, uint8_t length, const CommandPatch* patches, uint8_t patchCount)
 {
-  bool failed = false;
-  int returnCode;
+  CommandSource source = {command, true, patches, patchCount};
+  return WriteSource(&source, length);
+}
+
+int Zforce::WriteSource(const CommandSource* source, uint8_t length)
+{
+  int status = 0;
 
-  uint8_t enable[] =  {0xEE, 0x0B, 0xEE, 0x09, 0x40, 0x02, 0x02, 0x00, 0x65, 0x03, 0x81, 0x01, 0x00};
-  uint8_t disable[] = {0xEE, 0x0A, 0xEE, 0x08, 0x40, 0x02, 0x02, 0x00, 0x65, 0x02, 0x80, 0x00};
-  uint8_t operationMode[] = {0xEE, 0x17, 0xEE, 0x15, 0x40, 0x02, 0x02, 0x00, 0x67, 0x0F, 0x80, 0x01, 0xFF, 0x81, 0x01, 0x00, 0x82, 0x01, 0x00, 0x83, 0x01, 0x00, 0x84, 0x01, 0x00};
+#if USE_I2C_LIB == 0
+  if (length > ZFORCE_I2C_MAX_TRANSACTION)
+  {
+    // A write cannot be split, and Wire would silently truncate it.
+    busStatistics.failedTransactions++;
+    return 1;
+  }
+#endif
 
-  // We assume that the end user has called GetMessage prior to calling this method
-  if (isEnabled)
+  ApplyPendingFallback();
+
+  for (uint8_t attempt = 0; ; attempt++)
   {
-    returnCode = Write(operationMode);
-    if (returnCode != 0)
+    status = WriteTransaction(source, length);
+    CountTransaction(status);
+    if (status == 0)
     {
-      failed = true;
+      return 0;
     }
-    else
-    {
-      Message* msg = nullptr;
-      do
-      {
-        msg = this->GetMessage();
-      } while (msg == nullptr);
 
-      this->DestroyMessage(msg);
-
-      returnCode = Write(enable);
+    RecordBusError(status);
+    if (attempt == ZFORCE_I2C_RETRIES)
+    {
+      break;
     }
+
+    PrepareRetry(status, attempt);
   }
-  else 
+
+  busStatistics.failedTransactions++;
+  return status;
+}
+
+/*
+ * One i2c read without any retries, split in chunks if it does not fit in the Wire buffer.
+ * With destination nullptr the bytes are read and thrown away.
+ *
+ * Return value     0 if success. On Atmel platforms the error code according to the Atmel data sheet,
+ *                  otherwise 2 if the sensor did not answer, 4 if fewer bytes than requested were
+ *                  received and 5 on timeout (same codes as Wire.endTransmission()).
+ */
+int Zforce::ReadTransaction(uint8_t* destination, uint8_t length)
+{
+#if USE_I2C_LIB == 1
+  if (destination != nullptr)
   {
-    returnCode = Write(disable);
+    return I2c.read((uint8_t)this->i2cAddress, length, destination);
   }
 
-  if (returnCode != 0)
+  // Without a destination the I2C library reads into its own buffer.
+  while (length > 0)
   {
-    failed = true;
+    uint8_t chunkLength = (length > MAX_BUFFER_SIZE) ? MAX_BUFFER_SIZE : length;
+    int status = I2c.read((uint8_t)this->i2cAddress, chunkLength);
+    if (status != 0)
+    {
+      return status;
+    }
+    length -= chunkLength;
   }
-  else
+  return 0;
+#else
+  uint8_t index = 0;
+
+  // Messages longer than the Wire buffer are read in chunks. The sensor
+  // continues where the previous chunk ended.
+  while (index < length)
   {
-    lastSentMessage = MessageType::ENABLETYPE;
+    uint8_t chunkLength = length - index;
+    if (chunkLength > ZFORCE_I2C_MAX_TRANSACTION)
+    {
+      chunkLength = ZFORCE_I2C_MAX_TRANSACTION;
+    }
+    uint8_t sendStop = ((index + chunkLength) == length) || !ZFORCE_I2C_REPEATED_START;
+
+    uint8_t received = Wire.requestFrom((uint8_t)this->i2cAddress, chunkLength, sendStop);
+    uint8_t chunkEnd = index + chunkLength;
+    while (Wire.available() && (index < chunkEnd))
+    {
+      uint8_t value = Wire.read();
+      if (destination != nullptr)
+      {
+        destination[index] = value;
+      }
+      index++;
+    }
+
+#if defined(WIRE_HAS_TIMEOUT)
+    if (Wire.getWireTimeoutFlag())
+    {
+      Wire.clearWireTimeoutFlag();
+      return 5;
+    }
+#endif
+    if (received == 0)
+    {
+      return 2;
+    }
+    if (index < chunkEnd)
+    {
+      return 4;
+    }
   }
 
-  return !failed;
+  return 0;
+#endif
 }
 
-bool Zforce::GetEnable()
+/*
+ * A single i2c write transaction without any retries.
+ *
+ * Return value     0 if success, otherwise the error code according to the Atmel data sheet
+ *                  or as returned by Wire.endTransmission().
+ */
+int Zforce::WriteTransaction(const CommandSource* source, uint8_t length)
 {
-  bool failed = false;
-  uint8_t enable[] = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x02, 0x00, 0x65, 0x00};
+#if USE_I2C_LIB == 1
+  return I2c.write((uint8_t)this->i2cAddress, length, CommandByte, (void*)source);
+#else
+  Wire.beginTransmission((uint8_t)this->i2cAddress);
+  for (uint8_t i = 0; i < length; i++)
+  {
+    Wire.write(CommandByte((void*)source, i));
+  }
+  return Wire.endTransmission();
+#endif
+}
 
-  if (Write(enable)) // We assume that the end user has called GetMessage prior to calling this method
+BusErrorType Zforce::ClassifyBusError(int status)
+{
+#if USE_I2C_LIB == 1
+  if ((status >= 1) && (status <= 7)) // Timeout, see I2C.cpp for the meaning of each value
   {
-    failed = true;
+    return BusErrorType::TIMEOUT;
   }
-  else
+
+  switch (status)
   {
-    lastSentMessage = MessageType::ENABLETYPE;
+    case 0:
+      return BusErrorType::NONE;
+    case MT_SLA_NACK:
+    case MT_DATA_NACK:
+    case MR_SLA_NACK:
+      return BusErrorType::NACK;
+    case LOST_ARBTRTN:
+      return BusErrorType::ARBITRATIONLOST;
+    default:
+      return BusErrorType::OTHER;
+  }
+#else
+  switch (status)
+  {
+    case 0:
+      return BusErrorType::NONE;
+    case 2: // NACK on address
+    case 3: // NACK on data
+      return BusErrorType::NACK;
+    case 5:
+      return BusErrorType::TIMEOUT;
+    default:
+      return BusErrorType::OTHER;
   }
+#endif
+}
 
-  return !failed;
+void Zforce::RecordBusError(int status)
+{
+  busStatistics.lastError = status;
+  switch (ClassifyBusError(status))
+  {
+    case BusErrorType::TIMEOUT:
+      busStatistics.timeouts++;
+    break;
+    case BusErrorType::NACK:
+      busStatistics.nacks++;
+    break;
+    case BusErrorType::ARBITRATIONLOST:
+      busStatistics.arbitrationLosses++;
+    break;
+    case BusErrorType::OTHER:
+      busStatistics.otherErrors++;
+    break;
+    default:
+    break;
+  }
 }
 
-bool Zforce::TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY)
+/*
+ * Waits before the next attempt, doubling the delay for every attempt.
+ * A NACK only means the sensor is busy, any other error leaves the bus in an
+ * unknown state and the bus is recovered before retrying.
+ *
+ * Return value     true if the bus was recovered.
+ */
+bool Zforce::PrepareRetry(int status, uint8_t attempt)
 {
-  bool failed = false;
+  busStatistics.retries++;
+  delayMicroseconds(ZFORCE_I2C_BACKOFF_US << attempt);
 
-  uint8_t touchActiveAreaPayloadLength = 2 * 4;
+  if (ClassifyBusError(status) == BusErrorType::NACK)
+  {
+    return false;
+  }
+
+  RecoverBus();
+  return true;
+}
+
+/*
+ * Frees a bus where the sensor holds SDA low by clocking out SCL, then
+ * reinitializes the i2c peripheral.
+ */
+void Zforce::RecoverBus()
+{
+  busStatistics.recoveries++;
+#if USE_I2C_LIB == 1
+  I2c.recover();
+#else
+  Wire.end();
+  pinMode(ZFORCE_SDA_PIN, INPUT_PULLUP);
+  pinMode(ZFORCE_SCL_PIN, INPUT_PULLUP);
+  delayMicroseconds(5);
+  for (uint8_t i = 0; (i < 9) && (digitalRead(ZFORCE_SDA_PIN) == LOW); i++)
+  {
+    digitalWrite(ZFORCE_SCL_PIN, LOW);
+    pinMode(ZFORCE_SCL_PIN, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(ZFORCE_SCL_PIN, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+  // Generate a STOP condition: SDA low to high while SCL is high.
+  digitalWrite(ZFORCE_SDA_PIN, LOW);
+  pinMode(ZFORCE_SDA_PIN, OUTPUT);
+  delayMicroseconds(5);
+  pinMode(ZFORCE_SDA_PIN, INPUT_PULLUP);
+  delayMicroseconds(5);
+  BeginBus();
+#endif
+}
+
+// Frequencies tried by ProbeBusFrequency() and stepped down through on errors.
+static const uint32_t busFrequencySteps[] = {50000, 100000, 200000, 400000, 700000, 1000000};
+
+/*
+ * Sets the i2c clock frequency in Hz. Takes effect immediately if the bus has been
+ * started, otherwise in Start().
+ *
+ * Return value   The frequency the i2c peripheral runs at, which on Atmel platforms
+ *                is the closest one at or below frequency that it supports. 0 before Start().
+ */
+uint32_t Zforce::SetBusFrequency(uint32_t frequency)
+{
+  busFrequencyFallbackPending = false;
+  busFrequency.frequency = frequency;
+  busFrequency.windowTransactions = 0;
+  busFrequency.windowErrors = 0;
+  ApplyBusFrequency();
+  return busFrequency.actualFrequency;
+}
+
+/*
+ * Raises the i2c clock frequency step by step up to maxFrequency, for as long as
+ * the sensor answers ZFORCE_I2C_PROBE_ROUNDS requests without any bus errors, and
+ * stays at the highest frequency that passed. Must be called after Start() and
+ * while the sensor is not enabled, as any touch notifications read meanwhile are dropped.
+ *
+ * Return value   The frequency chosen.
+ */
+uint32_t Zforce::ProbeBusFrequency(uint32_t maxFrequency)
+{
+  for (uint8_t i = 0; i < sizeof(busFrequencySteps) / sizeof(busFrequencySteps[0]); i++)
+  {
+    uint32_t step = busFrequencySteps[i];
+    if ((step <= busFrequency.frequency) || (step > maxFrequency))
+    {
+      continue;
+    }
+
+    uint32_t previous = busFrequency.frequency;
+    SetBusFrequency(step);
+    if (!ProbeRoundTrips())
+    {
+      SetBusFrequency(previous);
+      break;
+    }
+  }
+
+  return busFrequency.frequency;
+}
+
+// Sends GetEnable requests and waits for their responses. Fails on any bus error other than a NACK.
+bool Zforce::ProbeRoundTrips()
+{
+  BusStatistics before = busStatistics;
+
+  for (uint8_t round = 0; round < ZFORCE_I2C_PROBE_ROUNDS; round++)
+  {
+    if (!GetEnable())
+    {
+      return false;
+    }
+
+    bool answered = false;
+    uint32_t startTime = millis();
+    while (!answered && ((uint32_t)(millis() - startTime) < ZFORCE_I2C_TIMEOUT_MS * 10UL))
+    {
+      Message* msg = GetMessage();
+      if (msg != nullptr)
+      {
+        answered = (msg->type == MessageType::ENABLETYPE);
+        DestroyMessage(msg);
+      }
+    }
+
+    if (!answered)
+    {
+      return false;
+    }
+  }
+
+  return (busStatistics.timeouts == before.timeouts) &&
+         (busStatistics.arbitrationLosses == before.arbitrationLosses) &&
+         (busStatistics.otherErrors == before.otherErrors) &&
+         (busStatistics.failedTransactions == before.failedTransactions);
+}
+
+/*
+ * Counts an i2c transaction towards the fallback window. Once a window has too many
+ * errors, the frequency is lowered before the next message, as changing it between
+ * the transactions of one message could corrupt the rest of that message.
+ */
+void Zforce::CountTransaction(int status)
+{
+#if ZFORCE_I2C_FALLBACK_ERRORS > 0
+  busFrequency.windowTransactions++;
+  if (status != 0)
+  {
+    busFrequency.windowErrors++;
+  }
+
+  if (busFrequency.windowTransactions >= ZFORCE_I2C_FALLBACK_WINDOW)
+  {
+    if (busFrequency.windowErrors >= ZFORCE_I2C_FALLBACK_ERRORS)
+    {
+      busFrequencyFallbackPending = true;
+    }
+    busFrequency.windowTransactions = 0;
+    busFrequency.windowErrors = 0;
+  }
+#endif
+}
+
+// Lowers the frequency if CountTransaction() asked for it. Called between messages.
+void Zforce::ApplyPendingFallback()
+{
+  if (busFrequencyFallbackPending)
+  {
+    busFrequencyFallbackPending = false;
+    LowerBusFrequency();
+  }
+}
+
+void Zforce::LowerBusFrequency()
+{
+  uint32_t lower = 0;
+  for (uint8_t i = 0; i < sizeof(busFrequencySteps) / sizeof(busFrequencySteps[0]); i++)
+  {
+    if ((busFrequencySteps[i] < busFrequency.frequency) && (busFrequencySteps[i] >= ZFORCE_I2C_MIN_FREQUENCY))
+    {
+      lower = busFrequencySteps[i];
+    }
+  }
+
+  if (lower != 0)
+  {
+    busFrequency.fallbacks++;
+    SetBusFrequency(lower);
+  }
+}
+
+BusFrequencyStatus Zforce::GetBusFrequencyStatus()
+{
+  return busFrequency;
+}
+
+TransportCapabilities Zforce::GetTransportCapabilities()
+{
+  TransportCapabilities capabilities;
+  capabilities.maxTransactionSize = ZFORCE_I2C_MAX_TRANSACTION;
+  capabilities.repeatedStart = ZFORCE_I2C_REPEATED_START;
+  return capabilities;
+}
+
+BusStatistics Zforce::GetBusStatistics()
+{
+  return busStatistics;
+}
+
+void Zforce::ResetBusStatistics()
+{
+  memset(&busStatistics, 0, sizeof(busStatistics));
+}
+
+#if ZFORCE_FEATURE_RAW_MESSAGES
+/*
+ * Send the octet array containing an ASN.1 command as is, without validation.
+ * If you need to send more than 255 bytes, call it more times with new data until done.
+ *
+ * payload        Pointer to the octet buffer containing the ASN.1 payload to send.
+ * payloadLength  Length of the data to send.
+ *
+ * Return Value   true for successful send and false if any error occured.
+ *                Sadly, some Arduino i2c drivers do not signal errors.
+ */
+bool Zforce::SendRawMessage(uint8_t* payload, uint8_t payloadLength)
+{
+  if ((payload == nullptr) || (payloadLength == 0))
+  {
+    return false;
+  }
+#if MAX_PAYLOAD < 255
+  if (payloadLength > MAX_PAYLOAD)
+  {
+    return false;
+  }
+#endif
+
+  buffer[0] = 0xEE;
+  buffer[1] = payloadLength;
+  memcpy(&buffer[2], payload, payloadLength);
+
+  return Write(buffer) == 0;
+}
+
+/*
+ * Receive a raw ASN.1 message. The only validation done is decoding the initial ASN.1 payload length
+ * to see if more data should follow.
+ *
+ * receivedLength   A pointer to where the size of the returned data should be placed.
+ * remainingLength  A pointer to where the size of the remaining data should be placed, if any.
+ *
+ * Return value     If an error occured (see comment above for the return value of SendRawMessage),
+ *                  the pointer will be nullptr.
+ *                  A pointer to the ASN.1 payload of the received data is returned.
+ *                  Note, that any subsequent read or write-operation, even notifications, touches, etc will
+ *                  will overwrite the buffer, so make sure to copy any data you want to save.
+ */
+uint8_t* Zforce::ReceiveRawMessage(uint8_t* receivedLength, uint16_t *remainingLength)
+{
+  if ((GetDataReady() == HIGH) && !Read(buffer))
+  {
+    uint8_t i2cPayloadLength = buffer[1];
+    // Check if this is a second or first call.
+    if (this->remainingRawLength == 0)
+    {
+      // This is the first invocation.
+      // Check if it's a short, 2, or 3 byte length encoding.
+      uint8_t firstLengthByte = buffer[3];
+      uint16_t asn1AfterHeaderLength;
+      uint8_t asn1HeaderLength = 2; // EE/EF/F0 + First byte of length.
+      if (firstLengthByte < 0x80)
+      {
+        // Short form. Lower 7 bits are the length, but since the high bit is 0, we don't need to & 0x7F to get the lower 7.
+        asn1AfterHeaderLength = firstLengthByte;
+      }
+      else
+      {
+        // Long form. First byte's top bit is set. The lower 7 bits contain the number of length bytes.
+        // The following 1 or 2 bytes contain the actual length, in Big Endian / Motorola Byte Order encoding.
+        uint8_t numberOfLengthBytes = (firstLengthByte & 0x7F);
+        asn1HeaderLength += numberOfLengthBytes;
+        asn1AfterHeaderLength = buffer[4];
+        if (numberOfLengthBytes == 2)
+        {
+          asn1AfterHeaderLength <<= 8;
+          asn1AfterHeaderLength += buffer[5];
+        }
+        else if (numberOfLengthBytes != 1)
+        {
+          // The data is most likely corrupted. Valid numbers are 1 and 2.
+          *receivedLength = 0;
+          *remainingLength = 0;
+          return nullptr;
+        }
+      }
+      uint16_t fullAsn1MessageLength = asn1AfterHeaderLength + asn1HeaderLength;
+      // Full is the full ASN.1 payload, which can be split over several i2c payloads.
+      this->remainingRawLength = fullAsn1MessageLength - i2cPayloadLength;
+      *remainingLength = this->remainingRawLength;
+      *receivedLength = i2cPayloadLength;
+    }
+    else
+    {
+      // Since this is the second or later invocation, we do NOT parse the ASN.1, since it
+      // may well be in the middle of some data, and we already know the lengths.
+      this->remainingRawLength -= i2cPayloadLength;
+      *remainingLength = this->remainingRawLength;
+      *receivedLength = i2cPayloadLength;
+    }
+  }
+  else
+  {
+    // Either Data Ready was not high, or the read failed.
+    *remainingLength = 0;
+    *receivedLength = 0;
+    return nullptr;
+  }
+
+  return &buffer[2]; // Skipping the i2c header in the response.
+}
+#endif
+
+/*
+ * Commands with a fixed layout are kept in flash and sent with WriteCommand(). The
+ * bytes that depend on the arguments are patched in while sending, at the offsets
+ * defined after each command. Commands whose length depends on the arguments are
+ * still built in RAM.
+ */
+static const uint8_t enableCommand[] PROGMEM = {0xEE, 0x0B, 0xEE, 0x09, 0x40, 0x02, 0x02, 0x00, 0x65, 0x03, 0x81, 0x01, 0x00};
+static const uint8_t disableCommand[] PROGMEM = {0xEE, 0x0A, 0xEE, 0x08, 0x40, 0x02, 0x02, 0x00, 0x65, 0x02, 0x80, 0x00};
+static const uint8_t operationModeCommand[] PROGMEM = {0xEE, 0x17, 0xEE, 0x15, 0x40, 0x02, 0x02, 0x00, 0x67, 0x0F, 0x80, 0x01, 0xFF, 0x81, 0x01, 0x00, 0x82, 0x01, 0x00, 0x83, 0x01, 0x00, 0x84, 0x01, 0x00};
+static const uint8_t getEnableCommand[] PROGMEM = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x02, 0x00, 0x65, 0x00};
+static const uint8_t touchFormatCommand[] PROGMEM = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x02, 0x00, 0x66, 0x00};
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
+// FlipXY, ReverseX and ReverseY only differ in the identifier of the setting.
+static const uint8_t axisSettingCommand[] PROGMEM = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x00, 0x01, 0x00};
+#define AXIS_SETTING_IDENTIFIER_SLOT 12
+#define AXIS_SETTING_VALUE_SLOT 14
+#endif
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
+static const uint8_t getFrequencyCommand[] PROGMEM = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x00, 0x00, 0x68, 0x00};
+static const uint8_t reportedTouchesCommand[] PROGMEM = {0xEE, 0x0B, 0xEE, 0x09, 0x40, 0x02, 0x02, 0x00, 0x73, 0x03, 0x86, 0x01, 0x00};
+#define REPORTED_TOUCHES_SLOT 12
+static const uint8_t detectionModeCommand[] PROGMEM = {0xEE, 0x0C, 0xEE, 0x0A, 0x40, 0x02, 0x02, 0x00, 0x73, 0x04, 0x85, 0x02, 0x00, 0x00};
+#define DETECTION_MODE_SLOT 13
+#endif
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
+static const uint8_t platformInformationCommand[] PROGMEM = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x00, 0x00, 0x6C, 0x00};
+#endif
+
+bool Zforce::Enable(bool isEnabled)
+{
+  // We assume that the end user has called GetMessage prior to calling this method
+  if (isEnabled)
+  {
+    if (!OperationMode())
+    {
+      return false;
+    }
+
+    Message* msg = nullptr;
+    do
+    {
+      msg = this->GetMessage();
+    } while (msg == nullptr);
+
+    this->DestroyMessage(msg);
+  }
+
+  return SetEnable(isEnabled);
+}
+
+/*
+ * Sets the sensor to normal detection mode, without waiting for the response.
+ */
+bool Zforce::OperationMode()
+{
+  if (WriteCommand(operationModeCommand, sizeof(operationModeCommand), nullptr, 0) != 0)
+  {
+    return false;
+  }
+
+  AddPendingRequest(MessageType::OPERATIONMODETYPE);
+  return true;
+}
+
+/*
+ * Enables or disables the sensor without changing its operation mode and without
+ * waiting for the response.
+ */
+bool Zforce::SetEnable(bool isEnabled)
+{
+  int returnCode;
+  if (isEnabled)
+  {
+    returnCode = WriteCommand(enableCommand, sizeof(enableCommand), nullptr, 0);
+  }
+  else
+  {
+    returnCode = WriteCommand(disableCommand, sizeof(disableCommand), nullptr, 0);
+  }
+
+  if (returnCode != 0)
+  {
+    return false;
+  }
+
+  AddPendingRequest(MessageType::ENABLETYPE);
+  return true;
+}
+
+bool Zforce::GetEnable()
+{
+  bool failed = false;
+  if (WriteCommand(getEnableCommand, sizeof(getEnableCommand), nullptr, 0)) // We assume that the end user has called GetMessage prior to calling this method
+  {
+    failed = true;
+  }
+  else
+  {
+    AddPendingRequest(MessageType::ENABLETYPE);
+  }
+
+  return !failed;
+}
+
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
+bool Zforce::TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY)
+{
+  bool failed = false;
+
+  uint8_t touchActiveAreaPayloadLength = 2 * 4;
   // 2 bytes * 4 entries. Not counting the actual values, which are 1 or 2 bytes.
 
   // Each value that is >127 gets an extra byte.
 
-  uint8_t minXValue[2];
-  uint8_t minYValue[2];
-  uint8_t maxXValue[2];
-  uint8_t maxYValue[2];
+  uint8_t minXValue[2] = {0, 0};
+  uint8_t minYValue[2] = {0, 0};
+  uint8_t maxXValue[2] = {0, 0};
+  uint8_t maxYValue[2] = {0, 0};
 
   uint8_t minXLength = SerializeInt(minX, minXValue);
   uint8_t minYLength = SerializeInt(minY, minYValue);
@@ -399,12 +1030,14 @@ bool Zforce::TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16
   }
   else
   {
-    lastSentMessage = MessageType::TOUCHACTIVEAREATYPE;
+    AddPendingRequest(MessageType::TOUCHACTIVEAREATYPE);
   }
 
   return !failed;
 }
+#endif
 
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
 bool Zforce::Frequency(uint16_t idleFrequency, uint16_t fingerFrequency)
 {
   bool failed = false;
@@ -414,8 +1047,8 @@ bool Zforce::Frequency(uint16_t idleFrequency, uint16_t fingerFrequency)
 
   // Each value that is >127 gets an extra byte.
 
-  uint8_t fingerFrequencyValue[2];
-  uint8_t idleFrequencyValue[2];
+  uint8_t fingerFrequencyValue[2] = {0, 0};
+  uint8_t idleFrequencyValue[2] = {0, 0};
 
   uint8_t fingerFrequencyLength = SerializeInt(fingerFrequency, fingerFrequencyValue);
   uint8_t idleFrequencyLength = SerializeInt(idleFrequency, idleFrequencyValue);
@@ -465,26 +1098,43 @@ bool Zforce::Frequency(uint16_t idleFrequency, uint16_t fingerFrequency)
   }
   else
   {
-    lastSentMessage = MessageType::FREQUENCYTYPE;
+    AddPendingRequest(MessageType::FREQUENCYTYPE);
+  }
+
+  return !failed;
+}
+
+bool Zforce::GetFrequency()
+{
+  bool failed = false;
+  if (WriteCommand(getFrequencyCommand, sizeof(getFrequencyCommand), nullptr, 0)) // We assume that the end user has called GetMessage prior to calling this method
+  {
+    failed = true;
+  }
+  else
+  {
+    AddPendingRequest(MessageType::FREQUENCYTYPE);
   }
 
   return !failed;
 }
+#endif
 
 
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
 bool Zforce::FlipXY(bool isFlipped)
 {
   bool failed = false;
 
-  uint8_t flipXY[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x86, 0x01, (uint8_t)(isFlipped ? 0xFF : 0x00)};
+  CommandPatch patches[] = {{AXIS_SETTING_IDENTIFIER_SLOT, 0x86}, {AXIS_SETTING_VALUE_SLOT, (uint8_t)(isFlipped ? 0xFF : 0x00)}};
 
-  if (Write(flipXY)) // We assume that the end user has called GetMessage prior to calling this method
+  if (WriteCommand(axisSettingCommand, sizeof(axisSettingCommand), patches, 2)) // We assume that the end user has called GetMessage prior to calling this method
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::FLIPXYTYPE;
+    AddPendingRequest(MessageType::FLIPXYTYPE);
   }
 
   return !failed;
@@ -494,15 +1144,15 @@ bool Zforce::ReverseX(bool isReversed)
 {
   bool failed = false;
 
-  uint8_t reverseX[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x84, 0x01, (uint8_t)(isReversed ? 0xFF : 0x00)};
+  CommandPatch patches[] = {{AXIS_SETTING_IDENTIFIER_SLOT, 0x84}, {AXIS_SETTING_VALUE_SLOT, (uint8_t)(isReversed ? 0xFF : 0x00)}};
 
-  if (Write(reverseX)) // We assume that the end user has called GetMessage prior to calling this method
+  if (WriteCommand(axisSettingCommand, sizeof(axisSettingCommand), patches, 2)) // We assume that the end user has called GetMessage prior to calling this method
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::REVERSEXTYPE;
+    AddPendingRequest(MessageType::REVERSEXTYPE);
   }
 
   return !failed;
@@ -512,38 +1162,40 @@ bool Zforce::ReverseY(bool isReversed)
 {
   bool failed = false;
 
-  uint8_t reverseY[] = {0xEE, 0x0D, 0xEE, 0x0B, 0x40, 0x02, 0x02, 0x00, 0x73, 0x05, 0xA2, 0x03, 0x85, 0x01, (uint8_t)(isReversed ? 0xFF : 0x00)};
+  CommandPatch patches[] = {{AXIS_SETTING_IDENTIFIER_SLOT, 0x85}, {AXIS_SETTING_VALUE_SLOT, (uint8_t)(isReversed ? 0xFF : 0x00)}};
 
-  if (Write(reverseY)) // We assume that the end user has called GetMessage prior to calling this method
+  if (WriteCommand(axisSettingCommand, sizeof(axisSettingCommand), patches, 2)) // We assume that the end user has called GetMessage prior to calling this method
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::REVERSEYTYPE;
+    AddPendingRequest(MessageType::REVERSEYTYPE);
   }
 
   return !failed;
 }
+#endif
 
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
 bool Zforce::ReportedTouches(uint8_t touches)
 {
   bool failed = false;
 
-  if(touches > 10)
+  if(touches > ZFORCE_MAX_TOUCHES)
   {
-    touches = 10;
+    touches = ZFORCE_MAX_TOUCHES;
   }
 
-  uint8_t reportedTouches[] = {0xEE, 0x0B, 0xEE, 0x09, 0x40, 0x02, 0x02, 0x00, 0x73, 0x03, 0x86, 0x01, touches};
+  CommandPatch patch = {REPORTED_TOUCHES_SLOT, touches};
 
-  if (Write(reportedTouches)) // We assume that the end user has called GetMessage prior to calling this method
+  if (WriteCommand(reportedTouchesCommand, sizeof(reportedTouchesCommand), &patch, 1)) // We assume that the end user has called GetMessage prior to calling this method
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::REPORTEDTOUCHESTYPE;
+    AddPendingRequest(MessageType::REPORTEDTOUCHESTYPE);
   }
 
   return !failed;
@@ -556,59 +1208,59 @@ bool Zforce::DetectionMode(bool mergeTouches, bool reflectiveEdgeFilter)
   uint8_t detectionModeValue = 0x00;
   detectionModeValue |= mergeTouches ? 0x20 : 0x00; // 0x20 as defined in the ASN.1 protocol
   detectionModeValue |= reflectiveEdgeFilter ? 0x80 : 0x00; // 0x80 as defined in the ASN.1 protocol
-  uint8_t detectionMode[] = {0xEE, 0x0C, 0xEE, 0x0A, 0x40, 0x02, 0x02, 0x00, 0x73, 0x04, 0x85, 0x02, 0x00, detectionModeValue};
+  CommandPatch patch = {DETECTION_MODE_SLOT, detectionModeValue};
 
-  if (Write(detectionMode)) // We assume that the end user has called GetMessage prior to calling this method
+  if (WriteCommand(detectionModeCommand, sizeof(detectionModeCommand), &patch, 1)) // We assume that the end user has called GetMessage prior to calling this method
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::DETECTIONMODETYPE;
+    AddPendingRequest(MessageType::DETECTIONMODETYPE);
   }
 
   return !failed;
 }
+#endif
 
 bool Zforce::TouchFormat()
 {
   bool failed = false;
-  uint8_t touchFormat[] = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x02, 0x00, 0x66, 0x00};
-
-  if (Write(touchFormat))
+  if (WriteCommand(touchFormatCommand, sizeof(touchFormatCommand), nullptr, 0))
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::TOUCHFORMATTYPE;
+    AddPendingRequest(MessageType::TOUCHFORMATTYPE);
   }
 
   return !failed;
 }
 
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
 bool Zforce::GetPlatformInformation()
 {
   bool failed = false;
-  uint8_t platformInformation[] = {0xEE, 0x08, 0xEE, 0x06, 0x40, 0x02, 0x00, 0x00, 0x6C, 0x00};
-
-  if (Write(platformInformation))
+  if (WriteCommand(platformInformationCommand, sizeof(platformInformationCommand), nullptr, 0))
   {
     failed = true;
   }
   else
   {
-    lastSentMessage = MessageType::PLATFORMINFORMATIONTYPE;
+    AddPendingRequest(MessageType::PLATFORMINFORMATIONTYPE);
   }
 
   return !failed;
 }
+#endif
 
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
 bool Zforce::TouchMode(uint8_t mode, int16_t clickOnTouchRadius, int16_t clickOnTouchTime)
 {
   bool failed = false;
-  uint8_t serializedTime[2];
-  uint8_t serializedRadius[2];
+  uint8_t serializedTime[2] = {0, 0};
+  uint8_t serializedRadius[2] = {0, 0};
     
   uint8_t timeLength = SerializeInt(clickOnTouchTime, serializedTime);
   uint8_t radiusLength = SerializeInt(clickOnTouchRadius, serializedRadius);
@@ -638,7 +1290,7 @@ bool Zforce::TouchMode(uint8_t mode, int16_t clickOnTouchRadius, int16_t clickOn
   }
   else
   {
-    lastSentMessage = MessageType::TOUCHMODETYPE;
+    AddPendingRequest(MessageType::TOUCHMODETYPE);
   }
 
   return !failed;
@@ -647,7 +1299,7 @@ bool Zforce::TouchMode(uint8_t mode, int16_t clickOnTouchRadius, int16_t clickOn
 bool Zforce::FloatingProtection(bool enabled, uint16_t time)
 {
   bool failed = false;
-  uint8_t serializedTime[2];
+  uint8_t serializedTime[2] = {0, 0};
   uint8_t timeLength = SerializeInt(time, serializedTime);
   uint8_t floatingProtection[17 + timeLength] = {0xEE, (uint8_t)(15 + timeLength), 0xEE, (uint8_t)(13 + timeLength), 0x40, 0x02, 0x02, 0x00, 0x73,
                                   (uint8_t)(7 + timeLength), 0xA8, (uint8_t)(5 + timeLength), 0x80, 0x01, (uint8_t)(enabled ? 0xFF : 0x00), 0x81,
@@ -664,11 +1316,12 @@ bool Zforce::FloatingProtection(bool enabled, uint16_t time)
   }
   else
   {
-    lastSentMessage = MessageType::FLOATINGPROTECTIONTYPE;
+    AddPendingRequest(MessageType::FLOATINGPROTECTIONTYPE);
   }
 
   return !failed;
 }
+#endif
 
 int Zforce::GetDataReady()
 {
@@ -690,12 +1343,372 @@ Message* Zforce::GetMessage()
   return msg;
 }
 
+#if ZFORCE_FEATURE_LOW_POWER
+static void DataReadyInterrupt()
+{
+  if (!dataReadyEdge)
+  {
+    dataReadyEdgeTime = micros();
+    dataReadyEdge = true;
+  }
+}
+
+// Stops the CPU until the next interrupt. Called with interrupts disabled, so that
+// an edge arriving after data ready was checked still wakes the CPU.
+static void SleepCpu()
+{
+#if defined(__AVR__)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  interrupts(); // Takes effect after the next instruction, so nothing can run in between.
+  sleep_cpu();
+  sleep_disable();
+#elif defined(__arm__)
+  __asm__ volatile ("wfi"); // Wakes on a pending interrupt even while they are disabled.
+  interrupts();
+#else
+  interrupts();
+  yield();
+#endif
+}
+
+/*
+ * Puts the MCU to sleep until data ready goes HIGH, then reads and parses the
+ * message like GetMessage. On Atmel platforms the idle sleep mode is used, which
+ * keeps timers and the i2c peripheral running, and on ARM platforms the CPU waits
+ * for an interrupt. Other platforms, and data ready pins without an external
+ * interrupt, fall back to calling yield() while waiting.
+ *
+ * timeout        Milliseconds to wait for data ready. 0 means wait forever.
+ *
+ * Return value   A pointer to a Message, or nullptr if the read failed or timed out.
+ */
+Message* Zforce::SleepUntilMessage(uint32_t timeout)
+{
+  if (!dataReadyInterruptAttached)
+  {
+    int interrupt = digitalPinToInterrupt(dataReady);
+#ifdef NOT_AN_INTERRUPT
+    if (interrupt != NOT_AN_INTERRUPT)
+#endif
+    {
+      attachInterrupt(interrupt, DataReadyInterrupt, RISING);
+      dataReadyInterruptAttached = true;
+    }
+  }
+
+  uint32_t startTime = millis();
+  uint32_t waitStart = micros();
+  bool ready = false;
+  while (!ready)
+  {
+    if ((timeout != 0) && ((uint32_t)(millis() - startTime) >= timeout))
+    {
+      lowPowerStatistics.waitTime += micros() - waitStart;
+      return nullptr;
+    }
+
+    noInterrupts();
+    ready = dataReadyEdge || (GetDataReady() == HIGH);
+    if (ready)
+    {
+      interrupts();
+    }
+    else if (dataReadyInterruptAttached)
+    {
+      lowPowerStatistics.sleeps++;
+      SleepCpu();
+    }
+    else
+    {
+      interrupts();
+      yield();
+    }
+  }
+  lowPowerStatistics.waitTime += micros() - waitStart;
+
+  // A message that was already waiting has no edge, so its latency is unknown.
+  noInterrupts();
+  bool edge = dataReadyEdge;
+  uint32_t edgeTime = dataReadyEdgeTime;
+  dataReadyEdge = false;
+  interrupts();
+
+  Message* msg = GetMessage();
+
+  if (edge)
+  {
+    lowPowerStatistics.wakeups++;
+    if (msg != nullptr)
+    {
+      uint32_t latency = micros() - edgeTime;
+      lowPowerStatistics.messages++;
+      lowPowerStatistics.latencyTotal += latency;
+      if (latency > lowPowerStatistics.latencyMax)
+      {
+        lowPowerStatistics.latencyMax = latency;
+      }
+    }
+  }
+
+  return msg;
+}
+
+LowPowerStatistics Zforce::GetLowPowerStatistics()
+{
+  return lowPowerStatistics;
+}
+
+void Zforce::ResetLowPowerStatistics()
+{
+  memset(&lowPowerStatistics, 0, sizeof(lowPowerStatistics));
+}
+#endif
+
+/*
+ * Reads and parses messages for as long as the data ready signal stays high.
+ *
+ * messages       Array where pointers to the received messages are stored.
+ * maxMessages    Maximum number of frames to read, and the size of messages.
+ * timeBudget     Stop reading once this many microseconds have passed. 0 means no time limit.
+ *
+ * Return value   The number of messages stored in messages. Each one must be destroyed with DestroyMessage.
+ */
+uint8_t Zforce::GetMessages(Message** messages, uint8_t maxMessages, uint32_t timeBudget)
+{
+  uint8_t count = 0;
+  uint32_t startTime = micros();
+
+  for (uint8_t frames = 0; (frames < maxMessages) && (GetDataReady() == HIGH); frames++)
+  {
+    if ((timeBudget != 0) && ((uint32_t)(micros() - startTime) >= timeBudget))
+    {
+      break;
+    }
+
+    if (Read(buffer))
+    {
+      break;
+    }
+
+    Message* msg = VirtualParse(buffer);
+    ClearBuffer(buffer);
+    if (msg != nullptr)
+    {
+      messages[count++] = msg;
+    }
+  }
+
+  return count;
+}
+
+/*
+ * Reads a message like GetMessage, but a touch notification is decoded straight
+ * into frame without allocating any memory.
+ *
+ * frame          Where the touches are stored.
+ * msg            Where any other message is stored, or nullptr if other messages
+ *                should be discarded. Set to nullptr if there is no other message.
+ *
+ * Return value   true if a touch notification was read into frame.
+ */
+bool Zforce::GetTouchFrame(TouchFrame* frame, Message** msg)
+{
+  bool isTouch = false;
+  Message* other = nullptr;
+
+  if ((GetDataReady() == HIGH) && !Read(buffer))
+  {
+    isTouch = ParseTouchFrame(buffer, frame, &other);
+    ClearBuffer(buffer);
+  }
+
+  if (msg != nullptr)
+  {
+    *msg = other;
+  }
+  else
+  {
+    DestroyMessage(other);
+  }
+
+  return isTouch;
+}
+
+/*
+ * Parses a message that was received with Read(), or obtained in some other way,
+ * e.g. recorded or generated. The payload starts with the i2c header.
+ */
+Message* Zforce::ParseMessage(uint8_t* payload)
+{
+  return VirtualParse(payload);
+}
+
+/*
+ * Same as ParseMessage, but a touch notification is decoded into frame like GetTouchFrame does.
+ * Any other message is stored in msg, which is set to nullptr for touch notifications.
+ */
+bool Zforce::ParseTouchFrame(uint8_t* payload, TouchFrame* frame, Message** msg)
+{
+  *msg = nullptr;
+  if ((payload[2] == 0xF0) && (payload[8] == 0xA0) && this->touchDescriptorInitialized)
+  {
+    DecodeTouchFrame(frame, payload);
+    return true;
+  }
+
+  *msg = VirtualParse(payload);
+  return false;
+}
+
+#define TOUCH_PAYLOAD_OFFSET 12 // Index of the first touch in a touch notification
+
+/*
+ * Reads a message like GetTouchFrame, but a touch notification is left in the
+ * receive buffer and only referenced by view, which decodes its touches while
+ * iterating. The view is valid until the next read from the sensor.
+ *
+ * Return value   true if a touch notification was read into view.
+ */
+bool Zforce::GetTouchFrameView(TouchFrameView* view, Message** msg)
+{
+  bool isTouch = false;
+  Message* other = nullptr;
+
+  if ((GetDataReady() == HIGH) && !Read(buffer))
+  {
+    isTouch = ParseTouchFrameView(buffer, view, &other);
+    if (!isTouch)
+    {
+      ClearBuffer(buffer);
+    }
+  }
+
+  if (msg != nullptr)
+  {
+    *msg = other;
+  }
+  else
+  {
+    DestroyMessage(other);
+  }
+
+  return isTouch;
+}
+
+/*
+ * Same as ParseTouchFrame, but a touch notification is referenced by view instead
+ * of being decoded. payload must stay unchanged for as long as view is used.
+ */
+bool Zforce::ParseTouchFrameView(uint8_t* payload, TouchFrameView* view, Message** msg)
+{
+  *msg = nullptr;
+  if ((payload[2] == 0xF0) && (payload[8] == 0xA0) && this->touchDescriptorInitialized)
+  {
+    uint8_t touchCount = ParseTouchCount(payload);
+    view->zforce = this;
+    view->touches = &payload[TOUCH_PAYLOAD_OFFSET];
+    view->touchCount = touchCount;
+    view->touchLength = touchMetaInformation.touchByteCount + 2;
+    view->timestamp = ParseTouchTimestamp(payload, touchCount);
+    return true;
+  }
+
+  *msg = VirtualParse(payload);
+  return false;
+}
+
+TouchFrameView::TouchFrameView()
+{
+  timestamp = 0;
+  zforce = nullptr;
+  touches = nullptr;
+  touchCount = 0;
+  touchLength = 0;
+}
+
+TouchFrameView::Iterator TouchFrameView::begin() const
+{
+  return Iterator(this, 0);
+}
+
+TouchFrameView::Iterator TouchFrameView::end() const
+{
+  return Iterator(this, touchCount);
+}
+
+uint8_t TouchFrameView::Count() const
+{
+  return touchCount;
+}
+
+TouchFrameView::Iterator::Iterator(const TouchFrameView* view, uint8_t index)
+{
+  this->view = view;
+  this->index = index;
+  Seek();
+}
+
+TouchFrameView::Iterator& TouchFrameView::Iterator::operator++()
+{
+  index++;
+  Seek();
+  return *this;
+}
+
+// Decodes the touch at index, or moves on to the next touch that passes the touch filter.
+void TouchFrameView::Iterator::Seek()
+{
+  while ((index < view->touchCount) &&
+         !view->zforce->DecodeAcceptedTouch(&view->touches[index * view->touchLength], &touch))
+  {
+    index++;
+  }
+}
+
 void Zforce::DestroyMessage(Message* msg)
 {
   delete msg;
   msg = nullptr;
 }
 
+/*
+ * Copies the touches of a touch message into a TouchFrame, one array per field.
+ * Touches beyond ZFORCE_MAX_TOUCHES are dropped.
+ */
+static void StoreFrameTouch(TouchFrame* frame, uint8_t index, const TouchData* touch)
+{
+  frame->x[index] = touch->x;
+  frame->y[index] = touch->y;
+  frame->sizeX[index] = touch->sizeX;
+  frame->id[index] = touch->id;
+  frame->event[index] = touch->event;
+#if ZFORCE_EXTENDED_TOUCH_DATA
+  frame->z[index] = touch->z;
+  frame->sizeY[index] = touch->sizeY;
+  frame->sizeZ[index] = touch->sizeZ;
+  frame->orientation[index] = touch->orientation;
+  frame->confidence[index] = touch->confidence;
+  frame->pressure[index] = touch->pressure;
+#endif
+}
+
+void Zforce::CopyTouchFrame(TouchMessage* msg, TouchFrame* frame)
+{
+  uint8_t count = msg->touchCount;
+  if (count > ZFORCE_MAX_TOUCHES)
+  {
+    count = ZFORCE_MAX_TOUCHES;
+  }
+
+  frame->timestamp = msg->timestamp;
+  frame->touchCount = count;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    StoreFrameTouch(frame, i, &msg->touchData[i]);
+  }
+}
+
 Message* Zforce::VirtualParse(uint8_t* payload)
 {
   Message* msg = nullptr;
@@ -730,14 +1743,14 @@ Message* Zforce::VirtualParse(uint8_t* payload)
     break;
   }
 
-  lastSentMessage = MessageType::NONE;
   return msg;
 }
 
 void Zforce::ParseResponse(uint8_t* payload, Message** msg)
 {
-  switch(lastSentMessage)
+  switch(ClassifyResponse(payload))
   {
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
     case MessageType::REVERSEYTYPE:
     {
       (*(msg)) = new ReverseYMessage;
@@ -745,6 +1758,7 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseReverseY((ReverseYMessage*)(*(msg)), payload);
     }
     break;
+#endif
     case MessageType::ENABLETYPE:
     {
       (*(msg)) = new EnableMessage;
@@ -752,6 +1766,7 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseEnable((EnableMessage*)(*(msg)), payload);
     }
     break;
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
     case MessageType::TOUCHACTIVEAREATYPE:
     {
       (*(msg)) = new TouchActiveAreaMessage;
@@ -773,6 +1788,8 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseFlipXY((FlipXYMessage*)(*(msg)), payload);
     }
     break;
+#endif
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
     case MessageType::REPORTEDTOUCHESTYPE:
     {
       (*(msg)) = new ReportedTouchesMessage;
@@ -794,6 +1811,7 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseDetectionMode((DetectionModeMessage*)(*(msg)), payload);
     }
     break;
+#endif
     case MessageType::TOUCHFORMATTYPE:
     {
       (*(msg)) = new TouchDescriptorMessage;
@@ -801,6 +1819,7 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseTouchDescriptor((TouchDescriptorMessage*)(*(msg)), payload);
     }
     break;
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
     case MessageType::TOUCHMODETYPE:
     {
       (*(msg)) = new TouchModeMessage;
@@ -815,6 +1834,8 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParseFloatingProtection((FloatingProtectionMessage *)(*(msg)), payload);
     }
     break;
+#endif
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
     case MessageType::PLATFORMINFORMATIONTYPE:
     {
       (*(msg)) = new PlatformInformationMessage;
@@ -822,13 +1843,158 @@ void Zforce::ParseResponse(uint8_t* payload, Message** msg)
       ParsePlatformInformation((PlatformInformationMessage*)(*(msg)), &payload[2], payload[1] - 1);
     }
     break;
+#endif
+    case MessageType::OPERATIONMODETYPE:
+    {
+      (*(msg)) = new Message;
+      (*(msg))->type = MessageType::OPERATIONMODETYPE;
+    }
+    break;
+    default:
+    {
+      (*(msg)) = new Message;
+      (*(msg))->type = MessageType::NONE;
+    }
+    break;
+  }
+}
+
+static void AddCandidate(MessageType type, uint16_t* candidates, MessageType* first)
+{
+  if (*candidates == 0)
+  {
+    *first = type;
+  }
+  *candidates |= (1 << (uint8_t)type);
+}
+
+/*
+ * Works out which request a response belongs to from its application tag and,
+ * for device configuration responses, from the tags of the settings it contains.
+ * If the response could belong to several requests, the oldest pending one is chosen.
+ */
+MessageType Zforce::ClassifyResponse(uint8_t* payload)
+{
+  uint16_t candidates = 0;
+  MessageType first = MessageType::NONE;
+  const uint16_t end = payload[1] + 2;
+  uint16_t index = 3 + GetNumLengthBytes(&payload[3]) + 4; // Skip response identifier, ASN.1 length and address.
+
+  switch (payload[index])
+  {
+    case 0x65:
+      AddCandidate(MessageType::ENABLETYPE, &candidates, &first);
+    break;
+    case 0x66:
+      AddCandidate(MessageType::TOUCHFORMATTYPE, &candidates, &first);
+    break;
+    case 0x67:
+      AddCandidate(MessageType::OPERATIONMODETYPE, &candidates, &first);
+    break;
+    case 0x68:
+      AddCandidate(MessageType::FREQUENCYTYPE, &candidates, &first);
+    break;
+    case 0x6C:
+      AddCandidate(MessageType::PLATFORMINFORMATIONTYPE, &candidates, &first);
+    break;
+    case 0x7F: // Two byte application tag
+      if (payload[index + 1] == 0x24)
+      {
+        AddCandidate(MessageType::TOUCHMODETYPE, &candidates, &first);
+      }
+    break;
+    case 0x73: // Device configuration
+    {
+      index++;
+      index += GetNumLengthBytes(&payload[index]);
+      while (index + 1 < end)
+      {
+        uint8_t length = payload[index + 1];
+        switch (payload[index])
+        {
+          case 0xA2: // Sub touch active area
+          {
+            for (uint16_t i = index + 2; (i < index + 2 + length) && (i < end); i += payload[i + 1] + 2)
+            {
+              switch (payload[i])
+              {
+                case 0x80:
+                case 0x81:
+                case 0x82:
+                case 0x83:
+                  AddCandidate(MessageType::TOUCHACTIVEAREATYPE, &candidates, &first);
+                break;
+                case 0x84:
+                  AddCandidate(MessageType::REVERSEXTYPE, &candidates, &first);
+                break;
+                case 0x85:
+                  AddCandidate(MessageType::REVERSEYTYPE, &candidates, &first);
+                break;
+                case 0x86:
+                  AddCandidate(MessageType::FLIPXYTYPE, &candidates, &first);
+                break;
+                default:
+                break;
+              }
+            }
+          }
+          break;
+          case 0x85:
+            AddCandidate(MessageType::DETECTIONMODETYPE, &candidates, &first);
+          break;
+          case 0x86:
+            AddCandidate(MessageType::REPORTEDTOUCHESTYPE, &candidates, &first);
+          break;
+          case 0xA8:
+            AddCandidate(MessageType::FLOATINGPROTECTIONTYPE, &candidates, &first);
+          break;
+          default:
+          break;
+        }
+        index += length + 2;
+      }
+    }
+    break;
     default:
+    break;
+  }
+
+  return TakePendingRequest(candidates, first);
+}
+
+/*
+ * Remembers a request that has been sent, so its response can be told apart
+ * from the responses to other outstanding requests. When the queue is full the
+ * oldest request is assumed to be lost.
+ */
+void Zforce::AddPendingRequest(MessageType type)
+{
+  if (pendingRequestCount == ZFORCE_MAX_PENDING_REQUESTS)
+  {
+    memmove(&pendingRequests[0], &pendingRequests[1], (ZFORCE_MAX_PENDING_REQUESTS - 1) * sizeof(MessageType));
+    pendingRequestCount--;
+  }
+  pendingRequests[pendingRequestCount++] = type;
+}
+
+/*
+ * Removes and returns the oldest pending request that is one of candidates.
+ * If none of them is pending, fallback is returned.
+ */
+MessageType Zforce::TakePendingRequest(uint16_t candidates, MessageType fallback)
+{
+  for (uint8_t i = 0; i < pendingRequestCount; i++)
+  {
+    MessageType type = pendingRequests[i];
+    if (candidates & (1 << (uint8_t)type))
     {
-      (*(msg)) = new Message;
-      (*(msg))->type = MessageType::NONE;
+      pendingRequestCount--;
+      memmove(&pendingRequests[i], &pendingRequests[i + 1], (pendingRequestCount - i) * sizeof(MessageType));
+      return type;
     }
-    break;
   }
+
+  return fallback;
 }
 
 void Zforce::ParseTouchDescriptor(TouchDescriptorMessage* msg, uint8_t* payload)
@@ -852,14 +2018,18 @@ void Zforce::ParseTouchDescriptor(TouchDescriptorMessage* msg, uint8_t* payload)
     bitIndex++;
   }
 
+  delete[] touchMetaInformation.touchDescriptor;
   touchMetaInformation.touchDescriptor = new TouchDescriptor[descIndex];
   touchMetaInformation.touchByteCount = descIndex;
   for (int i = 0; i < touchMetaInformation.touchByteCount; i++)
   {
     touchMetaInformation.touchDescriptor[i] = msg->descriptor[i];
   }
+  UpdateTouchDecoder();
+  touchDescriptorInitialized = true;
 }
 
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
 void Zforce::ParsePlatformInformation(PlatformInformationMessage *msg, uint8_t *rawData, uint32_t length)
 {
   (void)length;
@@ -938,7 +2108,9 @@ void Zforce::ParsePlatformInformation(PlatformInformationMessage *msg, uint8_t *
     }
   }
 }
+#endif
 
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
 void Zforce::ParseTouchMode(TouchModeMessage* msg, uint8_t* payload)
 {
   const uint8_t offset = 9;
@@ -1029,7 +2201,9 @@ void Zforce::ParseFrequency(FrequencyMessage* msg, uint8_t* payload)
         }
     }
 }
+#endif
 
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
 void Zforce::ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload)
 {
   const uint8_t offset = 10;
@@ -1101,300 +2275,650 @@ void Zforce::ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload)
     }
   }
 }
+#endif
+
+void Zforce::ParseEnable(EnableMessage* msg, uint8_t* payload)
+{
+  switch (payload[10])
+  {
+    case 0x80:
+      msg->enabled = false;
+    break;
+
+    case 0x81:
+      msg->enabled = true;
+    break;
+
+    default:
+    break;
+  }
+}
+
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
+void Zforce::ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload)
+{
+  const uint8_t offset = 10;
+  for(int i = offset + payload[11]; i < payload[9] + offset; i++)
+  {
+    if(payload[i] == 0x86)
+    {
+      msg->reportedTouches = payload[i + 2];
+      break;
+    }
+  }
+}
+
+void Zforce::ParseFloatingProtection(FloatingProtectionMessage* msg, uint8_t* payload)
+{
+  const uint8_t offset = 10;
+  uint8_t valueLength = 0;
+  msg->time = 0;
+
+  for(int i = offset + payload[11]; i < payload[9] + offset; i++)
+  {
+    if (payload[i] == 0xA8) // Identifier floating protection
+    {
+      for (int j = 0; j < payload[i + 1]; j++)
+      {
+        if (payload[i + j] == 0x80) // Identifier floating protection enabled
+        {
+          msg->enabled = (bool)payload[i + j + 2];
+        }
+        if (payload[i + j] == 0x81) // Identifier for time
+        {
+          valueLength = payload[i + j + 1];
+          if (valueLength == 2)
+          {
+            msg->time = payload[i + j + 2] << 8;
+            msg->time |= payload[i + j + 3];
+          }
+          else
+          {
+            msg->time = payload[i + j + 2];
+          }
+          break;
+        }
+      }
+    }
+  }
+}
+#endif
+
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
+void Zforce::ParseReverseX(ReverseXMessage* msg, uint8_t* payload)
+{
+  const uint8_t offset = 10;
+  for(int i = offset; i < payload[11] + offset; i++)
+  {
+    if(payload[i] == 0x84)
+    {
+      msg->reversed = (bool)payload[i + 2];
+      break;
+    }
+  }
+}
+
+void Zforce::ParseReverseY(ReverseYMessage* msg, uint8_t* payload)
+{
+  const uint8_t offset = 10;
+  for(int i = offset; i < payload[11] + offset; i++)
+  {
+    if(payload[i] == 0x85)
+    {
+      msg->reversed = (bool)payload[i + 2];
+      break;
+    }
+  }
+}
+
+void Zforce::ParseFlipXY(FlipXYMessage* msg, uint8_t* payload)
+{
+  const uint8_t offset = 10;
+  for(int i = offset; i < payload[11] + offset; i++)
+  {
+    if(payload[i] == 0x86)
+    {
+      msg->flipXY = (bool)payload[i + 2];
+      break;
+    }
+  }
+}
+#endif
+
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
+void Zforce::ParseDetectionMode(DetectionModeMessage* msg, uint8_t* payload)
+{
+  uint8_t offset = payload[11] + 11; // 11 = Index for TouchActiveArea length
+  offset += payload[offset + 2]; // Add the length of the following Sequence to the offset
+  const uint8_t length = payload[1] + 2;
+
+  for (int i = offset; i < length; i++)
+  {
+    if (payload[i] == 0x85) // Primitive type = 0x60, context specific = 0x20, tag id = 0x05 => 0x85
+    {
+      // We found it
+      uint8_t valueLength = payload[i + 1];
+      msg->mergeTouches = (payload[i + valueLength + 1] & 0x20) != 0; 
+      msg->reflectiveEdgeFilter = (payload[i + valueLength + 1] & 0x80) != 0;
+      break;
+    }
+    else
+    {
+      // Keep looking 
+      i += payload[i + 1] + 1;
+    }
+  }
+}
+#endif
+
+void Zforce::ParseTouch(TouchMessage* msg, uint8_t* payload)
+{
+  if (touchMetaInformation.touchDescriptor == nullptr)
+  {
+    return;
+  }
+
+  const uint8_t expectedTouchLength = touchMetaInformation.touchByteCount + 2;
+  msg->touchCount = ParseTouchCount(payload);
+  msg->touchData = new TouchData[msg->touchCount];
+  msg->timestamp = ParseTouchTimestamp(payload, msg->touchCount);
+
+  uint8_t accepted = 0;
+  for (uint8_t i = 0; i < msg->touchCount; i++)
+  {
+    if (DecodeAcceptedTouch(&payload[TOUCH_PAYLOAD_OFFSET + (i * expectedTouchLength)], &msg->touchData[accepted]))
+    {
+      accepted++;
+    }
+  }
+  msg->touchCount = accepted;
+}
+
+/*
+ * Same as ParseTouch, but stores the touches in a TouchFrame instead of allocating them.
+ */
+void Zforce::DecodeTouchFrame(TouchFrame* frame, uint8_t* payload)
+{
+  const uint8_t expectedTouchLength = touchMetaInformation.touchByteCount + 2;
+  uint8_t touchCount = ParseTouchCount(payload);
+  frame->timestamp = ParseTouchTimestamp(payload, touchCount);
+
+  uint8_t accepted = 0;
+  for (uint8_t i = 0; (i < touchCount) && (accepted < ZFORCE_MAX_TOUCHES); i++)
+  {
+    TouchData touch;
+    if (DecodeAcceptedTouch(&payload[TOUCH_PAYLOAD_OFFSET + (i * expectedTouchLength)], &touch))
+    {
+      StoreFrameTouch(frame, accepted++, &touch);
+    }
+  }
+  frame->touchCount = accepted;
+}
+
+/*
+ * Decodes a touch if it passes the touch filter. Id and event are checked on the
+ * raw bytes, so touches rejected by them are not decoded at all.
+ *
+ * Return value   true if the touch was decoded into touch and should be kept.
+ */
+bool Zforce::DecodeAcceptedTouch(uint8_t* rawTouch, TouchData* touch)
+{
+#if ZFORCE_FEATURE_TOUCH_FILTER
+  if (!touchFilterEnabled)
+  {
+    DecodeTouch(rawTouch, touch);
+    return true;
+  }
+
+  if (touchMetaInformation.eventIndex != 0xFF)
+  {
+    uint8_t event = rawTouch[touchMetaInformation.eventIndex];
+    if ((event >= 8) || !(touchFilter.eventMask & (1 << event)))
+    {
+      touchFilterStatistics.rejectedEvent++;
+      return false;
+    }
+  }
+
+  if (touchMetaInformation.idIndex != 0xFF)
+  {
+    uint8_t id = rawTouch[touchMetaInformation.idIndex];
+    if ((id < 32) && !(touchFilter.idMask & ((uint32_t)1 << id)))
+    {
+      touchFilterStatistics.rejectedId++;
+      return false;
+    }
+  }
+
+  DecodeTouch(rawTouch, touch);
+
+  // Conditions on fields that the sensor does not report are skipped.
+  uint16_t fields = touchMetaInformation.descriptorFields;
+  if (((fields & TOUCHFIELD_X) && ((touch->x < touchFilter.minX) || (touch->x > touchFilter.maxX))) ||
+      ((fields & TOUCHFIELD_Y) && ((touch->y < touchFilter.minY) || (touch->y > touchFilter.maxY))))
+  {
+    touchFilterStatistics.rejectedArea++;
+    return false;
+  }
+
+  if ((fields & TOUCHFIELD_SIZEX) && ((touch->sizeX < touchFilter.minSizeX) || (touch->sizeX > touchFilter.maxSizeX)))
+  {
+    touchFilterStatistics.rejectedSize++;
+    return false;
+  }
+
+  touchFilterStatistics.accepted++;
+  return true;
+#else
+  DecodeTouch(rawTouch, touch);
+  return true;
+#endif
+}
+
+/*
+ * Number of touches in a touch notification. Touches that would extend past the
+ * end of the message are not counted, so a malformed message is never read beyond its length.
+ */
+uint8_t Zforce::ParseTouchCount(uint8_t* payload)
+{
+  const uint8_t expectedTouchLength = touchMetaInformation.touchByteCount + 2;
+  const uint16_t messageLength = payload[1] + 2;
+  uint8_t touchCount = payload[9] / expectedTouchLength;
+
+  if (messageLength < TOUCH_PAYLOAD_OFFSET - 2)
+  {
+    return 0;
+  }
+  if (touchCount > (messageLength - (TOUCH_PAYLOAD_OFFSET - 2)) / expectedTouchLength)
+  {
+    touchCount = (messageLength - (TOUCH_PAYLOAD_OFFSET - 2)) / expectedTouchLength;
+  }
+
+  return touchCount;
+}
+
+uint32_t Zforce::ParseTouchTimestamp(uint8_t* payload, uint8_t touchCount)
+{
+  const uint8_t expectedTouchLength = touchMetaInformation.touchByteCount + 2;
+  uint32_t timestamp = 0;
+
+  if ((payload[1] + 2) > (TOUCH_PAYLOAD_OFFSET + (expectedTouchLength * touchCount))) // Check for timestamp
+  {
+    uint8_t timestampIndex = TOUCH_PAYLOAD_OFFSET + (expectedTouchLength * touchCount) - 2;
+    if (payload[timestampIndex] == 0x58) // Check for timestamp identifier
+    {
+      uint8_t timestampLength = payload[timestampIndex + 1];
+      if ((timestampLength > 4) || ((timestampIndex + 2 + timestampLength) > (payload[1] + 2)))
+      {
+        return 0;
+      }
+      for (int index = (timestampIndex + 2); index < (timestampIndex + 2 + timestampLength); index++)
+      {
+        timestamp <<= 8;
+        timestamp |= payload[index];
+      }
+    }
+  }
+
+  return timestamp;
+}
+
+/*
+ * Decodes the bytes of one touch according to any touch descriptor. Only the
+ * bytes of the fields selected with SetTouchFieldMask() are decoded, and all
+ * other fields are 0.
+ */
+static void DecodeTouchGeneric(const TouchMetaInformation* meta, uint8_t* rawTouch, TouchData* touch)
+{
+  memset(touch, 0, sizeof(TouchData));
+  uint32_t byteMask = 1;
+  for (uint8_t j = 0; j < meta->touchByteCount; j++, byteMask <<= 1)
+  {
+    if (!(meta->decodedBytes & byteMask))
+    {
+      continue;
+    }
+
+    switch (meta->touchDescriptor[j])
+    {
+      case TouchDescriptor::Id:
+      {
+        touch->id = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::Event:
+      {
+        touch->event = (TouchEvent)rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::LocXByte1:
+      {
+        touch->x = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::LocXByte2:
+      case TouchDescriptor::LocXByte3:
+      {
+        touch->x <<= 8;
+        touch->x |= rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::LocYByte1:
+      {
+        touch->y = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::LocYByte2:
+      case TouchDescriptor::LocYByte3:
+      {
+        touch->y <<= 8;
+        touch->y |= rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeXByte1:
+      {
+        touch->sizeX = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeXByte2:
+      case TouchDescriptor::SizeXByte3:
+      {
+        touch->sizeX <<= 8;
+        touch->sizeX |= rawTouch[j];
+        break;
+      }
+#if ZFORCE_EXTENDED_TOUCH_DATA
+      case TouchDescriptor::LocZByte1:
+      {
+        touch->z = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::LocZByte2:
+      case TouchDescriptor::LocZByte3:
+      {
+        touch->z <<= 8;
+        touch->z |= rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeYByte1:
+      {
+        touch->sizeY = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeYByte2:
+      case TouchDescriptor::SizeYByte3:
+      {
+        touch->sizeY <<= 8;
+        touch->sizeY |= rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeZByte1:
+      {
+        touch->sizeZ = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::SizeZByte2:
+      case TouchDescriptor::SizeZByte3:
+      {
+        touch->sizeZ <<= 8;
+        touch->sizeZ |= rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::Orientation:
+      {
+        touch->orientation = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::Confidence:
+      {
+        // Neonode AIR Touch sensors always report 100%
+        touch->confidence = rawTouch[j];
+        break;
+      }
+      case TouchDescriptor::Pressure:
+      {
+        touch->pressure = rawTouch[j];
+        break;
+      }
+#endif
+      default:
+      // Z, SizeY, SizeZ, Orientation, Confidence and Pressure need ZFORCE_EXTENDED_TOUCH_DATA.
+      // They are not supported by Neonode AIR Touch sensors.
+      break;
+    }
+  }
+}
 
-void Zforce::ParseEnable(EnableMessage* msg, uint8_t* payload)
+#if ZFORCE_FAST_TOUCH_DECODERS
+template <uint8_t bytes>
+static inline uint32_t ReadBigEndian(const uint8_t* data)
 {
-  switch (payload[10])
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < bytes; i++)
   {
-    case 0x80:
-      msg->enabled = false;
-    break;
-
-    case 0x81:
-      msg->enabled = true;
-    break;
-
-    default:
-    break;
+    value = (value << 8) | data[i];
   }
+  return value;
 }
 
-void Zforce::ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload)
+/*
+ * Decodes touches laid out as Id, Event, X, Y and optionally SizeX, with the given
+ * number of bytes per value. All offsets are known at compile time, so there are
+ * no loops or branches per field.
+ */
+template <uint8_t xBytes, uint8_t yBytes, uint8_t sizeBytes>
+static void DecodeTouchFixed(const TouchMetaInformation* meta, uint8_t* rawTouch, TouchData* touch)
 {
-  const uint8_t offset = 10;
-  for(int i = offset + payload[11]; i < payload[9] + offset; i++)
+  (void)meta;
+  touch->id = rawTouch[0];
+  touch->event = (TouchEvent)rawTouch[1];
+  touch->x = (TouchCoordinate)ReadBigEndian<xBytes>(&rawTouch[2]);
+  touch->y = (TouchCoordinate)ReadBigEndian<yBytes>(&rawTouch[2 + xBytes]);
+  // Fields missing from the descriptor are 0, as with the generic decoder.
+  touch->sizeX = (sizeBytes > 0) ? (TouchCoordinate)ReadBigEndian<sizeBytes>(&rawTouch[2 + xBytes + yBytes]) : 0;
+#if ZFORCE_EXTENDED_TOUCH_DATA
+  touch->z = 0;
+  touch->sizeY = 0;
+  touch->sizeZ = 0;
+  touch->orientation = 0;
+  touch->confidence = 0;
+  touch->pressure = 0;
+#endif
+}
+
+typedef struct FastTouchDecoder
+{
+  uint8_t xBytes;
+  uint8_t yBytes;
+  uint8_t sizeBytes;
+  TouchDecodeFunction decode;
+} FastTouchDecoder;
+
+static const FastTouchDecoder fastTouchDecoders[] =
+{
+  {2, 2, 2, DecodeTouchFixed<2, 2, 2>},
+  {2, 2, 1, DecodeTouchFixed<2, 2, 1>},
+  {2, 2, 0, DecodeTouchFixed<2, 2, 0>},
+  {1, 1, 1, DecodeTouchFixed<1, 1, 1>},
+  {1, 1, 0, DecodeTouchFixed<1, 1, 0>}
+};
+
+// Counts the bytes of the value starting with firstByte at *index, and moves *index past them.
+static uint8_t CountValueBytes(const TouchDescriptor* descriptor, uint8_t length, uint8_t* index, TouchDescriptor firstByte)
+{
+  uint8_t count = 0;
+  while ((*index < length) && (count < 3) && (descriptor[*index] == (TouchDescriptor)((uint8_t)firstByte + count)))
   {
-    if(payload[i] == 0x86)
-    {
-      msg->reportedTouches = payload[i + 2];
-      break;
-    }
+    (*index)++;
+    count++;
   }
+  return count;
 }
+#endif
 
-void Zforce::ParseFloatingProtection(FloatingProtectionMessage* msg, uint8_t* payload)
+/*
+ * Picks the decoder for the touch descriptor in meta, a specialized one if the
+ * layout is one of the common ones and the generic one otherwise.
+ */
+static TouchDecodeFunction SelectTouchDecoder(const TouchMetaInformation* meta)
 {
-  const uint8_t offset = 10;
-  uint8_t valueLength = 0;
-  msg->time = 0;
+#if ZFORCE_FAST_TOUCH_DECODERS
+  const TouchDescriptor* descriptor = meta->touchDescriptor;
+  uint8_t length = meta->touchByteCount;
 
-  for(int i = offset + payload[11]; i < payload[9] + offset; i++)
+  if ((length >= 4) && (descriptor[0] == TouchDescriptor::Id) && (descriptor[1] == TouchDescriptor::Event))
   {
-    if (payload[i] == 0xA8) // Identifier floating protection
+    uint8_t index = 2;
+    uint8_t xBytes = CountValueBytes(descriptor, length, &index, TouchDescriptor::LocXByte1);
+    uint8_t yBytes = CountValueBytes(descriptor, length, &index, TouchDescriptor::LocYByte1);
+    uint8_t sizeBytes = CountValueBytes(descriptor, length, &index, TouchDescriptor::SizeXByte1);
+
+    // The specialized decoders decode every byte, so they are only used when all fields are wanted.
+    if ((index == length) && (meta->decodedBytes == ((uint32_t)1 << length) - 1))
     {
-      for (int j = 0; j < payload[i + 1]; j++)
+      for (uint8_t i = 0; i < sizeof(fastTouchDecoders) / sizeof(fastTouchDecoders[0]); i++)
       {
-        if (payload[i + j] == 0x80) // Identifier floating protection enabled
-        {
-          msg->enabled = (bool)payload[i + j + 2];
-        }
-        if (payload[i + j] == 0x81) // Identifier for time
+        if ((fastTouchDecoders[i].xBytes == xBytes) && (fastTouchDecoders[i].yBytes == yBytes) &&
+            (fastTouchDecoders[i].sizeBytes == sizeBytes))
         {
-          valueLength = payload[i + j + 1];
-          if (valueLength == 2)
-          {
-            msg->time = payload[i + j + 2] << 8;
-            msg->time |= payload[i + j + 3];
-          }
-          else
-          {
-            msg->time = payload[i + j + 2];
-          }
-          break;
+          return fastTouchDecoders[i].decode;
         }
       }
     }
   }
+#else
+  (void)meta;
+#endif
+
+  return DecodeTouchGeneric;
 }
 
-void Zforce::ParseReverseX(ReverseXMessage* msg, uint8_t* payload)
+void Zforce::DecodeTouch(uint8_t* rawTouch, TouchData* touch)
 {
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
-  {
-    if(payload[i] == 0x84)
-    {
-      msg->reversed = (bool)payload[i + 2];
-      break;
-    }
-  }
+  touchMetaInformation.decodeTouch(&touchMetaInformation, rawTouch, touch);
 }
 
-void Zforce::ParseReverseY(ReverseYMessage* msg, uint8_t* payload)
+// The TouchField that a byte of the touch descriptor belongs to.
+static uint16_t DescriptorField(TouchDescriptor descriptor)
 {
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
-  {
-    if(payload[i] == 0x85)
-    {
-      msg->reversed = (bool)payload[i + 2];
-      break;
-    }
+  switch (descriptor)
+  {
+    case TouchDescriptor::Id:
+      return TOUCHFIELD_ID;
+    case TouchDescriptor::Event:
+      return TOUCHFIELD_EVENT;
+    case TouchDescriptor::Orientation:
+      return TOUCHFIELD_ORIENTATION;
+    case TouchDescriptor::Confidence:
+      return TOUCHFIELD_CONFIDENCE;
+    case TouchDescriptor::Pressure:
+      return TOUCHFIELD_PRESSURE;
+    default:
+      // LocXByte1 to SizeZByte3 are groups of three bytes in the same order as the TouchField bits.
+      return TOUCHFIELD_X << (((uint8_t)descriptor - (uint8_t)TouchDescriptor::LocXByte1) / 3);
   }
 }
 
-void Zforce::ParseFlipXY(FlipXYMessage* msg, uint8_t* payload)
+/*
+ * Works out which bytes of a touch to decode and picks the decoder, whenever the
+ * touch descriptor or the field mask changes.
+ */
+void Zforce::UpdateTouchDecoder()
 {
-  const uint8_t offset = 10;
-  for(int i = offset; i < payload[11] + offset; i++)
+  uint16_t decodedFields = touchMetaInformation.fieldMask;
+#if ZFORCE_FEATURE_TOUCH_FILTER
+  if (touchFilterEnabled)
   {
-    if(payload[i] == 0x86)
-    {
-      msg->flipXY = (bool)payload[i + 2];
-      break;
-    }
+    // The filter needs the fields it checks, whether or not they are delivered.
+    decodedFields |= TOUCHFIELD_X | TOUCHFIELD_Y | TOUCHFIELD_SIZEX;
   }
-}
-
-void Zforce::ParseDetectionMode(DetectionModeMessage* msg, uint8_t* payload)
-{
-  uint8_t offset = payload[11] + 11; // 11 = Index for TouchActiveArea length
-  offset += payload[offset + 2]; // Add the length of the following Sequence to the offset
-  const uint8_t length = payload[1] + 2;
+#endif
 
-  for (int i = offset; i < length; i++)
+  touchMetaInformation.decodedBytes = 0;
+  touchMetaInformation.descriptorFields = 0;
+  touchMetaInformation.idIndex = 0xFF;
+  touchMetaInformation.eventIndex = 0xFF;
+  for (uint8_t j = 0; j < touchMetaInformation.touchByteCount; j++)
   {
-    if (payload[i] == 0x85) // Primitive type = 0x60, context specific = 0x20, tag id = 0x05 => 0x85
+    if (touchMetaInformation.touchDescriptor[j] == TouchDescriptor::Id)
     {
-      // We found it
-      uint8_t valueLength = payload[i + 1];
-      msg->mergeTouches = (payload[i + valueLength + 1] & 0x20) != 0; 
-      msg->reflectiveEdgeFilter = (payload[i + valueLength + 1] & 0x80) != 0;
-      break;
+      touchMetaInformation.idIndex = j;
     }
-    else
+    else if (touchMetaInformation.touchDescriptor[j] == TouchDescriptor::Event)
     {
-      // Keep looking 
-      i += payload[i + 1] + 1;
+      touchMetaInformation.eventIndex = j;
+    }
+
+    uint16_t field = DescriptorField(touchMetaInformation.touchDescriptor[j]);
+    touchMetaInformation.descriptorFields |= field;
+    if (field & decodedFields)
+    {
+      touchMetaInformation.decodedBytes |= (uint32_t)1 << j;
     }
   }
+
+  touchMetaInformation.decodeTouch = SelectTouchDecoder(&touchMetaInformation);
 }
 
-void Zforce::ParseTouch(TouchMessage* msg, uint8_t* payload)
+/*
+ * Selects the touch fields that are decoded, as a combination of TouchField
+ * values. Fields that are left out are skipped when decoding, and their values in
+ * TouchData and TouchFrame are 0. Id and Event are always decoded, and so are X, Y
+ * and SizeX while a touch filter is set.
+ */
+void Zforce::SetTouchFieldMask(uint16_t mask)
 {
+  touchMetaInformation.fieldMask = mask | TOUCHFIELD_ID | TOUCHFIELD_EVENT;
+  if (touchMetaInformation.touchDescriptor != nullptr)
+  {
+    UpdateTouchDecoder();
+  }
+}
 
-  if (touchMetaInformation.touchDescriptor == nullptr)
+#if ZFORCE_FEATURE_TOUCH_FILTER
+/*
+ * Only touches passing filter are delivered in touch messages and frames, the
+ * others are dropped while the touch notification is decoded. Conditions on fields
+ * that the sensor does not report are not checked. Pass nullptr to deliver all
+ * touches. A touch notification where all touches are dropped is still delivered,
+ * with a touch count of 0.
+ */
+void Zforce::SetTouchFilter(const TouchFilter* filter)
+{
+  if (filter != nullptr)
   {
-    return;
-  } 
-  else
+    touchFilter = *filter;
+  }
+  touchFilterEnabled = (filter != nullptr);
+  if (touchMetaInformation.touchDescriptor != nullptr)
   {
-    const uint8_t payloadOffset = 12;
-    const uint8_t expectedTouchLength = touchMetaInformation.touchByteCount + 2;
-    msg->touchCount = payload[9] / expectedTouchLength;
-    msg->touchData = new TouchData[msg->touchCount];
-    msg->timestamp = 0;
-    
-    if ((payload[1] + 2) > (payloadOffset + (expectedTouchLength * msg->touchCount))) // Check for timestamp
-    {
-      uint8_t timestampIndex = payloadOffset + (expectedTouchLength * msg->touchCount) - 2;
-      if (payload[timestampIndex] == 0x58) // Check for timestamp identifier
-      {
-        uint8_t timestampLength = payload[timestampIndex + 1];
-        for (int index = (timestampIndex + 2); index < (timestampIndex + 2 + timestampLength); index++)
-        {
-          msg->timestamp <<= 8;
-          msg->timestamp |= payload[index];
-        }
-      }
-    }
-
-    for (uint8_t i = 0; i < msg->touchCount; i++)
-    {
-      for (uint8_t j = 0; j < touchMetaInformation.touchByteCount; j++)
-      {
-        uint8_t index = payloadOffset + j + (i * expectedTouchLength);
-        switch (touchMetaInformation.touchDescriptor[j])
-        {
-          case TouchDescriptor::Id:
-          {
-            msg->touchData[i].id = payload[index];
-            break;
-          }
-          case TouchDescriptor::Event:
-          {
-            msg->touchData[i].event = (TouchEvent)payload[index];
-            break;
-          }
-          case TouchDescriptor::LocXByte1:
-          {
-            msg->touchData[i].x = payload[index];
-            break;
-          }
-          case TouchDescriptor::LocXByte2:
-          {
-            msg->touchData[i].x <<= 8;
-            msg->touchData[i].x |= payload[index];
-            break;
-          }
-          case TouchDescriptor::LocXByte3:
-          {
-            msg->touchData[i].x <<= 8;
-            msg->touchData[i].x |= payload[index];
-            break;
-          }
-          case TouchDescriptor::LocYByte1:
-          {
-            msg->touchData[i].y = payload[index];
-            break;
-          }
-          case TouchDescriptor::LocYByte2:
-          {
-            msg->touchData[i].y <<= 8;
-            msg->touchData[i].y |= payload[index];
-            break;
-          }
-          case TouchDescriptor::LocYByte3:
-          {
-            msg->touchData[i].y <<= 8;
-            msg->touchData[i].y |= payload[index];
-            break;
-          }
-          case TouchDescriptor::LocZByte1:
-          {
-            // No support for Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::LocZByte2:
-          {
-            // No support for Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::LocZByte3:
-          {
-            // No support for Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeXByte1:
-          {
-            msg->touchData[i].sizeX = payload[index];
-            break;
-          }
-          case TouchDescriptor::SizeXByte2:
-          {
-            msg->touchData[i].sizeX <<= 8;
-            msg->touchData[i].sizeX |= payload[index];
-            break;
-          }
-          case TouchDescriptor::SizeXByte3:
-          {
-            msg->touchData[i].sizeX <<= 8;
-            msg->touchData[i].sizeX |= payload[index];
-            break;
-          }
-          case TouchDescriptor::SizeYByte1:
-          {
-            // No support for size Y in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeYByte2:
-          {
-            // No support for size Y in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeYByte3:
-          {
-            // No support for size Y in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeZByte1:
-          {
-            // No support for size Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeZByte2:
-          {
-            // No support for size Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::SizeZByte3:
-          {
-            // No support for size Z in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::Orientation:
-          {
-            // No support for Orientation in Neonode AIR Touch sensor
-            break;
-          }
-          case TouchDescriptor::Confidence:
-          {
-            // Confidence is reported but should not be used as it is always reported as 100%
-            break;
-          }
-          case TouchDescriptor::Pressure:
-          {
-             // There iws no support for pressure in Neonode AIR Touch sensor
-            break;
-          }
-          default:
-          break;
-        }
-      }
-    }
+    UpdateTouchDecoder();
   }
 }
 
+void InitTouchFilter(TouchFilter* filter)
+{
+  filter->eventMask = 0xFF;
+  filter->idMask = 0xFFFFFFFF;
+  filter->minX = 0;
+  filter->minY = 0;
+  filter->maxX = (TouchCoordinate)~(TouchCoordinate)0;
+  filter->maxY = (TouchCoordinate)~(TouchCoordinate)0;
+  filter->minSizeX = 0;
+  filter->maxSizeX = (TouchCoordinate)~(TouchCoordinate)0;
+}
+
+TouchFilterStatistics Zforce::GetTouchFilterStatistics()
+{
+  return touchFilterStatistics;
+}
+
+void Zforce::ResetTouchFilterStatistics()
+{
+  memset(&touchFilterStatistics, 0, sizeof(touchFilterStatistics));
+}
+#endif
+
 void Zforce::ClearBuffer(uint8_t* buffer)
 {
   memset(buffer, 0, BUFFER_SIZE);
@@ -1415,6 +2939,7 @@ uint8_t Zforce::SerializeInt(int32_t value, uint8_t* serialized)
   }
 }
 
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
 void Zforce::DecodeOctetString(uint8_t* rawData, uint32_t* position, uint32_t* destinationLength, uint8_t** destination)
 {
     uint32_t length = rawData[(*position)++];
@@ -1443,6 +2968,7 @@ uint16_t Zforce::GetLength(uint8_t* rawData)
 
     return length;
 }
+#endif
 
 uint8_t Zforce::GetNumLengthBytes(uint8_t* rawData)
 {
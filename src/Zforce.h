@@ -18,13 +18,146 @@
 */
 #pragma once
 
-// Largest transaction size, excluding i2c header.
+// Optional parts of the library. Define any of these as 0 (for example with a
+// compiler flag) to leave out the corresponding methods, parsers and members.
+// Configuration commands: TouchActiveArea, FlipXY, ReverseX and ReverseY.
+#ifndef ZFORCE_FEATURE_AREA_CONFIGURATION
+#define ZFORCE_FEATURE_AREA_CONFIGURATION 1
+#endif
+// Configuration commands: Frequency, ReportedTouches, DetectionMode, TouchMode and FloatingProtection.
+#ifndef ZFORCE_FEATURE_DETECTION_CONFIGURATION
+#define ZFORCE_FEATURE_DETECTION_CONFIGURATION 1
+#endif
+// GetPlatformInformation, and reading of firmware version and MCU ID in Start().
+#ifndef ZFORCE_FEATURE_PLATFORM_INFORMATION
+#define ZFORCE_FEATURE_PLATFORM_INFORMATION 1
+#endif
+// SetTouchFilter, for dropping unwanted touches while they are decoded.
+// Left out by default on AVR, where flash and RAM are scarce; define as 1 to use it.
+#ifndef ZFORCE_FEATURE_TOUCH_FILTER
+#if defined(__AVR__)
+#define ZFORCE_FEATURE_TOUCH_FILTER 0
+#else
+#define ZFORCE_FEATURE_TOUCH_FILTER 1
+#endif
+#endif
+// SleepUntilMessage, for sleeping between touch notifications on battery powered units.
+// Left out by default on AVR, where flash and RAM are scarce; define as 1 to use it.
+#ifndef ZFORCE_FEATURE_LOW_POWER
+#if defined(__AVR__)
+#define ZFORCE_FEATURE_LOW_POWER 0
+#else
+#define ZFORCE_FEATURE_LOW_POWER 1
+#endif
+#endif
+// SendRawMessage and ReceiveRawMessage.
+#ifndef ZFORCE_FEATURE_RAW_MESSAGES
+#define ZFORCE_FEATURE_RAW_MESSAGES 1
+#endif
+
+// Largest transaction size, excluding i2c header. Can be lowered to save RAM
+// when the sensor is configured to only send small messages, e.g. few touches.
+// Longer messages are read to the end but dropped, and reported as read errors.
+#ifndef MAX_PAYLOAD
 #define MAX_PAYLOAD 255
+#endif
 // The buffer must be able to contain both the i2c header, and MAX_PAYLOAD size.
 #define BUFFER_SIZE (MAX_PAYLOAD+2)
+#define ZFORCE_LIBRARY_VERSION "1.8.0"
 #define ZFORCE_DEFAULT_I2C_ADDRESS 0x50
+// Returned by Read() when a message does not fit in MAX_PAYLOAD.
+#define ZFORCE_MESSAGE_TRUNCATED 0xFF
+// Number of requests that can be sent before their responses have been read.
+#ifndef ZFORCE_MAX_PENDING_REQUESTS
+#define ZFORCE_MAX_PENDING_REQUESTS 4
+#endif
+
+// Number of times a failed i2c transaction is retried before giving up.
+#ifndef ZFORCE_I2C_RETRIES
+#define ZFORCE_I2C_RETRIES 3
+#endif
+// Delay before the first retry in microseconds, doubled for each following retry.
+#ifndef ZFORCE_I2C_BACKOFF_US
+#define ZFORCE_I2C_BACKOFF_US 100
+#endif
+// Time in milliseconds to wait for the bus before a transaction is considered timed out.
+#ifndef ZFORCE_I2C_TIMEOUT_MS
+#define ZFORCE_I2C_TIMEOUT_MS 10
+#endif
+// I2C clock frequency in Hz. Above 400kHz (Fast-mode) the sensor, MCU and wiring
+// must support Fast-mode Plus, which goes up to 1MHz.
+#ifndef ZFORCE_I2C_FREQUENCY
+#define ZFORCE_I2C_FREQUENCY 400000
+#endif
+// The frequency is lowered one step when ZFORCE_I2C_FALLBACK_ERRORS out of
+// ZFORCE_I2C_FALLBACK_WINDOW transactions fail, but not below ZFORCE_I2C_MIN_FREQUENCY.
+// Define ZFORCE_I2C_FALLBACK_ERRORS as 0 to keep the frequency fixed.
+#ifndef ZFORCE_I2C_MIN_FREQUENCY
+#define ZFORCE_I2C_MIN_FREQUENCY 50000
+#endif
+#ifndef ZFORCE_I2C_FALLBACK_WINDOW
+#define ZFORCE_I2C_FALLBACK_WINDOW 64
+#endif
+#ifndef ZFORCE_I2C_FALLBACK_ERRORS
+#define ZFORCE_I2C_FALLBACK_ERRORS 8
+#endif
+// Request/response round trips that must succeed at a frequency for ProbeBusFrequency() to keep it.
+#ifndef ZFORCE_I2C_PROBE_ROUNDS
+#define ZFORCE_I2C_PROBE_ROUNDS 8
+#endif
+// Pins used for clocking out a stuck bus on non-Atmel platforms.
+#ifndef ZFORCE_SDA_PIN
+#define ZFORCE_SDA_PIN SDA
+#endif
+#ifndef ZFORCE_SCL_PIN
+#define ZFORCE_SCL_PIN SCL
+#endif
+
+// Use decoders specialized for the common touch descriptors instead of
+// interpreting the descriptor for every touch. Define as 0 to save flash.
+#ifndef ZFORCE_FAST_TOUCH_DECODERS
+#define ZFORCE_FAST_TOUCH_DECODERS 1
+#endif
+
+// Maximum number of touches the sensor reports in one touch notification.
+#define ZFORCE_MAX_TOUCHES 10
+
+// Define as 1 to store each touch in 8 bytes instead of 16. Coordinates and size
+// are then limited to 16 bits, which covers touch descriptors with 1 or 2 bytes per value.
+#ifndef ZFORCE_PACKED_TOUCH_DATA
+#define ZFORCE_PACKED_TOUCH_DATA 0
+#endif
+
+#if ZFORCE_PACKED_TOUCH_DATA
+typedef uint16_t TouchCoordinate;
+#else
+typedef uint32_t TouchCoordinate;
+#endif
+
+// Define as 1 to also decode Z, SizeY, SizeZ, Orientation, Confidence and Pressure,
+// for sensors that report them. Adds 14 bytes to each touch (8 with packed touch data).
+#ifndef ZFORCE_EXTENDED_TOUCH_DATA
+#define ZFORCE_EXTENDED_TOUCH_DATA 0
+#endif
+
+// Fields of a touch, for selecting which ones are decoded with SetTouchFieldMask().
+enum TouchField : uint16_t
+{
+	TOUCHFIELD_ID = 0x0001,
+	TOUCHFIELD_EVENT = 0x0002,
+	TOUCHFIELD_X = 0x0004,
+	TOUCHFIELD_Y = 0x0008,
+	TOUCHFIELD_Z = 0x0010,
+	TOUCHFIELD_SIZEX = 0x0020,
+	TOUCHFIELD_SIZEY = 0x0040,
+	TOUCHFIELD_SIZEZ = 0x0080,
+	TOUCHFIELD_ORIENTATION = 0x0100,
+	TOUCHFIELD_CONFIDENCE = 0x0200,
+	TOUCHFIELD_PRESSURE = 0x0400,
+	TOUCHFIELD_ALL = 0x07FF
+};
 
-enum TouchEvent
+enum TouchEvent : uint8_t
 {
 	DOWN = 0,
 	MOVE = 1,
@@ -49,18 +182,124 @@ enum class MessageType
 	TOUCHFORMATTYPE = 11,
 	TOUCHMODETYPE = 12,
 	FLOATINGPROTECTIONTYPE = 13,
-	PLATFORMINFORMATIONTYPE = 14
+	PLATFORMINFORMATIONTYPE = 14,
+	OPERATIONMODETYPE = 15
+};
+
+enum class BusErrorType
+{
+	NONE,
+	TIMEOUT,
+	NACK,
+	ARBITRATIONLOST,
+	OTHER
 };
 
+typedef struct BusStatistics
+{
+	uint16_t timeouts;
+	uint16_t nacks;
+	uint16_t arbitrationLosses;
+	uint16_t otherErrors;
+	uint16_t retries;
+	uint16_t recoveries;
+	uint16_t failedTransactions;  // transactions that still failed after all retries
+	int lastError;                // status code of the most recent failed attempt
+} BusStatistics;
+
+typedef struct BusFrequencyStatus
+{
+	uint32_t frequency;           // SCL frequency in Hz asked for
+	uint32_t actualFrequency;     // closest frequency the i2c peripheral can run at, on Atmel platforms
+	uint16_t fallbacks;           // times the frequency was lowered because of errors
+	uint16_t windowTransactions;  // transactions and errors counted towards the next fallback decision
+	uint16_t windowErrors;
+} BusFrequencyStatus;
+
+typedef struct TransportCapabilities
+{
+	uint16_t maxTransactionSize;  // largest number of bytes moved in a single i2c transaction
+	bool repeatedStart;           // a read can be continued without releasing the bus
+} TransportCapabilities;
+
 typedef struct TouchData
 {
-	uint32_t x;
-	uint32_t y;
-	uint32_t sizeX;   //the estimated diameter of the touch object
+	TouchCoordinate x;
+	TouchCoordinate y;
+	TouchCoordinate sizeX;   //the estimated diameter of the touch object
 	uint8_t id;
 	TouchEvent event;
+#if ZFORCE_EXTENDED_TOUCH_DATA
+	TouchCoordinate z;
+	TouchCoordinate sizeY;
+	TouchCoordinate sizeZ;
+	uint8_t orientation;
+	uint8_t confidence;
+	uint8_t pressure;
+#endif
 } TouchData;
 
+// Touches are only kept if they pass all of the conditions below.
+typedef struct TouchFilter
+{
+	uint8_t eventMask;        // bit n set to keep touches with TouchEvent n, e.g. (1 << DOWN) | (1 << MOVE) | (1 << UP)
+	uint32_t idMask;          // bit n set to keep touches with id n, ids above 31 are always kept
+	TouchCoordinate minX;     // area touches must be within, limits included
+	TouchCoordinate minY;
+	TouchCoordinate maxX;
+	TouchCoordinate maxY;
+	TouchCoordinate minSizeX; // range of sizeX, e.g. to drop palms
+	TouchCoordinate maxSizeX;
+} TouchFilter;
+
+// Sets filter to keep all touches, with every event and id and the full ranges
+// of the coordinates, so only the conditions that matter need to be changed.
+// A zero-initialized TouchFilter drops every touch.
+#if ZFORCE_FEATURE_TOUCH_FILTER
+void InitTouchFilter(TouchFilter* filter);
+#endif
+
+typedef struct TouchFilterStatistics
+{
+	uint32_t accepted;
+	uint32_t rejectedEvent;
+	uint32_t rejectedId;
+	uint32_t rejectedArea;
+	uint32_t rejectedSize;
+} TouchFilterStatistics;
+
+typedef struct LowPowerStatistics
+{
+	uint32_t sleeps;        // times the MCU was put to sleep, including wakeups by other interrupts
+	uint32_t wakeups;       // data ready edges seen while waiting
+	uint32_t waitTime;      // microseconds spent in SleepUntilMessage waiting for data ready, asleep or not,
+	                        // including other interrupts and yield(), wrapping after about 71 minutes
+	uint32_t messages;      // messages read after a data ready edge
+	uint32_t latencyTotal;  // microseconds from the data ready edge until the message was parsed, summed over messages
+	uint32_t latencyMax;
+} LowPowerStatistics;
+
+// All touches of one touch notification stored as one array per field, for
+// consumers that process every touch of a frame in bulk. No memory is allocated.
+typedef struct TouchFrame
+{
+	uint32_t timestamp;
+	uint8_t touchCount;
+	TouchCoordinate x[ZFORCE_MAX_TOUCHES];
+	TouchCoordinate y[ZFORCE_MAX_TOUCHES];
+	TouchCoordinate sizeX[ZFORCE_MAX_TOUCHES];
+	uint8_t id[ZFORCE_MAX_TOUCHES];
+	TouchEvent event[ZFORCE_MAX_TOUCHES];
+#if ZFORCE_EXTENDED_TOUCH_DATA
+	TouchCoordinate z[ZFORCE_MAX_TOUCHES];
+	TouchCoordinate sizeY[ZFORCE_MAX_TOUCHES];
+	TouchCoordinate sizeZ[ZFORCE_MAX_TOUCHES];
+	uint8_t orientation[ZFORCE_MAX_TOUCHES];
+	uint8_t confidence[ZFORCE_MAX_TOUCHES];
+	uint8_t pressure[ZFORCE_MAX_TOUCHES];
+#endif
+} TouchFrame;
+
 enum class TouchModes
 {
 	NORMAL,
@@ -210,7 +449,7 @@ typedef struct TouchDescriptorMessage : public Message
 {
 	virtual ~TouchDescriptorMessage()
 	{
-		delete descriptor;
+		delete[] descriptor;
 		descriptor = nullptr;
 	}
 	TouchDescriptor *descriptor;
@@ -240,12 +479,63 @@ typedef struct FloatingProtectionMessage : public Message
 	uint16_t time;
 } FloatingProtectionMessage;
 
+struct TouchMetaInformation;
+typedef void (*TouchDecodeFunction)(const struct TouchMetaInformation* meta, uint8_t* rawTouch, TouchData* touch);
+
 typedef struct TouchMetaInformation
 {
-	TouchDescriptor *touchDescriptor;
+	TouchDescriptor *touchDescriptor = nullptr;
 	uint8_t touchByteCount = 0;
+	TouchDecodeFunction decodeTouch = nullptr;  // chosen for touchDescriptor when it is received
+	uint16_t fieldMask = TOUCHFIELD_ALL;        // TouchField values to decode
+	uint32_t decodedBytes = 0;                  // bit j set if byte j of a touch belongs to a field in fieldMask
+	uint16_t descriptorFields = 0;              // TouchField values present in touchDescriptor
+	uint8_t idIndex = 0xFF;                     // position of Id and Event in a touch, 0xFF if not reported
+	uint8_t eventIndex = 0xFF;
 } TouchMetaInformation;
 
+struct CommandPatch;
+struct CommandSource;
+class Zforce;
+
+/*
+ * A touch notification left in the receive buffer, with its touches decoded one at
+ * a time while iterating, e.g. for (const TouchData& touch : view). Touches dropped
+ * by the touch filter are skipped. Nothing is copied or allocated, but the view is
+ * only valid until the next read from the sensor.
+ */
+class TouchFrameView
+{
+	public:
+		class Iterator
+		{
+			public:
+				const TouchData& operator*() const { return touch; }
+				const TouchData* operator->() const { return &touch; }
+				Iterator& operator++();
+				bool operator!=(const Iterator& other) const { return index != other.index; }
+			private:
+				friend class TouchFrameView;
+				Iterator(const TouchFrameView* view, uint8_t index);
+				void Seek();
+				const TouchFrameView* view;
+				uint8_t index;
+				TouchData touch;
+		};
+		TouchFrameView();
+		Iterator begin() const;
+		Iterator end() const;
+		// Touches in the notification, including any that the touch filter will drop.
+		uint8_t Count() const;
+		uint32_t timestamp;
+	private:
+		friend class Zforce;
+		Zforce* zforce;
+		uint8_t* touches;
+		uint8_t touchCount;
+		uint8_t touchLength;
+};
+
 class Zforce 
 {
     public:
@@ -254,55 +544,136 @@ class Zforce
 		void Start(int dr, int i2cAddress);
 		int Read(uint8_t* payload);
 		int Write(uint8_t* payload);
+#if ZFORCE_FEATURE_RAW_MESSAGES
 		bool SendRawMessage(uint8_t* payload, uint8_t payloadLength);
 		uint8_t* ReceiveRawMessage(uint8_t* receivedLength, uint16_t *remainingLength);
+#endif
 		bool Enable(bool isEnabled);
+		bool SetEnable(bool isEnabled);
+		bool OperationMode();
 		bool GetEnable();
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
 		bool TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY);
 		bool FlipXY(bool isFlipped);
 		bool ReverseX(bool isReversed);
 		bool ReverseY(bool isReversed);
+#endif
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
 		bool Frequency(uint16_t idleFrequency, uint16_t fingerFrequency);
+		bool GetFrequency();
 		bool ReportedTouches(uint8_t touches);
 		bool DetectionMode(bool mergeTouches, bool reflectiveEdgeFilter);	
-		bool TouchFormat();	
 		bool TouchMode(uint8_t mode, int16_t clickOnTouchRadius, int16_t clickOnTouchTime);
 		bool FloatingProtection(bool enabled, uint16_t time);
+#endif
+		bool TouchFormat();	
+		void SetTouchFieldMask(uint16_t mask);
+#if ZFORCE_FEATURE_TOUCH_FILTER
+		void SetTouchFilter(const TouchFilter* filter);
+		TouchFilterStatistics GetTouchFilterStatistics();
+		void ResetTouchFilterStatistics();
+#endif
 		int GetDataReady();
 		Message* GetMessage();
+#if ZFORCE_FEATURE_LOW_POWER
+		Message* SleepUntilMessage(uint32_t timeout = 0);
+		LowPowerStatistics GetLowPowerStatistics();
+		void ResetLowPowerStatistics();
+#endif
+		uint8_t GetMessages(Message** messages, uint8_t maxMessages, uint32_t timeBudget = 0);
 		void DestroyMessage(Message * msg);
+		void CopyTouchFrame(TouchMessage* msg, TouchFrame* frame);
+		bool GetTouchFrame(TouchFrame* frame, Message** msg);
+		Message* ParseMessage(uint8_t* payload);
+		bool ParseTouchFrame(uint8_t* payload, TouchFrame* frame, Message** msg);
+		bool GetTouchFrameView(TouchFrameView* view, Message** msg);
+		bool ParseTouchFrameView(uint8_t* payload, TouchFrameView* view, Message** msg);
+		TransportCapabilities GetTransportCapabilities();
+		BusStatistics GetBusStatistics();
+		void ResetBusStatistics();
+		uint32_t SetBusFrequency(uint32_t frequency);
+		uint32_t ProbeBusFrequency(uint32_t maxFrequency);
+		BusFrequencyStatus GetBusFrequencyStatus();
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
 		bool GetPlatformInformation();
 		uint8_t FirmwareVersionMajor;
 		uint8_t FirmwareVersionMinor;
 		char* MCUUniqueIdentifier;
+#endif
     private:
+		friend class TouchFrameView;
+		void BeginBus();
+		int ReadTransaction(uint8_t* destination, uint8_t length);
+		int WriteCommand(const uint8_t* command, uint8_t length, const CommandPatch* patches, uint8_t patchCount);
+		int WriteSource(const CommandSource* source, uint8_t length);
+		int WriteTransaction(const CommandSource* source, uint8_t length);
+		BusErrorType ClassifyBusError(int status);
+		void RecordBusError(int status);
+		bool PrepareRetry(int status, uint8_t attempt);
+		void RecoverBus();
+		void ApplyBusFrequency();
+		void CountTransaction(int status);
+		void LowerBusFrequency();
+		bool ProbeRoundTrips();
+		void ApplyPendingFallback();
 		Message* VirtualParse(uint8_t* payload);
-		void ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload);
 		void ParseEnable(EnableMessage* msg, uint8_t* payload);
-		void ParseFrequency(FrequencyMessage* msg, uint8_t* payload);
-		void ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload);
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
+		void ParseTouchActiveArea(TouchActiveAreaMessage* msg, uint8_t* payload);
 		void ParseReverseX(ReverseXMessage* msg, uint8_t* payload);
 		void ParseReverseY(ReverseYMessage* msg, uint8_t* payload);
 		void ParseFlipXY(FlipXYMessage* msg, uint8_t* payload);
-		void ParseTouch(TouchMessage* msg, uint8_t* payload);
+#endif
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
+		void ParseFrequency(FrequencyMessage* msg, uint8_t* payload);
+		void ParseReportedTouches(ReportedTouchesMessage* msg, uint8_t* payload);
 		void ParseDetectionMode(DetectionModeMessage* msg, uint8_t* payload);
-		void ParseResponse(uint8_t* payload, Message** msg);
-		void ParseTouchDescriptor(TouchDescriptorMessage* msg, uint8_t* payload);
 		void ParseTouchMode(TouchModeMessage* msg, uint8_t* payload);
 		void ParseFloatingProtection(FloatingProtectionMessage* msg, uint8_t* payload);
+#endif
+		void ParseTouch(TouchMessage* msg, uint8_t* payload);
+		void DecodeTouchFrame(TouchFrame* frame, uint8_t* payload);
+		uint8_t ParseTouchCount(uint8_t* payload);
+		uint32_t ParseTouchTimestamp(uint8_t* payload, uint8_t touchCount);
+		void DecodeTouch(uint8_t* rawTouch, TouchData* touch);
+		void UpdateTouchDecoder();
+		bool DecodeAcceptedTouch(uint8_t* rawTouch, TouchData* touch);
+		void ParseResponse(uint8_t* payload, Message** msg);
+		MessageType ClassifyResponse(uint8_t* payload);
+		void AddPendingRequest(MessageType type);
+		MessageType TakePendingRequest(uint16_t candidates, MessageType fallback);
+		void ParseTouchDescriptor(TouchDescriptorMessage* msg, uint8_t* payload);
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
 		void ParsePlatformInformation(PlatformInformationMessage* msg, uint8_t* rawData, uint32_t length);
-		void ClearBuffer(uint8_t* buffer);
-		uint8_t SerializeInt(int32_t value, uint8_t* serialized);
 		void DecodeOctetString(uint8_t* rawData, uint32_t* position, uint32_t* destinationLength, uint8_t** destination);
 		uint16_t GetLength(uint8_t* rawData);
+#endif
 		uint8_t GetNumLengthBytes(uint8_t* rawData);
+		void ClearBuffer(uint8_t* buffer);
+		uint8_t SerializeInt(int32_t value, uint8_t* serialized);
 		uint8_t buffer[BUFFER_SIZE];
 		int dataReady;
 		int i2cAddress;
+#if ZFORCE_FEATURE_RAW_MESSAGES
 		uint16_t remainingRawLength;
-		volatile MessageType lastSentMessage;
+#endif
+		MessageType pendingRequests[ZFORCE_MAX_PENDING_REQUESTS];
+		uint8_t pendingRequestCount;
 		TouchMetaInformation touchMetaInformation;
 		bool touchDescriptorInitialized;
+		BusStatistics busStatistics;
+		BusFrequencyStatus busFrequency;
+		bool busFrequencyFallbackPending;
+		bool busStarted;
+#if ZFORCE_FEATURE_TOUCH_FILTER
+		TouchFilter touchFilter;
+		bool touchFilterEnabled;
+		TouchFilterStatistics touchFilterStatistics;
+#endif
+#if ZFORCE_FEATURE_LOW_POWER
+		bool dataReadyInterruptAttached;
+		LowPowerStatistics lowPowerStatistics;
+#endif
 };
 
 extern Zforce zforce;
@@ -0,0 +1,392 @@
+/*  Neonode zForce v7 interface library for Arduino
+
+    Copyright (C) 2019-2023 Neonode Inc.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#pragma once
+
+/*
+ * C++20 coroutine interface for sending requests to one or more sensors.
+ *
+ * Each ZforceDevice wraps a started Zforce instance. Its request methods return
+ * awaitables, so a coroutine returning ZforceTask can write
+ *
+ *   co_await device.ReverseX(false);
+ *   auto frequency = co_await device.GetFrequency();
+ *
+ * where the result is a std::unique_ptr to the parsed response, or empty if the
+ * request could not be written or timed out. All devices attached to a
+ * ZforceEventLoop are serviced from RunOnce(), which sends queued requests, reads
+ * the sensors and resumes the coroutines whose responses have arrived. Nothing is
+ * allocated per request apart from the coroutine frames themselves, and no threads
+ * are used.
+ *
+ * Only available when the compiler supports coroutines, e.g. host builds.
+ */
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <stdint.h>
+#include <Arduino.h>
+#include "Zforce.h"
+
+// Requests that have not been answered after this many milliseconds complete without a response.
+#ifndef ZFORCE_REQUEST_TIMEOUT_MS
+#define ZFORCE_REQUEST_TIMEOUT_MS 1000
+#endif
+
+class ZforceDevice;
+class ZforceEventLoop;
+
+// Return type for coroutines using ZforceDevice. Starts running immediately and
+// cleans up after itself when it finishes.
+struct ZforceTask
+{
+	struct promise_type
+	{
+		ZforceTask get_return_object() { return ZforceTask(); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+// Type independent part of a request, linked into the queues of its ZforceDevice.
+class ZforceRequestBase
+{
+	public:
+		virtual ~ZforceRequestBase() {}
+		virtual bool Send(Zforce* sensor) = 0;
+		// Called with the response to each step of the request. Returns true if the
+		// response was consumed and the request has another step to send.
+		virtual bool NextStep(Zforce*, Message*) { return false; }
+		MessageType type;
+		Message* response = nullptr;
+		unsigned long sentTime = 0;
+		std::coroutine_handle<> handle;
+		ZforceRequestBase* next = nullptr;
+};
+
+class ZforceDevice
+{
+	public:
+		ZforceDevice(Zforce* sensor) : sensor(sensor) {}
+		// Coroutines still waiting for a request of the device are destroyed without
+		// being resumed, together with any responses that were not handed out.
+		~ZforceDevice()
+		{
+			DestroyRequests(&unsent);
+			DestroyRequests(&outstanding);
+			DestroyRequests(&ready);
+		}
+
+		bool Idle() const { return (unsent == nullptr) && (outstanding == nullptr); }
+
+		// Called with every message that is not a response to a request, e.g. touch
+		// notifications. The handler must destroy the message. If no handler is set,
+		// the messages are destroyed.
+		void SetNotificationHandler(void (*handler)(ZforceDevice* device, Message* msg, void* context), void* context)
+		{
+			notificationHandler = handler;
+			notificationContext = context;
+		}
+
+		Zforce* GetSensor() { return sensor; }
+
+		// Sets normal operation mode before enabling, as Zforce::Enable() does, but
+		// as two requests so that the event loop is never blocked.
+		auto Enable(bool isEnabled) { return EnableAwaitable(this, isEnabled); }
+		auto GetEnable() { return Request<EnableMessage>(MessageType::ENABLETYPE, [](Zforce* s) { return s->GetEnable(); }); }
+		auto TouchFormat() { return Request<TouchDescriptorMessage>(MessageType::TOUCHFORMATTYPE, [](Zforce* s) { return s->TouchFormat(); }); }
+#if ZFORCE_FEATURE_AREA_CONFIGURATION
+		auto TouchActiveArea(uint16_t minX, uint16_t minY, uint16_t maxX, uint16_t maxY) { return Request<TouchActiveAreaMessage>(MessageType::TOUCHACTIVEAREATYPE, [=](Zforce* s) { return s->TouchActiveArea(minX, minY, maxX, maxY); }); }
+		auto FlipXY(bool isFlipped) { return Request<FlipXYMessage>(MessageType::FLIPXYTYPE, [=](Zforce* s) { return s->FlipXY(isFlipped); }); }
+		auto ReverseX(bool isReversed) { return Request<ReverseXMessage>(MessageType::REVERSEXTYPE, [=](Zforce* s) { return s->ReverseX(isReversed); }); }
+		auto ReverseY(bool isReversed) { return Request<ReverseYMessage>(MessageType::REVERSEYTYPE, [=](Zforce* s) { return s->ReverseY(isReversed); }); }
+#endif
+#if ZFORCE_FEATURE_DETECTION_CONFIGURATION
+		auto Frequency(uint16_t idleFrequency, uint16_t fingerFrequency) { return Request<FrequencyMessage>(MessageType::FREQUENCYTYPE, [=](Zforce* s) { return s->Frequency(idleFrequency, fingerFrequency); }); }
+		auto GetFrequency() { return Request<FrequencyMessage>(MessageType::FREQUENCYTYPE, [](Zforce* s) { return s->GetFrequency(); }); }
+		auto ReportedTouches(uint8_t touches) { return Request<ReportedTouchesMessage>(MessageType::REPORTEDTOUCHESTYPE, [=](Zforce* s) { return s->ReportedTouches(touches); }); }
+		auto DetectionMode(bool mergeTouches, bool reflectiveEdgeFilter) { return Request<DetectionModeMessage>(MessageType::DETECTIONMODETYPE, [=](Zforce* s) { return s->DetectionMode(mergeTouches, reflectiveEdgeFilter); }); }
+		auto TouchMode(uint8_t mode, int16_t clickOnTouchRadius, int16_t clickOnTouchTime) { return Request<TouchModeMessage>(MessageType::TOUCHMODETYPE, [=](Zforce* s) { return s->TouchMode(mode, clickOnTouchRadius, clickOnTouchTime); }); }
+		auto FloatingProtection(bool enabled, uint16_t time) { return Request<FloatingProtectionMessage>(MessageType::FLOATINGPROTECTIONTYPE, [=](Zforce* s) { return s->FloatingProtection(enabled, time); }); }
+#endif
+#if ZFORCE_FEATURE_PLATFORM_INFORMATION
+		auto GetPlatformInformation() { return Request<PlatformInformationMessage>(MessageType::PLATFORMINFORMATIONTYPE, [](Zforce* s) { return s->GetPlatformInformation(); }); }
+#endif
+
+		template <typename T, typename SendFunction>
+		class Awaitable : public ZforceRequestBase
+		{
+			public:
+				Awaitable(ZforceDevice* device, MessageType type, SendFunction send) : device(device), send(send)
+				{
+					this->type = type;
+				}
+				bool await_ready() { return false; }
+				void await_suspend(std::coroutine_handle<> handle)
+				{
+					this->handle = handle;
+					device->Submit(this);
+				}
+				std::unique_ptr<T> await_resume()
+				{
+					std::unique_ptr<T> result((T*)response);
+					response = nullptr;
+					return result;
+				}
+				bool Send(Zforce* sensor) override { return send(sensor); }
+			private:
+				ZforceDevice* device;
+				SendFunction send;
+		};
+
+		class EnableAwaitable : public ZforceRequestBase
+		{
+			public:
+				EnableAwaitable(ZforceDevice* device, bool isEnabled) : device(device), isEnabled(isEnabled)
+				{
+					this->type = isEnabled ? MessageType::OPERATIONMODETYPE : MessageType::ENABLETYPE;
+				}
+				bool await_ready() { return false; }
+				void await_suspend(std::coroutine_handle<> handle)
+				{
+					this->handle = handle;
+					device->Submit(this);
+				}
+				std::unique_ptr<EnableMessage> await_resume()
+				{
+					std::unique_ptr<EnableMessage> result((EnableMessage*)response);
+					response = nullptr;
+					return result;
+				}
+				bool Send(Zforce* sensor) override
+				{
+					return (type == MessageType::OPERATIONMODETYPE) ? sensor->OperationMode() : sensor->SetEnable(isEnabled);
+				}
+				bool NextStep(Zforce* sensor, Message* response) override
+				{
+					if (type != MessageType::OPERATIONMODETYPE)
+					{
+						return false;
+					}
+					sensor->DestroyMessage(response);
+					type = MessageType::ENABLETYPE;
+					return true;
+				}
+			private:
+				ZforceDevice* device;
+				bool isEnabled;
+		};
+
+	private:
+		friend class ZforceEventLoop;
+
+		template <typename T, typename SendFunction>
+		Awaitable<T, SendFunction> Request(MessageType type, SendFunction send)
+		{
+			return Awaitable<T, SendFunction>(this, type, send);
+		}
+
+		void Submit(ZforceRequestBase* request)
+		{
+			request->next = nullptr;
+			Append(&unsent, request);
+		}
+
+		static void Append(ZforceRequestBase** list, ZforceRequestBase* request)
+		{
+			while (*list != nullptr)
+			{
+				list = &(*list)->next;
+			}
+			*list = request;
+		}
+
+		// Moves completed requests to the ready list, to be resumed by the event loop,
+		// or back to the unsent list if they have another step.
+		void Complete(ZforceRequestBase* request, Message* response)
+		{
+			request->next = nullptr;
+			if ((response != nullptr) && request->NextStep(sensor, response))
+			{
+				Append(&unsent, request);
+				return;
+			}
+			request->response = response;
+			Append(&ready, request);
+		}
+
+		void Service()
+		{
+			// Requests are only written when the sensor has nothing for us, and at
+			// most as many as the sensor object can keep track of.
+			while ((unsent != nullptr) && (outstandingCount < ZFORCE_MAX_PENDING_REQUESTS) && (sensor->GetDataReady() == LOW))
+			{
+				ZforceRequestBase* request = unsent;
+				unsent = request->next;
+				request->next = nullptr;
+				if (request->Send(sensor))
+				{
+					request->sentTime = millis();
+					Append(&outstanding, request);
+					outstandingCount++;
+				}
+				else
+				{
+					Complete(request, nullptr);
+				}
+			}
+
+			Message* msg = sensor->GetMessage();
+			if (msg != nullptr)
+			{
+				Dispatch(msg);
+			}
+
+			ZforceRequestBase** link = &outstanding;
+			while (*link != nullptr)
+			{
+				ZforceRequestBase* request = *link;
+				if ((millis() - request->sentTime) >= ZFORCE_REQUEST_TIMEOUT_MS)
+				{
+					*link = request->next;
+					outstandingCount--;
+					Complete(request, nullptr);
+				}
+				else
+				{
+					link = &request->next;
+				}
+			}
+		}
+
+		// Hands a response to the oldest outstanding request of the same type.
+		void Dispatch(Message* msg)
+		{
+			for (ZforceRequestBase** link = &outstanding; *link != nullptr; link = &(*link)->next)
+			{
+				ZforceRequestBase* request = *link;
+				if (request->type == msg->type)
+				{
+					*link = request->next;
+					outstandingCount--;
+					Complete(request, msg);
+					return;
+				}
+			}
+
+			if (notificationHandler != nullptr)
+			{
+				notificationHandler(this, msg, notificationContext);
+			}
+			else
+			{
+				sensor->DestroyMessage(msg);
+			}
+		}
+
+		void ResumeReady()
+		{
+			while (ready != nullptr)
+			{
+				ZforceRequestBase* request = ready;
+				ready = request->next;
+				request->next = nullptr;
+				request->handle.resume();
+			}
+		}
+
+		void DestroyRequests(ZforceRequestBase** list)
+		{
+			while (*list != nullptr)
+			{
+				ZforceRequestBase* request = *list;
+				*list = request->next;
+				sensor->DestroyMessage(request->response);
+				request->response = nullptr;
+				// The request lives in the coroutine frame, so it is gone after this.
+				std::coroutine_handle<> handle = request->handle;
+				handle.destroy();
+			}
+		}
+
+		Zforce* sensor;
+		ZforceRequestBase* unsent = nullptr;
+		ZforceRequestBase* outstanding = nullptr;
+		ZforceRequestBase* ready = nullptr;
+		uint8_t outstandingCount = 0;
+		void (*notificationHandler)(ZforceDevice* device, Message* msg, void* context) = nullptr;
+		void* notificationContext = nullptr;
+		ZforceDevice* nextDevice = nullptr;
+};
+
+// Services any number of devices from a single thread.
+class ZforceEventLoop
+{
+	public:
+		void Add(ZforceDevice* device)
+		{
+			device->nextDevice = devices;
+			devices = device;
+		}
+
+		// Services every device once and resumes the coroutines whose requests have completed.
+		void RunOnce()
+		{
+			for (ZforceDevice* device = devices; device != nullptr; device = device->nextDevice)
+			{
+				device->Service();
+			}
+			for (ZforceDevice* device = devices; device != nullptr; device = device->nextDevice)
+			{
+				device->ResumeReady();
+			}
+		}
+
+		// Runs until no device has any request left.
+		void Run()
+		{
+			while (!Idle())
+			{
+				RunOnce();
+			}
+		}
+
+		bool Idle()
+		{
+			for (ZforceDevice* device = devices; device != nullptr; device = device->nextDevice)
+			{
+				if (!device->Idle() || (device->ready != nullptr))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		ZforceDevice* devices = nullptr;
+};
+
+#endif
+#endif